@@ -0,0 +1,240 @@
+// Math and mesh transform cases.
+#include "harness.h"
+
+#include "input.h"
+#include "jobs.h"
+#include "mathematics.h"
+#include "matrix.h"
+#include "mesh.h"
+#include "meshopt.h"
+#include "primitives.h"
+#include "profiler.h"
+#include "transform.h"
+
+#include <vector>
+
+namespace {
+  Mat4 MakeTestTransform() {
+    Mat4 world = Mat4::Multiply(Mat4::MakeRotationY(0.3f), Mat4::MakeTranslation(0.5f, 1.0f, 8.0f));
+    return Mat4::Multiply(world, Mat4::MakeProjection(90.0f, 4.0f / 3.0f, 0.1f, 100.0f));
+  }
+
+  // A row of cubes with count unique vertices (rounded up to whole cubes).
+  void MakeCubeRow(Mesh& mesh, int64_t count) {
+    for (int64_t i = 0; i * 8 < count; ++i)
+      primitives::AddCubeToMesh(mesh, (float)i * 1.5f, 0.0f, 0.0f);
+  }
+} // namespace
+
+BENCH_CASE(Matrix_Multiply) {
+  Matrix a = Matrix::MakeRotationX(0.5f);
+  Matrix b = Matrix::MakeTranslation(1.0f, 2.0f, 3.0f);
+  while (state.KeepRunning()) {
+    Matrix c = Matrix::Multiply(a, b);
+    bench::DoNotOptimize(c);
+  }
+}
+
+BENCH_CASE(Mat4_Multiply) {
+  Mat4 a = Mat4::MakeRotationX(0.5f);
+  Mat4 b = Mat4::MakeTranslation(1.0f, 2.0f, 3.0f);
+  while (state.KeepRunning()) {
+    bench::DoNotOptimize(a);
+    Mat4 c = Mat4::Multiply(a, b);
+    bench::DoNotOptimize(c);
+  }
+}
+
+BENCH_CASE(Transform_ComposeLocal) {
+  VecThree position = {1.0f, 2.0f, 8.0f};
+  VecThree rotation = {30.0f, 45.0f, 10.0f};
+  while (state.KeepRunning()) {
+    bench::DoNotOptimize(rotation);
+    Mat4 local = TransformHierarchy::ComposeLocal(position, rotation, 1.0f);
+    bench::DoNotOptimize(local);
+  }
+}
+
+namespace {
+  // Arg() nodes as roots with four children each, as a scene of small rigs.
+  void MakeRigs(TransformHierarchy& transforms, std::vector<TransformId>& roots, int64_t count) {
+    for (int64_t i = 0; i < count; i += 5) {
+      TransformId root = transforms.Create();
+      transforms.SetPosition(root, {(float)i, 0.0f, 8.0f});
+      roots.push_back(root);
+      for (int c = 0; c < 4 && i + 1 + c < count; ++c) {
+        TransformId child = transforms.Create(root);
+        transforms.SetPosition(child, {0.0f, (float)c, 0.0f});
+      }
+    }
+    transforms.Update();
+  }
+} // namespace
+
+// Nothing moved: the per-frame cost of a static scene.
+BENCH_CASE(Transform_UpdateStatic, 10000, 50000) {
+  TransformHierarchy transforms;
+  std::vector<TransformId> roots;
+  MakeRigs(transforms, roots, state.Arg());
+  while (state.KeepRunning()) {
+    transforms.Update();
+    bench::DoNotOptimize(transforms.GetWorldMatrices()[0]);
+  }
+  state.SetItemsPerOp(state.Arg());
+}
+
+// Every root rotates, so every local and world matrix is rebuilt.
+BENCH_CASE(Transform_UpdateAll, 10000, 50000) {
+  TransformHierarchy transforms;
+  std::vector<TransformId> roots;
+  MakeRigs(transforms, roots, state.Arg());
+  float angle = 0.0f;
+  while (state.KeepRunning()) {
+    angle += 1.0f;
+    for (TransformId root : roots)
+      transforms.SetRotation(root, {0.0f, angle, 0.0f});
+    transforms.Update();
+    bench::DoNotOptimize(transforms.GetWorldMatrices()[0]);
+  }
+  state.SetItemsPerOp(state.Arg());
+}
+
+// One rig in a hundred moves.
+BENCH_CASE(Transform_UpdateSparse, 10000, 50000) {
+  TransformHierarchy transforms;
+  std::vector<TransformId> roots;
+  MakeRigs(transforms, roots, state.Arg());
+  float angle = 0.0f;
+  while (state.KeepRunning()) {
+    angle += 1.0f;
+    for (size_t i = 0; i < roots.size(); i += 100)
+      transforms.SetRotation(roots[i], {0.0f, angle, 0.0f});
+    transforms.Update();
+    bench::DoNotOptimize(transforms.GetWorldMatrices()[0]);
+  }
+  state.SetItemsPerOp(state.Arg());
+}
+
+// One vertex at a time, as the original per-triangle render loop did.
+BENCH_CASE(Mathematics_ProjectToScreen, 1024) {
+  Mesh mesh;
+  MakeCubeRow(mesh, state.Arg());
+  const size_t count = mesh.VertexCount();
+  std::vector<VecThree> in(count), out(count);
+  for (size_t i = 0; i < count; ++i)
+    in[i] = mesh.vertices.Get(i);
+  Mat4 mat = MakeTestTransform();
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < count; ++i)
+      mathematics::ProjectToScreen(in[i], out[i], mat, 800, 600);
+    bench::DoNotOptimize(out[0]);
+  }
+  state.SetItemsPerOp((int64_t)count);
+}
+
+BENCH_CASE(Mathematics_ProjectToScreenBatch, 1024, 65536) {
+  Mesh mesh;
+  MakeCubeRow(mesh, state.Arg());
+  VertexBuffer out;
+  Mat4 mat = MakeTestTransform();
+  while (state.KeepRunning()) {
+    mathematics::ProjectToScreenBatch(mesh.vertices, out, mat, 800, 600);
+    bench::DoNotOptimize(out.x[0]);
+  }
+  state.SetItemsPerOp((int64_t)mesh.VertexCount());
+}
+
+// Mesh::ApplyMatrix through its public RotateY entry point.
+BENCH_CASE(Mesh_ApplyMatrix, 1024, 65536) {
+  Mesh mesh;
+  MakeCubeRow(mesh, state.Arg());
+  while (state.KeepRunning()) {
+    mesh.RotateY(1.0f);
+    bench::DoNotOptimize(mesh.vertices.x[0]);
+  }
+  state.SetItemsPerOp((int64_t)mesh.VertexCount());
+}
+
+// Forsyth reordering of a sphere of about 2 * Arg()^2 triangles, from its build order.
+BENCH_CASE(Mesh_OptimizeVertexCache, 32, 128) {
+  Mesh sphere;
+  primitives::AddSphereToMesh(sphere, 0.0f, 0.0f, 0.0f, 1.0f, (int)state.Arg());
+  std::vector<uint32_t> indices;
+  while (state.KeepRunning()) {
+    indices = sphere.indices;
+    meshopt::OptimizeVertexCache(indices.data(), indices.size(), sphere.VertexCount());
+    bench::DoNotOptimize(indices[0]);
+  }
+  state.SetItemsPerOp((int64_t)sphere.TriangleCount());
+}
+
+// Dispatch overhead: a ParallelFor over Arg() trivial items on every hardware thread.
+BENCH_CASE(Jobs_ParallelFor, 1024, 65536) {
+  JobSystem jobs;
+  jobs.Start();
+  std::vector<float> values((size_t)state.Arg(), 1.0f);
+  while (state.KeepRunning()) {
+    jobs.ParallelFor(0, values.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        values[i] *= 1.0001f;
+    });
+    bench::DoNotOptimize(values[0]);
+  }
+  state.SetItemsPerOp(state.Arg());
+}
+
+// More single-item chunks than a thread's job ring holds; ParallelFor coarsens the grain
+// rather than reusing the slots of jobs still in flight.
+BENCH_CASE(Jobs_ParallelForFineGrain, 8000, 20000) {
+  JobSystem jobs;
+  jobs.Start(4);
+  std::vector<float> values((size_t)state.Arg(), 1.0f);
+  while (state.KeepRunning()) {
+    jobs.ParallelFor(
+      0, values.size(),
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+          values[i] *= 1.0001f;
+      },
+      1);
+    bench::DoNotOptimize(values[0]);
+  }
+  state.SetItemsPerOp(state.Arg());
+}
+
+// Create, run and wait on one empty job.
+BENCH_CASE(Jobs_RunWait) {
+  JobSystem jobs;
+  jobs.Start();
+  while (state.KeepRunning()) {
+    JobSystem::Job* job = jobs.Create([] {});
+    jobs.Run(job);
+    jobs.Wait(job);
+  }
+}
+
+// A typical busy frame of input: 16 key events queued, then drained.
+BENCH_CASE(Input_QueueFrame) {
+  InputQueue queue;
+  InputEvent event;
+  while (state.KeepRunning()) {
+    for (int i = 0; i < 16; ++i)
+      queue.Push({(i & 1) ? InputEvent::Type::KeyUp : InputEvent::Type::KeyDown, 65 + i / 2,
+                  0.0});
+    while (queue.Pop(event))
+      bench::DoNotOptimize(event.key);
+  }
+  state.SetItemsPerOp(16);
+}
+
+// Cost of one ENGINE_PROFILE_ZONE, drained every 1024 zones like EndFrame() would be.
+BENCH_CASE(Profiler_Zone) {
+  int64_t n = 0;
+  while (state.KeepRunning()) {
+    {
+      ENGINE_PROFILE_ZONE("BenchZone");
+    }
+    if ((++n & 1023) == 0)
+      profiler::EndFrame();
+  }
+}
@@ -0,0 +1,165 @@
+// Steady-state heap allocation check.
+//
+// Usage: FrameAllocCheck [frames] [workers]
+//
+// Runs a headless scene of spinning cubes (scene update on the job pool, frustum culling,
+// wireframe and filled meshes, key input, a per-frame draw list in the frame arena) and
+// counts calls to the global operator new over frames frames (1000 by default) after a
+// warm-up. Exits non-zero if any frame allocated. The pool runs 4 threads by default
+// whatever the machine, so work reaches threads and zones first seen after the warm-up.
+#include "arena.h"
+#include "engine.h"
+#include "primitives.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace {
+  std::atomic<bool> g_bCounting{false};
+  std::atomic<uint64_t> g_nAllocations{0};
+
+  void* CountedAllocate(size_t size) {
+    if (g_bCounting.load(std::memory_order_relaxed))
+      g_nAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+      return p;
+    throw std::bad_alloc();
+  }
+
+  void* CountedAllocate(size_t size, std::align_val_t alignment) {
+    if (g_bCounting.load(std::memory_order_relaxed))
+      g_nAllocations.fetch_add(1, std::memory_order_relaxed);
+    size_t align = std::max(sizeof(void*), (size_t)alignment);
+    void* p = nullptr;
+    if (posix_memalign(&p, align, size ? size : 1) != 0)
+      throw std::bad_alloc();
+    return p;
+  }
+
+  const int WARMUP_FRAMES = 60;
+  const int DEFAULT_WORKERS = 4;
+  const int GRID = 6;
+
+  class CubeField : public Engine {
+    public:
+    explicit CubeField(int nFrames) : m_nMeasuredFrames(nFrames) {}
+
+    protected:
+    bool OnCreate() override {
+      primitives::AddCubeToMesh(m_cube, -0.5f, -0.5f, -0.5f);
+      for (int z = 0; z < GRID; ++z) {
+        for (int x = 0; x < GRID; ++x) {
+          TransformId t = m_scene.transforms.Create();
+          m_scene.transforms.SetPosition(t, {(x - GRID / 2) * 1.5f, 0.0f, 6.0f + z * 1.5f});
+          m_scene.Add(&m_cube, t);
+        }
+      }
+      float fAspectRatio = (float)GetScreenWidth() / (float)GetScreenHeight();
+      m_projection = Mat4::MakeProjection(90.0f, fAspectRatio, 0.1f, 100.0f);
+      SetCullMode(Clipper::CullMode::CCW);
+      m_vVisible.reserve(m_scene.ObjectCapacity());
+      return true;
+    }
+
+    bool OnUpdate(float deltaT) override {
+      if (m_nFrame == WARMUP_FRAMES)
+        g_bCounting = true;
+      if (m_nFrame == WARMUP_FRAMES + m_nMeasuredFrames) {
+        g_bCounting = false;
+        return false;
+      }
+      ++m_nFrame;
+
+      QueueInputEvent({m_nFrame % 2 ? InputEvent::Type::KeyDown : InputEvent::Type::KeyUp,
+                       'W', (double)m_nFrame});
+      Clear();
+
+      TransformHierarchy& transforms = m_scene.transforms;
+      for (ObjectId id = 0; id < (ObjectId)m_scene.ObjectCapacity(); ++id) {
+        TransformId t = m_scene.GetObject(id).transform;
+        VecThree rotation = transforms.GetRotation(t);
+        rotation.y += (40.0f + id) * deltaT;
+        rotation.x += 25.0f * deltaT;
+        transforms.SetRotation(t, rotation);
+      }
+      m_scene.Update(&GetJobs());
+
+      m_vVisible.clear();
+      m_scene.Cull(Frustum::FromMatrix(m_projection), m_vVisible);
+
+      // Front to back, in a draw list that lives for this frame only
+      struct Draw {
+        float depth;
+        ObjectId id;
+      };
+      FrameVector<Draw> draws{ArenaAllocator<Draw>(GetFrameArena())};
+      draws.reserve(m_vVisible.size());
+      for (ObjectId id : m_vVisible)
+        draws.push_back({m_scene.GetWorldBounds(id).Center().z, id});
+      std::sort(draws.begin(), draws.end(),
+                [](const Draw& a, const Draw& b) { return a.depth < b.depth; });
+
+      for (const Draw& draw : draws) {
+        const Object& obj = m_scene.GetObject(draw.id);
+        Mat4 matFinal = Mat4::Multiply(transforms.GetWorldMatrix(obj.transform), m_projection);
+        if (draw.id % 2)
+          FillMesh(*obj.meshAsset, matFinal, Color::Green);
+        else
+          DrawMesh(*obj.meshAsset, matFinal, Color::White);
+      }
+      return true;
+    }
+
+    private:
+    int m_nMeasuredFrames;
+    int m_nFrame = 0;
+    Mesh m_cube;
+    Scene m_scene;
+    std::vector<ObjectId> m_vVisible;
+    Mat4 m_projection;
+  };
+} // namespace
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) {
+  return CountedAllocate(size, alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return CountedAllocate(size, alignment);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+  int nFrames = argc > 1 ? std::atoi(argv[1]) : 1000;
+  int nWorkers = argc > 2 ? std::atoi(argv[2]) : DEFAULT_WORKERS;
+
+  CubeField app(nFrames);
+  app.SetHeadlessFrameCount(WARMUP_FRAMES + nFrames + 1);
+  app.SetWorkerCount(nWorkers);
+  if (!app.Initialize(320, 240, "FrameAllocCheck", Engine::Backend::Headless)) {
+    std::fprintf(stderr, "Failed to initialize engine\n");
+    return 1;
+  }
+  app.Run();
+
+  uint64_t nAllocations = g_nAllocations.load();
+  FrameArena::Stats arena = app.GetFrameArenaStats();
+  std::printf("%d frames on %d threads: %llu heap allocations\n", nFrames,
+              app.GetJobs().GetThreadCount(), (unsigned long long)nAllocations);
+  std::printf("Frame arenas: %zu bytes capacity, %zu bytes high water, %zu block allocations\n",
+              arena.nCapacity, arena.nHighWater, arena.nBlockAllocations);
+  return nAllocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,339 @@
+#include "harness.h"
+
+#include "simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+namespace bench {
+  std::vector<Case>& Registry() {
+    static std::vector<Case> cases;
+    return cases;
+  }
+
+  int Register(const char* sName, CaseFn fn, std::vector<int64_t> args) {
+    // Identifiers cannot contain '/', so Group_Case is shown as Group/Case.
+    std::string sDisplay = sName;
+    std::replace(sDisplay.begin(), sDisplay.end(), '_', '/');
+    Registry().push_back({sDisplay, std::move(fn), std::move(args)});
+    return (int)Registry().size();
+  }
+
+  void State::Start() {
+    m_bRunning = true;
+    m_start = Clock::now();
+  }
+
+  void State::Stop() {
+    if (m_bRunning)
+      m_fElapsed = std::chrono::duration<double>(Clock::now() - m_start).count();
+    m_bRunning = false;
+  }
+} // namespace bench
+
+namespace {
+  struct Options {
+    std::string sFilter;
+    int nRepetitions = 20;
+    double fSampleMs = 5.0;
+    double fWarmupMs = 50.0;
+    std::string sJsonPath;
+    std::string sBaselinePath;
+    double fThresholdPct = 5.0;
+    bool bList = false;
+  };
+
+  struct Result {
+    std::string sName;
+    int64_t nIterations = 0; // per sample
+    int nRepetitions = 0;
+    double minNs = 0, meanNs = 0, medianNs = 0, p90Ns = 0, p99Ns = 0, maxNs = 0, stddevNs = 0;
+    double itemsPerSecond = 0; // at the median, 0 when the case reports no items
+  };
+
+  // Warm-up stops growing the iteration count here even if batches stay too short to
+  // calibrate against, such as for a loop the compiler removed.
+  const int64_t MAX_WARMUP_ITERATIONS = (int64_t)1 << 32;
+
+  // Runs nIterations iterations and sets the seconds spent in the timed loop. False if the
+  // case returned before KeepRunning() did.
+  bool RunSample(const bench::Case& c, int64_t arg, int64_t nIterations, int64_t& nItems,
+                 double& seconds) {
+    bench::State state(nIterations, arg);
+    c.fn(state);
+    nItems = state.GetItemsPerOp();
+    seconds = state.GetElapsedSeconds();
+    return state.IsFinished();
+  }
+
+  // Linear interpolation between the closest ranks of a sorted sample set.
+  double Percentile(const std::vector<double>& sorted, double p) {
+    double rank = p * (double)(sorted.size() - 1);
+    size_t lo = (size_t)rank;
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (rank - (double)lo);
+  }
+
+  // False if the case does not run its KeepRunning() loop to the end, which would leave
+  // nothing to time.
+  bool Measure(const bench::Case& c, int64_t arg, const std::string& sName, const Options& opt,
+               Result& r) {
+    int64_t nItems = 0;
+
+    // Warm up caches, branch predictors and lazily built state, doubling the iteration
+    // count until one batch is long enough to calibrate against.
+    int64_t nIterations = 1;
+    double elapsed = 0.0, warmed = 0.0;
+    while (true) {
+      if (!RunSample(c, arg, nIterations, nItems, elapsed))
+        return false;
+      warmed += elapsed;
+      if (warmed * 1e3 >= opt.fWarmupMs &&
+          (elapsed * 1e3 >= opt.fSampleMs * 0.1 || nIterations >= MAX_WARMUP_ITERATIONS))
+        break;
+      if (elapsed * 1e3 < opt.fSampleMs && nIterations < MAX_WARMUP_ITERATIONS)
+        nIterations *= 2;
+    }
+    double perOp = elapsed / (double)nIterations;
+    nIterations = perOp > 0.0 ? std::max<int64_t>(1, (int64_t)(opt.fSampleMs * 1e-3 / perOp))
+                              : MAX_WARMUP_ITERATIONS;
+
+    std::vector<double> samples(opt.nRepetitions);
+    for (double& sample : samples) {
+      if (!RunSample(c, arg, nIterations, nItems, sample))
+        return false;
+      sample *= 1e9 / (double)nIterations;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    r.sName = sName;
+    r.nIterations = nIterations;
+    r.nRepetitions = opt.nRepetitions;
+    r.minNs = samples.front();
+    r.maxNs = samples.back();
+    r.medianNs = Percentile(samples, 0.5);
+    r.p90Ns = Percentile(samples, 0.9);
+    r.p99Ns = Percentile(samples, 0.99);
+    for (double s : samples)
+      r.meanNs += s;
+    r.meanNs /= (double)samples.size();
+    for (double s : samples)
+      r.stddevNs += (s - r.meanNs) * (s - r.meanNs);
+    r.stddevNs = std::sqrt(r.stddevNs / (double)samples.size());
+    if (nItems > 0)
+      r.itemsPerSecond = (double)nItems * 1e9 / r.medianNs;
+    return true;
+  }
+
+  const char* SimdLevel() {
+#if defined(ENGINE_SIMD_AVX2)
+    return "AVX2";
+#elif defined(ENGINE_SIMD_AVX)
+    return "AVX";
+#elif defined(ENGINE_SIMD_SSE)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+  }
+
+  const char* Compiler() {
+#if defined(__clang__) || defined(__GNUC__)
+    return __VERSION__;
+#elif defined(_MSC_VER)
+    return "MSVC";
+#else
+    return "unknown";
+#endif
+  }
+
+  // One benchmark per line, so ReadBaseline() can read files back without a JSON parser.
+  bool WriteJson(const std::string& sPath, const std::vector<Result>& results,
+                 const Options& opt) {
+    std::ofstream out(sPath);
+    if (!out)
+      return false;
+    char line[512];
+    out << "{\n  \"context\": {\"compiler\": \"" << Compiler() << "\", \"simd\": \""
+        << SimdLevel() << "\", \"assertions\": "
+#if defined(NDEBUG)
+        << "false"
+#else
+        << "true"
+#endif
+        << ", \"repetitions\": " << opt.nRepetitions << ", \"sample_ms\": " << opt.fSampleMs
+        << "},\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+      const Result& r = results[i];
+      std::snprintf(line, sizeof(line),
+                    "    {\"name\": \"%s\", \"iterations\": %lld, \"repetitions\": %d, "
+                    "\"ns_per_op\": {\"min\": %.3f, \"mean\": %.3f, \"median\": %.3f, "
+                    "\"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"stddev\": %.3f}, "
+                    "\"items_per_second\": %.1f}%s\n",
+                    r.sName.c_str(), (long long)r.nIterations, r.nRepetitions, r.minNs,
+                    r.meanNs, r.medianNs, r.p90Ns, r.p99Ns, r.maxNs, r.stddevNs,
+                    r.itemsPerSecond, i + 1 < results.size() ? "," : "");
+      out << line;
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+  }
+
+  // Median ns/op by name from a file written by WriteJson.
+  bool ReadBaseline(const std::string& sPath, std::map<std::string, double>& medians) {
+    std::ifstream in(sPath);
+    if (!in)
+      return false;
+    std::string line;
+    while (std::getline(in, line)) {
+      const char* name = std::strstr(line.c_str(), "\"name\": \"");
+      const char* median = std::strstr(line.c_str(), "\"median\": ");
+      if (!name || !median)
+        continue;
+      name += std::strlen("\"name\": \"");
+      const char* nameEnd = std::strchr(name, '"');
+      if (!nameEnd)
+        continue;
+      medians[std::string(name, nameEnd)] = std::atof(median + std::strlen("\"median\": "));
+    }
+    return true;
+  }
+
+  void PrintUsage(const char* argv0) {
+    std::printf("Usage: %s [options]\n"
+                "  --filter <text>      run cases whose name contains text\n"
+                "  --repetitions <n>    samples per case (default 20)\n"
+                "  --sample-ms <ms>     target duration of one sample (default 5)\n"
+                "  --warmup-ms <ms>     warm-up time per case (default 50)\n"
+                "  --json <file>        write results as JSON\n"
+                "  --baseline <file>    compare medians with an earlier --json run\n"
+                "  --threshold <pct>    slowdown reported as a regression (default 5)\n"
+                "  --list               list case names and exit\n",
+                argv0);
+  }
+
+  bool ParseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      bool bHasValue = i + 1 < argc;
+      if (arg == "--list") {
+        opt.bList = true;
+      } else if (arg == "--filter" && bHasValue) {
+        opt.sFilter = argv[++i];
+      } else if (arg == "--repetitions" && bHasValue) {
+        opt.nRepetitions = std::max(1, std::atoi(argv[++i]));
+      } else if (arg == "--sample-ms" && bHasValue) {
+        opt.fSampleMs = std::max(0.01, std::atof(argv[++i]));
+      } else if (arg == "--warmup-ms" && bHasValue) {
+        opt.fWarmupMs = std::max(0.0, std::atof(argv[++i]));
+      } else if (arg == "--json" && bHasValue) {
+        opt.sJsonPath = argv[++i];
+      } else if (arg == "--baseline" && bHasValue) {
+        opt.sBaselinePath = argv[++i];
+      } else if (arg == "--threshold" && bHasValue) {
+        opt.fThresholdPct = std::atof(argv[++i]);
+      } else {
+        PrintUsage(argv[0]);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::string FormatRate(double perSecond) {
+    const char* units[] = {"", "k", "M", "G"};
+    int unit = 0;
+    while (perSecond >= 1000.0 && unit < 3) {
+      perSecond /= 1000.0;
+      ++unit;
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.2f%s/s", perSecond, units[unit]);
+    return text;
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!ParseOptions(argc, argv, opt))
+    return 1;
+
+  std::vector<std::pair<std::string, int64_t>> runs; // name, arg
+  std::vector<const bench::Case*> runCases;
+  for (const bench::Case& c : bench::Registry()) {
+    std::vector<int64_t> args = c.args.empty() ? std::vector<int64_t>{0} : c.args;
+    for (int64_t arg : args) {
+      std::string sName = c.sName;
+      if (!c.args.empty())
+        sName += "/" + std::to_string(arg);
+      if (sName.find(opt.sFilter) == std::string::npos)
+        continue;
+      runs.push_back({sName, arg});
+      runCases.push_back(&c);
+    }
+  }
+
+  if (opt.bList) {
+    for (const auto& run : runs)
+      std::printf("%s\n", run.first.c_str());
+    return 0;
+  }
+
+  std::map<std::string, double> baseline;
+  if (!opt.sBaselinePath.empty() && !ReadBaseline(opt.sBaselinePath, baseline)) {
+    std::fprintf(stderr, "cannot read baseline %s\n", opt.sBaselinePath.c_str());
+    return 1;
+  }
+
+#if !defined(NDEBUG)
+  std::printf("warning: assertions are enabled; timings are not representative\n");
+#endif
+  std::printf("%-36s %10s %11s %11s %11s %11s %12s%s\n", "case", "iters", "min ns", "median ns",
+              "p90 ns", "p99 ns", "items", baseline.empty() ? "" : "   vs base");
+
+  std::vector<Result> results;
+  int nRegressions = 0;
+  int nFailures = 0;
+  for (size_t i = 0; i < runs.size(); ++i) {
+    Result r;
+    if (!Measure(*runCases[i], runs[i].second, runs[i].first, opt, r)) {
+      std::fprintf(stderr, "%s: returned before KeepRunning() returned false\n",
+                   runs[i].first.c_str());
+      ++nFailures;
+      continue;
+    }
+    results.push_back(r);
+
+    std::string sItems = r.itemsPerSecond > 0 ? FormatRate(r.itemsPerSecond) : "-";
+    std::printf("%-36s %10lld %11.1f %11.1f %11.1f %11.1f %12s", r.sName.c_str(),
+                (long long)r.nIterations, r.minNs, r.medianNs, r.p90Ns, r.p99Ns, sItems.c_str());
+    auto base = baseline.find(r.sName);
+    if (base != baseline.end() && base->second > 0.0) {
+      double deltaPct = (r.medianNs / base->second - 1.0) * 100.0;
+      bool bRegressed = deltaPct > opt.fThresholdPct;
+      nRegressions += bRegressed ? 1 : 0;
+      std::printf(" %+8.1f%%%s", deltaPct, bRegressed ? "  REGRESSION" : "");
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+
+  if (!opt.sJsonPath.empty() && !WriteJson(opt.sJsonPath, results, opt)) {
+    std::fprintf(stderr, "cannot write %s\n", opt.sJsonPath.c_str());
+    return 1;
+  }
+  if (nFailures > 0)
+    return 1;
+  if (nRegressions > 0) {
+    std::printf("%d case(s) slower than the baseline by more than %.1f%%\n", nRegressions,
+                opt.fThresholdPct);
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal in-tree microbenchmark harness.
+//
+// A case is a function taking a State and running its body while KeepRunning() returns
+// true; only that loop is timed, so setup before it is free. The runner warms each case
+// up, calibrates an iteration count so one sample lasts about --sample-ms, then records
+// --repetitions samples and reports ns/op percentiles and items/s. Cases registered with
+// several arguments run once per argument, named "<name>/<arg>"; an underscore in the
+// case name is shown as '/', so Mat4_Multiply reports as Mat4/Multiply. A case must run
+// its loop until KeepRunning() returns false; one that returns earlier fails the run.
+//
+//   BENCH_CASE(MyCase, 16, 256) {
+//     Setup(state.Arg());
+//     while (state.KeepRunning())
+//       bench::DoNotOptimize(Work());
+//     state.SetItemsPerOp(state.Arg());
+//   }
+namespace bench {
+  class State {
+    public:
+    State(int64_t nIterations, int64_t arg) : m_nRemaining(nIterations), m_nArg(arg) {}
+
+    // The clock starts at the first call and stops when this returns false.
+    bool KeepRunning() {
+      if (m_nRemaining > 0) {
+        --m_nRemaining;
+        if (!m_bRunning)
+          Start();
+        return true;
+      }
+      Stop();
+      m_bFinished = true;
+      return false;
+    }
+
+    // Whether KeepRunning() has returned false, i.e. the case ran its loop to the end.
+    bool IsFinished() const { return m_bFinished; }
+
+    double GetElapsedSeconds() const { return m_fElapsed; }
+
+    int64_t Arg() const { return m_nArg; }
+
+    // Items (vertices, pixels, triangles...) handled by one iteration; enables items/s.
+    void SetItemsPerOp(int64_t nItems) { m_nItemsPerOp = nItems; }
+    int64_t GetItemsPerOp() const { return m_nItemsPerOp; }
+
+    private:
+    using Clock = std::chrono::steady_clock;
+
+    void Start();
+    void Stop();
+
+    int64_t m_nRemaining;
+    int64_t m_nArg;
+    int64_t m_nItemsPerOp = 0;
+    bool m_bRunning = false;
+    bool m_bFinished = false;
+    Clock::time_point m_start;
+    double m_fElapsed = 0.0;
+  };
+
+  using CaseFn = std::function<void(State&)>;
+
+  struct Case {
+    std::string sName;
+    CaseFn fn;
+    std::vector<int64_t> args; // empty: run once without an argument
+  };
+
+  std::vector<Case>& Registry();
+  int Register(const char* sName, CaseFn fn, std::vector<int64_t> args = {});
+
+  // Keeps the compiler from discarding a computed value or the stores leading to it.
+  template <typename T>
+  inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+  }
+} // namespace bench
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+// Defines and registers a case; optional trailing arguments are the values of Arg().
+#define BENCH_CASE(name, ...)                                                                 \
+  static void BENCH_CONCAT(BenchCase_, name)(bench::State & state);                          \
+  static const int BENCH_CONCAT(s_nBenchCase_, name) =                                       \
+    bench::Register(#name, BENCH_CONCAT(BenchCase_, name), std::vector<int64_t>{__VA_ARGS__}); \
+  static void BENCH_CONCAT(BenchCase_, name)(bench::State & state)
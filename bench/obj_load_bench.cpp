@@ -0,0 +1,153 @@
+// OBJ loader throughput benchmark.
+//
+// Usage: ObjLoadBench [file.obj] [iterations]
+//
+// Without a file, a synthetic grid mesh (positions, texture coordinates, normals and quad
+// faces in every index form) is generated and written to a temporary file. Reports MB/s
+// for single-threaded and fully parallel parsing and the end-to-end memory-mapped load,
+// then the time to open the same mesh from a binary mesh cache instead.
+#include "meshcache.h"
+#include "objloader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+namespace {
+  std::string MakeSyntheticObj(int gridSize) {
+    std::string obj;
+    obj.reserve((size_t)gridSize * gridSize * 120);
+    char line[160];
+    for (int z = 0; z <= gridSize; ++z) {
+      for (int x = 0; x <= gridSize; ++x) {
+        float h = 0.25f * (float)((x * 7 + z * 13) % 17) / 17.0f;
+        std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn 0.0 1.0 0.0\n",
+                      x * 0.1f, h, z * 0.1f, (float)x / gridSize, (float)z / gridSize);
+        obj += line;
+      }
+    }
+    const int stride = gridSize + 1;
+    const int nVertices = stride * stride;
+    for (int z = 0; z < gridSize; ++z) {
+      for (int x = 0; x < gridSize; ++x) {
+        int a = z * stride + x + 1;
+        int b = a + 1;
+        int c = a + stride + 1;
+        int d = a + stride;
+        // Alternate between absolute v/vt/vn, v//vn, plain v and relative v faces.
+        switch ((x + z) % 4) {
+          case 0:
+            std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a,
+                          b, b, b, c, c, c, d, d, d);
+            break;
+          case 1:
+            std::snprintf(line, sizeof(line), "f %d//%d %d//%d %d//%d %d//%d\n", a, a, b, b, c,
+                          c, d, d);
+            break;
+          case 2:
+            std::snprintf(line, sizeof(line), "f %d %d %d %d\n", a, b, c, d);
+            break;
+          default:
+            std::snprintf(line, sizeof(line), "f %d %d %d %d\n", a - nVertices - 1,
+                          b - nVertices - 1, c - nVertices - 1, d - nVertices - 1);
+            break;
+        }
+        obj += line;
+      }
+    }
+    return obj;
+  }
+
+  template <typename Fn>
+  double BestSeconds(int iterations, Fn&& fn) {
+    double best = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      if (!fn()) {
+        std::fprintf(stderr, "parse failed\n");
+        std::exit(1);
+      }
+      auto end = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best;
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  std::string sFilename = argc > 1 ? argv[1] : "";
+  int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+  int nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+  std::string text;
+  if (sFilename.empty()) {
+    text = MakeSyntheticObj(700);
+    sFilename = (std::filesystem::temp_directory_path() / "objloadbench.obj").string();
+    FILE* file = std::fopen(sFilename.c_str(), "wb");
+    if (!file || std::fwrite(text.data(), 1, text.size(), file) != text.size()) {
+      std::fprintf(stderr, "failed to write %s\n", sFilename.c_str());
+      return 1;
+    }
+    std::fclose(file);
+  } else {
+    objloader::ObjData probe;
+    if (!objloader::LoadFile(sFilename, probe, 1)) {
+      std::fprintf(stderr, "failed to load %s\n", sFilename.c_str());
+      return 1;
+    }
+    FILE* file = std::fopen(sFilename.c_str(), "rb");
+    std::fseek(file, 0, SEEK_END);
+    text.resize((size_t)std::ftell(file));
+    std::fseek(file, 0, SEEK_SET);
+    size_t nRead = std::fread(&text[0], 1, text.size(), file);
+    std::fclose(file);
+    text.resize(nRead);
+  }
+
+  const double megabytes = (double)text.size() / (1024.0 * 1024.0);
+  objloader::ObjData data;
+  objloader::Parse(text.data(), text.size(), data, 1);
+  std::printf("input: %.1f MB, %zu positions, %zu triangles\n", megabytes, data.positions.size(),
+              data.corners.size() / 3);
+
+  double single = BestSeconds(
+    iterations, [&] { return objloader::Parse(text.data(), text.size(), data, 1); });
+  std::printf("parse   1 thread : %8.1f MB/s\n", megabytes / single);
+
+  double parallel = BestSeconds(
+    iterations, [&] { return objloader::Parse(text.data(), text.size(), data, nThreads); });
+  std::printf("parse %3d threads: %8.1f MB/s\n", nThreads, megabytes / parallel);
+
+  double load =
+    BestSeconds(iterations, [&] { return objloader::LoadFile(sFilename, data, nThreads); });
+  std::printf("mmap load        : %8.1f MB/s\n", megabytes / load);
+
+  // Startup paths for a Mesh: parse and weld the OBJ, or map the converted cache.
+  Mesh mesh;
+  double objMesh = BestSeconds(iterations, [&] { return mesh.LoadFromObjectFile(sFilename); });
+  std::printf("OBJ to Mesh      : %8.2f ms\n", objMesh * 1000.0);
+
+  std::string sCache = sFilename + ".mesh";
+  meshcache::MappedMesh cached;
+  std::filesystem::remove(sCache);
+  double convert = BestSeconds(1, [&] { return meshcache::LoadObj(sFilename, cached); });
+  std::printf("cache convert    : %8.2f ms\n", convert * 1000.0);
+
+  double open = BestSeconds(iterations, [&] { return meshcache::LoadObj(sFilename, cached); });
+  std::printf("cache open       : %8.3f ms (%zu vertices, %zu triangles)\n", open * 1000.0,
+              cached.View().nVertices, cached.View().nTriangles);
+
+  double verify = BestSeconds(iterations, [&] { return cached.Open(sCache, true); });
+  std::printf("cache verify     : %8.2f ms\n", verify * 1000.0);
+
+  double copy = BestSeconds(iterations, [&] {
+    cached.CopyTo(mesh);
+    return true;
+  });
+  std::printf("cache to Mesh    : %8.2f ms\n", copy * 1000.0);
+  return 0;
+}
@@ -0,0 +1,331 @@
+// Engine drawing cases and whole frames, rendered through the headless backend.
+#include "harness.h"
+
+#include "engine.h"
+#include "meshlet.h"
+#include "meshopt.h"
+#include "primitives.h"
+#include "scene.h"
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+  const int WIDTH = 800;
+  const int HEIGHT = 600;
+
+  // Exposes the protected drawing API and runs a supplied per-frame callback.
+  class BenchEngine : public Engine {
+    public:
+    using Engine::Clear;
+    using Engine::ClearRect;
+    using Engine::DrawCircle;
+    using Engine::DrawLine;
+    using Engine::DrawMesh;
+    using Engine::DrawSpan;
+    using Engine::DrawTriangle;
+    using Engine::FillCircle;
+    using Engine::FillMesh;
+    using Engine::FillTriangle;
+    using Engine::FlushTriangles;
+
+    std::function<bool(float)> onUpdate;
+
+    explicit BenchEngine(int nFramebuffers = 2) {
+      SetFramebufferCount(nFramebuffers);
+      Initialize(WIDTH, HEIGHT, "Bench", Backend::Headless);
+    }
+
+    protected:
+    bool OnCreate() override { return true; }
+    bool OnUpdate(float deltaT) override { return onUpdate ? onUpdate(deltaT) : true; }
+  };
+
+  struct Segment {
+    int x1, y1, x2, y2, x3, y3;
+  };
+
+  // Deterministic screen-space primitives, partly off screen to exercise clipping.
+  std::vector<Segment> MakeSegments(int count, int extent) {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> offset(-extent, extent);
+    std::uniform_int_distribution<int> cx(-50, WIDTH + 50), cy(-50, HEIGHT + 50);
+    std::vector<Segment> segments(count);
+    for (Segment& s : segments) {
+      int x = cx(rng), y = cy(rng);
+      s = {x, y, x + offset(rng), y + offset(rng), x + offset(rng), y + offset(rng)};
+    }
+    return segments;
+  }
+
+  // The ThreeEngine demo scene with nCubes spinning cubes on a grid in front of the camera.
+  struct CubeScene {
+    Mesh cube;
+    Scene scene;
+    std::vector<ObjectId> visible;
+    Mat4 projection;
+
+    explicit CubeScene(int nCubes) {
+      primitives::AddCubeToMesh(cube, -0.5f, -0.5f, -0.5f);
+      int side = (int)std::ceil(std::sqrt((float)nCubes));
+      for (int i = 0; i < nCubes; ++i) {
+        TransformId transform = scene.transforms.Create();
+        scene.transforms.SetPosition(transform, {(float)(i % side) * 1.5f - side * 0.75f,
+                                                 (float)(i / side) * 1.5f - side * 0.75f,
+                                                 8.0f + side * 0.75f});
+        scene.transforms.SetRotation(transform, {(float)i * 7.0f, (float)i * 13.0f, 0.0f});
+        scene.Add(&cube, transform);
+      }
+      projection = Mat4::MakeProjection(90.0f, (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+    }
+
+    void Render(BenchEngine& engine, float deltaT, bool bFilled) {
+      engine.Clear();
+      TransformHierarchy& transforms = scene.transforms;
+      for (ObjectId id = 0; id < (ObjectId)scene.ObjectCapacity(); ++id) {
+        TransformId transform = scene.GetObject(id).transform;
+        VecThree rotation = transforms.GetRotation(transform);
+        rotation.y += 60.0f * deltaT;
+        rotation.x += 30.0f * deltaT;
+        transforms.SetRotation(transform, rotation);
+      }
+      scene.Update();
+      visible.clear();
+      scene.Cull(Frustum::FromMatrix(projection), visible);
+      for (ObjectId id : visible) {
+        const Object& obj = scene.GetObject(id);
+        Mat4 matFinal = Mat4::Multiply(transforms.GetWorldMatrix(obj.transform), projection);
+        if (bFilled)
+          engine.FillMesh(*obj.meshAsset, matFinal, Color::Blue);
+        else
+          engine.DrawMesh(*obj.meshAsset, matFinal, Color::White);
+      }
+    }
+  };
+
+  // A sphere of about 2 * rings^2 triangles in cache-optimized order, with its meshlets.
+  struct SphereMesh {
+    Mesh mesh;
+    MeshletMesh meshlets;
+
+    explicit SphereMesh(int nRings) {
+      primitives::AddSphereToMesh(mesh, 0.0f, 0.0f, 0.0f, 1.0f, nRings);
+      meshopt::Optimize(mesh);
+      meshlets = MeshletMesh::Build(mesh.View());
+    }
+  };
+
+  // Draws the sphere a quarter turn further each op, half in view and facing both ways.
+  void RunSphere(bench::State& state, bool bMeshlets) {
+    BenchEngine engine;
+    engine.SetCullMode(Clipper::CullMode::CCW);
+    SphereMesh sphere((int)state.Arg());
+    Mat4 projection = Mat4::MakeProjection(90.0f, (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+    float fAngle = 0.0f;
+    while (state.KeepRunning()) {
+      Mat4 world =
+        Mat4::Multiply(Mat4::MakeRotationY(fAngle), Mat4::MakeTranslation(1.5f, 0.0f, 2.5f));
+      Mat4 transform = Mat4::Multiply(world, projection);
+      if (bMeshlets)
+        engine.FillMesh(sphere.meshlets, transform, Color::Blue);
+      else
+        engine.FillMesh(sphere.mesh, transform, Color::Blue);
+      engine.FlushTriangles();
+      bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+      fAngle += 1.5707963f;
+    }
+    state.SetItemsPerOp((int64_t)sphere.mesh.TriangleCount());
+  }
+
+  void RunFrames(bench::State& state, bool bFilled) {
+    BenchEngine engine;
+    engine.SetCullMode(Clipper::CullMode::CCW);
+    CubeScene scene((int)state.Arg());
+    engine.onUpdate = [&](float deltaT) {
+      scene.Render(engine, deltaT, bFilled);
+      return true;
+    };
+    // One Run() per iteration covers the full frame: input, update, flush and present.
+    engine.SetHeadlessFrameCount(1);
+    while (state.KeepRunning())
+      engine.Run();
+    state.SetItemsPerOp(state.Arg());
+  }
+} // namespace
+
+BENCH_CASE(Engine_Clear) {
+  BenchEngine engine;
+  while (state.KeepRunning()) {
+    engine.Clear();
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp(WIDTH * HEIGHT);
+}
+
+// Depth only, as for a scene that covers every pixel.
+BENCH_CASE(Engine_ClearDepth) {
+  BenchEngine engine;
+  while (state.KeepRunning()) {
+    engine.Clear(Color::Black, Engine::ClearDepth);
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp(WIDTH * HEIGHT);
+}
+
+// A centred square of Arg() pixels per side, cleared row by row.
+BENCH_CASE(Engine_ClearRect, 16, 256) {
+  BenchEngine engine;
+  int size = (int)state.Arg();
+  int x0 = (WIDTH - size) / 2, y0 = (HEIGHT - size) / 2;
+  while (state.KeepRunning()) {
+    engine.ClearRect(x0, y0, x0 + size, y0 + size, Color::Blue);
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp((int64_t)size * size);
+}
+
+// Spans of Arg() pixels, one per row.
+BENCH_CASE(Engine_DrawSpan, 16, 256) {
+  BenchEngine engine;
+  int length = (int)state.Arg();
+  while (state.KeepRunning()) {
+    for (int y = 0; y < HEIGHT; ++y)
+      engine.DrawSpan(y, (y * 7) % (WIDTH - length), (y * 7) % (WIDTH - length) + length,
+                      Color::Green);
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp((int64_t)HEIGHT * length);
+}
+
+BENCH_CASE(Engine_DrawLine, 16, 256) {
+  BenchEngine engine;
+  std::vector<Segment> lines = MakeSegments(256, (int)state.Arg());
+  while (state.KeepRunning()) {
+    for (const Segment& s : lines)
+      engine.DrawLine(s.x1, s.y1, s.x2, s.y2);
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp((int64_t)lines.size());
+}
+
+// Lines Arg() screens long through random on-screen points: clipping keeps the cost at the
+// visible pixels.
+BENCH_CASE(Engine_DrawLineLong, 10, 1000) {
+  BenchEngine engine;
+  std::vector<Segment> lines = MakeSegments(256, 0);
+  int extent = (int)state.Arg() * WIDTH;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    Segment& s = lines[i];
+    int dx = (int)(i % 7) - 3, dy = (int)(i % 5) - 2;
+    s.x2 = s.x1 + dx * extent + 1;
+    s.y2 = s.y1 + dy * extent;
+    s.x1 -= dx * extent;
+    s.y1 -= dy * extent + 1;
+  }
+  while (state.KeepRunning()) {
+    for (const Segment& s : lines)
+      engine.DrawLine(s.x1, s.y1, s.x2, s.y2);
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp((int64_t)lines.size());
+}
+
+BENCH_CASE(Engine_DrawCircle, 16, 128) {
+  BenchEngine engine;
+  std::vector<Segment> centers = MakeSegments(64, 0);
+  while (state.KeepRunning()) {
+    for (const Segment& s : centers)
+      engine.DrawCircle(s.x1, s.y1, (int)state.Arg());
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp((int64_t)centers.size());
+}
+
+BENCH_CASE(Engine_FillCircle, 16, 128) {
+  BenchEngine engine;
+  std::vector<Segment> centers = MakeSegments(64, 0);
+  while (state.KeepRunning()) {
+    for (const Segment& s : centers)
+      engine.FillCircle(s.x1, s.y1, (int)state.Arg());
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp((int64_t)centers.size());
+}
+
+BENCH_CASE(Engine_DrawTriangle, 16, 256) {
+  BenchEngine engine;
+  std::vector<Segment> tris = MakeSegments(256, (int)state.Arg());
+  while (state.KeepRunning()) {
+    for (const Segment& s : tris)
+      engine.DrawTriangle(s.x1, s.y1, s.x2, s.y2, s.x3, s.y3);
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp((int64_t)tris.size());
+}
+
+BENCH_CASE(Engine_FillTriangle, 16, 256) {
+  BenchEngine engine;
+  std::vector<Segment> tris = MakeSegments(256, (int)state.Arg());
+  while (state.KeepRunning()) {
+    for (const Segment& s : tris)
+      engine.FillTriangle(s.x1, s.y1, s.x2, s.y2, s.x3, s.y3);
+    engine.FlushTriangles();
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp((int64_t)tris.size());
+}
+
+// The FillTriangle/256 triangles as a translucent layer: depth tested but not written,
+// blended opaque (0), alpha (1) or additive (2).
+BENCH_CASE(Engine_FillTriangleBlend, 0, 1, 2) {
+  BenchEngine engine;
+  std::vector<Segment> tris = MakeSegments(256, 256);
+  RenderState renderState;
+  renderState.blend = (BlendMode)state.Arg();
+  renderState.bDepthWrite = false;
+  engine.SetRenderState(renderState);
+  Color color = Color::Red;
+  color.a = 96;
+  while (state.KeepRunning()) {
+    for (const Segment& s : tris)
+      engine.FillTriangle(s.x1, s.y1, s.x2, s.y2, s.x3, s.y3, color);
+    engine.FlushTriangles();
+    bench::DoNotOptimize(engine.GetFramebuffer()[0]);
+  }
+  state.SetItemsPerOp((int64_t)tris.size());
+}
+
+// Items are triangles; the Meshlets case skips clusters facing away or off screen.
+BENCH_CASE(Engine_FillMeshSphere, 32, 128) { RunSphere(state, false); }
+
+BENCH_CASE(Engine_FillMeshlets, 32, 128) { RunSphere(state, true); }
+
+// Items are cubes.
+BENCH_CASE(Frame_Wireframe, 1, 64, 1024) { RunFrames(state, false); }
+
+BENCH_CASE(Frame_Filled, 1, 64, 1024) { RunFrames(state, true); }
+
+// 16 filled frames of 64 cubes per iteration, each consumed by a sink that blocks for 1 ms
+// the way a vsynced display or a slow file write would. Arg is the framebuffer count: with
+// 1 the sink stalls every frame, with 2 or 3 it overlaps the next frames. Items are frames.
+BENCH_CASE(Frame_PresentOverlap, 1, 2, 3) {
+  const int FRAMES = 16;
+  BenchEngine engine((int)state.Arg());
+  engine.SetCullMode(Clipper::CullMode::CCW);
+  CubeScene scene(64);
+  engine.onUpdate = [&](float deltaT) {
+    scene.Render(engine, deltaT, true);
+    return true;
+  };
+  engine.SetFrameSink([](const Color*, int, int, int) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  engine.SetHeadlessFrameCount(FRAMES);
+  while (state.KeepRunning())
+    engine.Run();
+  state.SetItemsPerOp(FRAMES);
+}
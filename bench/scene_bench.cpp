@@ -0,0 +1,153 @@
+// Scene update and visibility cases.
+#include "harness.h"
+
+#include "lod.h"
+#include "occlusion.h"
+#include "primitives.h"
+#include "scene.h"
+
+#include <random>
+#include <vector>
+
+namespace {
+  // count cubes scattered over a 2 km square at ground level, with a camera at the origin
+  // looking down +z through a 30 degree field of view, so only a sliver is visible.
+  struct ScatterScene {
+    Mesh cube;
+    Scene scene;
+    std::vector<TransformId> transforms;
+    Frustum frustum;
+
+    explicit ScatterScene(int64_t count) {
+      primitives::AddCubeToMesh(cube, -0.5f, -0.5f, -0.5f);
+      std::mt19937 rng(7);
+      std::uniform_real_distribution<float> coord(-1000.0f, 1000.0f);
+      for (int64_t i = 0; i < count; ++i) {
+        TransformId transform = scene.transforms.Create();
+        scene.transforms.SetPosition(transform, {coord(rng), 0.0f, coord(rng)});
+        scene.Add(&cube, transform);
+        transforms.push_back(transform);
+      }
+      scene.Update();
+      frustum = Frustum::FromMatrix(Mat4::MakeProjection(30.0f, 4.0f / 3.0f, 0.1f, 100.0f));
+    }
+  };
+
+  // A 10 x 10 grid of 10-unit rooms whose walls, all occluders, have a doorway each, with
+  // count small cubes strewn through them, seen from a corner room looking diagonally in.
+  struct InteriorScene {
+    std::vector<Mesh> walls;
+    Mesh cube;
+    Scene scene;
+    Mat4 viewProjection;
+
+    explicit InteriorScene(int64_t count) : walls(2 * 11 * 10) {
+      for (int i = 0; i <= 10; ++i) {
+        for (int j = 0; j < 10; ++j) {
+          Mesh& wallX = walls[(i * 10 + j) * 2];
+          primitives::AddWallX(wallX, j * 10.0f, 0.0f, i * 10.0f, 4, 4);
+          primitives::AddWallX(wallX, j * 10.0f + 6.0f, 0.0f, i * 10.0f, 4, 4);
+          Mesh& wallZ = walls[(i * 10 + j) * 2 + 1];
+          primitives::AddWallZ(wallZ, i * 10.0f, 0.0f, j * 10.0f, 4, 4);
+          primitives::AddWallZ(wallZ, i * 10.0f, 0.0f, j * 10.0f + 6.0f, 4, 4);
+        }
+      }
+      for (Mesh& wall : walls)
+        scene.SetOccluder(scene.Add(&wall, scene.transforms.Create()), &wall);
+
+      primitives::AddCubeToMesh(cube, -0.25f, -0.25f, -0.25f, 0.5f);
+      std::mt19937 rng(7);
+      std::uniform_real_distribution<float> coord(0.5f, 99.5f);
+      for (int64_t i = 0; i < count; ++i) {
+        TransformId transform = scene.transforms.Create();
+        scene.transforms.SetPosition(transform, {coord(rng), 1.5f, coord(rng)});
+        scene.Add(&cube, transform);
+      }
+      scene.Update();
+      Mat4 view = Mat4::Multiply(Mat4::MakeTranslation(-3.0f, -2.0f, -3.0f),
+                                 Mat4::MakeRotationY(0.785f));
+      viewProjection =
+        Mat4::Multiply(view, Mat4::MakeProjection(90.0f, 4.0f / 3.0f, 0.1f, 200.0f));
+    }
+  };
+} // namespace
+
+BENCH_CASE(Scene_Cull, 1000, 100000) {
+  ScatterScene s(state.Arg());
+  std::vector<ObjectId> visible;
+  while (state.KeepRunning()) {
+    visible.clear();
+    s.scene.Cull(s.frustum, visible);
+    bench::DoNotOptimize(visible.data());
+  }
+  state.SetItemsPerOp(state.Arg());
+}
+
+// Nothing moved since the last frame.
+BENCH_CASE(Scene_UpdateStatic, 100000) {
+  ScatterScene s(state.Arg());
+  while (state.KeepRunning())
+    s.scene.Update();
+  state.SetItemsPerOp(state.Arg());
+}
+
+// One object in a hundred drifts each frame, refitting its BVH path.
+BENCH_CASE(Scene_UpdateSparse, 100000) {
+  ScatterScene s(state.Arg());
+  float offset = 0.0f;
+  while (state.KeepRunning()) {
+    offset = offset > 1.0f ? 0.0f : offset + 0.01f;
+    for (size_t i = 0; i < s.transforms.size(); i += 100) {
+      VecThree position = s.scene.transforms.GetPosition(s.transforms[i]);
+      position.y = offset;
+      s.scene.transforms.SetPosition(s.transforms[i], position);
+    }
+    s.scene.Update();
+  }
+  state.SetItemsPerOp(state.Arg() / 100);
+}
+
+BENCH_CASE(Scene_Build, 100000) {
+  ScatterScene s(state.Arg());
+  std::vector<Aabb> bounds;
+  for (ObjectId id = 0; id < (ObjectId)s.scene.ObjectCapacity(); ++id)
+    bounds.push_back(s.scene.GetWorldBounds(id));
+  Bvh bvh;
+  while (state.KeepRunning()) {
+    bvh.Build(bounds.data(), bounds.size());
+    bench::DoNotOptimize(bvh.NodeCount());
+  }
+  state.SetItemsPerOp(state.Arg());
+}
+
+// Every object picks its level of detail from the camera at the origin.
+BENCH_CASE(Scene_SelectLods, 100000) {
+  ScatterScene s(state.Arg());
+  Mesh sphere;
+  primitives::AddSphereToMesh(sphere, 0.0f, 0.0f, 0.0f, 0.5f, 32);
+  LodChain lods = LodChain::Build(sphere);
+  std::vector<ObjectId> ids;
+  for (ObjectId id = 0; id < (ObjectId)s.scene.ObjectCapacity(); ++id) {
+    s.scene.SetLods(id, &lods);
+    ids.push_back(id);
+  }
+  while (state.KeepRunning())
+    s.scene.SelectLods(ids, VecThree(), 30.0f, 720);
+  state.SetItemsPerOp(state.Arg());
+}
+
+// Frustum culling, then the occlusion pass over the survivors.
+BENCH_CASE(Scene_CullOccluded, 10000) {
+  InteriorScene s(state.Arg());
+  OcclusionBuffer buffer;
+  std::vector<ObjectId> visible;
+  size_t nTested = 0;
+  while (state.KeepRunning()) {
+    visible.clear();
+    s.scene.Cull(Frustum::FromMatrix(s.viewProjection), visible);
+    nTested = visible.size();
+    s.scene.CullOccluded(buffer, s.viewProjection, visible);
+    bench::DoNotOptimize(visible.data());
+  }
+  state.SetItemsPerOp((int64_t)nTested);
+}
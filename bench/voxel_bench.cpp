@@ -0,0 +1,56 @@
+// Voxel meshing cases.
+#include "harness.h"
+
+#include "primitives.h"
+#include "voxel.h"
+
+#include <cmath>
+
+namespace {
+  // Rolling heightmap terrain over nChunks x nChunks chunks, one chunk deep.
+  void MakeTerrain(VoxelWorld& world, int nChunks) {
+    int size = nChunks * VoxelChunk::SIZE;
+    for (int x = 0; x < size; ++x) {
+      for (int z = 0; z < size; ++z) {
+        int height = 8 + (int)(6.0f * std::sin(x * 0.2f) + 6.0f * std::cos(z * 0.15f));
+        world.FillBox(x, 0, z, x + 1, height, z + 1);
+      }
+    }
+  }
+} // namespace
+
+// Meshing one chunk of terrain from scratch.
+BENCH_CASE(Voxel_MeshChunk) {
+  VoxelWorld world;
+  MakeTerrain(world, 1);
+  while (state.KeepRunning()) {
+    world.FillBox(0, 0, 0, VoxelChunk::SIZE, 1, VoxelChunk::SIZE);
+    world.Remesh();
+    bench::DoNotOptimize(world.TriangleCount());
+  }
+}
+
+// Toggling one voxel in the middle of an 8x8-chunk level and re-meshing.
+BENCH_CASE(Voxel_EditRemesh) {
+  VoxelWorld world;
+  MakeTerrain(world, 8);
+  world.Remesh();
+  bool bSolid = false;
+  while (state.KeepRunning()) {
+    world.Set(4 * VoxelChunk::SIZE + 5, 20, 4 * VoxelChunk::SIZE + 7, bSolid);
+    bSolid = !bSolid;
+    bench::DoNotOptimize(world.Remesh());
+  }
+}
+
+// A 100x100 floor with walls on two sides, built and meshed as voxels.
+BENCH_CASE(Voxel_BuildLevel) {
+  while (state.KeepRunning()) {
+    VoxelWorld world;
+    primitives::AddFloor(world, 0, 0, 0, 100, 100);
+    primitives::AddWallX(world, 0, 1, 0, 100, 10);
+    primitives::AddWallZ(world, 0, 1, 0, 100, 10);
+    world.Remesh();
+    bench::DoNotOptimize(world.TriangleCount());
+  }
+}
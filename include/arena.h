@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator for data that lives for one frame.
+//
+// Allocate() advances a pointer through the current block; nothing is freed individually,
+// and Reset() makes all of it available again at once. When a frame outgrows the block,
+// further blocks are chained on, and the next Reset() replaces them with one block large
+// enough for the high-water mark, so after warm-up a frame costs no heap allocations.
+class FrameArena {
+  public:
+  struct Stats {
+    size_t nUsed = 0;             // bytes allocated since the last Reset()
+    size_t nCapacity = 0;         // bytes in the current blocks
+    size_t nHighWater = 0;        // most bytes used by any frame so far
+    size_t nBlockAllocations = 0; // heap allocations made for blocks so far
+  };
+
+  explicit FrameArena(size_t nInitialSize = 64 * 1024);
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  // alignment must be a power of two.
+  void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  // Uninitialized storage for count objects of T.
+  template <typename T>
+  T* AllocateArray(size_t count) {
+    return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  // Invalidates everything allocated since the last Reset().
+  void Reset();
+
+  Stats GetStats() const;
+
+  private:
+  struct Block {
+    std::unique_ptr<unsigned char[]> memory;
+    size_t size;
+  };
+
+  void AddBlock(size_t nMinSize);
+
+  std::vector<Block> m_vBlocks;
+  size_t m_nCurrent = 0;    // block being bumped
+  size_t m_nOffset = 0;     // into the current block
+  size_t m_nUsedBefore = 0; // bytes used in the blocks before the current one
+  size_t m_nHighWater = 0;
+  size_t m_nBlockAllocations = 0;
+};
+
+// Standard allocator over a FrameArena, for containers that live within one frame.
+// deallocate() is a no-op: memory comes back at the next Reset().
+template <typename T>
+class ArenaAllocator {
+  public:
+  using value_type = T;
+
+  explicit ArenaAllocator(FrameArena& arena) : m_pArena(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : m_pArena(other.GetArena()) {}
+
+  T* allocate(size_t count) { return m_pArena->AllocateArray<T>(count); }
+  void deallocate(T*, size_t) {}
+
+  FrameArena* GetArena() const { return m_pArena; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return m_pArena == other.GetArena();
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return m_pArena != other.GetArena();
+  }
+
+  private:
+  FrameArena* m_pArena;
+};
+
+// A vector in frame memory: FrameVector<int> v(ArenaAllocator<int>(arena));
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,126 @@
+#pragma once
+#include "color.h"
+#include "simd.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// How a drawn color combines with the framebuffer.
+//
+//   Opaque    dst = src
+//   Alpha     dst = src * src.a + dst * (1 - src.a), every channel alpha included
+//   Additive  dst = min(dst + src * src.a, 1)
+//
+// A cleared bit of the color mask keeps that channel of dst unchanged whatever the mode.
+enum class BlendMode : uint8_t { Opaque, Alpha, Additive };
+
+enum ColorMask : uint8_t {
+  MaskRed = 1 << 0,
+  MaskGreen = 1 << 1,
+  MaskBlue = 1 << 2,
+  MaskAlpha = 1 << 3,
+  MaskAll = 15
+};
+
+// Output state of filled triangles and spans. The defaults draw opaque, depth-tested
+// geometry that writes depth, as before blending existed.
+struct RenderState {
+  BlendMode blend = BlendMode::Opaque;
+  bool bDepthTest = true;  // less-or-equal against the depth buffer
+  bool bDepthWrite = true; // off for translucent layers drawn after the opaque ones
+  uint8_t colorMask = MaskAll;
+
+  // Opaque with every channel written: the source simply replaces dst.
+  bool IsReplace() const { return blend == BlendMode::Opaque && colorMask == MaskAll; }
+};
+
+// Pixel kernels specialized at compile time on the blend mode and on whether a partial
+// color mask applies, so the per-pixel code has no branches on the state. The rasterizer
+// picks the instantiation once per triangle; Span() once per call.
+namespace blend {
+  // One color prepared for a state, computed once per triangle or span.
+  struct Source {
+    uint32_t color = 0;             // Additive: already scaled by alpha
+    uint32_t mask = 0;              // 0xff in the bytes of the channels written
+    uint16_t premultiplied[4] = {}; // Alpha: channel * alpha, 0..65025
+    uint16_t inverseAlpha = 0;      // Alpha: 255 - alpha
+  };
+
+  Source MakeSource(Color color, BlendMode mode, uint8_t colorMask);
+
+  // x / 255 rounded to nearest, exact for 0 <= x <= 65025.
+  inline uint32_t DivideBy255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+  }
+
+  template <BlendMode MODE, bool MASKED>
+  inline uint32_t Apply(uint32_t dst, const Source& src) {
+    uint32_t out;
+    if constexpr (MODE == BlendMode::Opaque) {
+      out = src.color;
+    } else if constexpr (MODE == BlendMode::Alpha) {
+      out = 0;
+      for (int c = 0; c < 4; ++c) {
+        uint32_t d = (dst >> (8 * c)) & 0xff;
+        out |= DivideBy255(src.premultiplied[c] + d * src.inverseAlpha) << (8 * c);
+      }
+    } else {
+      out = 0;
+      for (int c = 0; c < 4; ++c) {
+        uint32_t sum = ((dst >> (8 * c)) & 0xff) + ((src.color >> (8 * c)) & 0xff);
+        out |= (sum > 255 ? 255 : sum) << (8 * c);
+      }
+    }
+    if constexpr (MASKED)
+      out = (out & src.mask) | (dst & ~src.mask);
+    return out;
+  }
+
+#if defined(ENGINE_SIMD_SSE)
+  // Source broadcast to four pixels.
+  struct Source4 {
+    __m128i color;
+    __m128i mask;
+    __m128i premultiplied; // two pixels of 16-bit channels
+    __m128i inverseAlpha;
+
+    explicit Source4(const Source& src) {
+      color = _mm_set1_epi32((int)src.color);
+      mask = _mm_set1_epi32((int)src.mask);
+      const uint16_t* p = src.premultiplied;
+      premultiplied = _mm_setr_epi16((short)p[0], (short)p[1], (short)p[2], (short)p[3],
+                                     (short)p[0], (short)p[1], (short)p[2], (short)p[3]);
+      inverseAlpha = _mm_set1_epi16((short)src.inverseAlpha);
+    }
+  };
+
+  // Four pixels at once; the Alpha mode works on two at a time in 16-bit lanes.
+  template <BlendMode MODE, bool MASKED>
+  inline __m128i Apply(__m128i dst, const Source4& src) {
+    __m128i out;
+    if constexpr (MODE == BlendMode::Opaque) {
+      out = src.color;
+    } else if constexpr (MODE == BlendMode::Alpha) {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i half = _mm_set1_epi16(128);
+      auto blend2 = [&](__m128i d) {
+        __m128i x = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(d, src.inverseAlpha),
+                                                src.premultiplied),
+                                  half);
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+      };
+      out = _mm_packus_epi16(blend2(_mm_unpacklo_epi8(dst, zero)),
+                             blend2(_mm_unpackhi_epi8(dst, zero)));
+    } else {
+      out = _mm_adds_epu8(dst, src.color);
+    }
+    if constexpr (MASKED)
+      out = _mm_or_si128(_mm_and_si128(out, src.mask), _mm_andnot_si128(src.mask, dst));
+    return out;
+  }
+#endif
+
+  // Draws color over count pixels at dst.
+  void Span(Color* dst, size_t count, Color color, BlendMode mode, uint8_t colorMask);
+} // namespace blend
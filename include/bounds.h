@@ -0,0 +1,48 @@
+#pragma once
+#include "matrix.h"
+#include "mesh.h"
+
+// Axis-aligned box. The default box is empty: it contains nothing, and growing it with
+// Expand() and Merge() yields exactly what was added.
+struct Aabb {
+  VecThree min = {1e30f, 1e30f, 1e30f};
+  VecThree max = {-1e30f, -1e30f, -1e30f};
+
+  bool IsEmpty() const { return min.x > max.x; }
+  VecThree Center() const;
+  float SurfaceArea() const; // zero for an empty box
+  float Distance(const VecThree& point) const; // to the nearest point, zero inside
+
+  void Expand(const VecThree& point);
+  void Merge(const Aabb& box);
+
+  // Box enclosing this one after transform, which must be affine.
+  Aabb Transformed(const Mat4& transform) const;
+
+  static Aabb FromMesh(const Mesh& mesh);
+};
+
+struct BoundingSphere {
+  VecThree center;
+  float radius = -1.0f; // negative when empty
+
+  // Sphere about the centre of the mesh's box, reaching its farthest vertex.
+  static BoundingSphere FromMesh(const Mesh& mesh);
+};
+
+// Six inward-facing planes of a view volume, in the space the matrix maps from.
+struct Frustum {
+  struct Plane {
+    float a, b, c, d; // a*x + b*y + c*z + d >= 0 inside
+  };
+  enum PlaneIndex { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+  Plane planes[PlaneCount];
+
+  // Extracts the planes of the clip volume -w <= x, y <= w, 0 <= z <= w of a row-vector
+  // matrix such as Mat4::MakeProjection, or a world-to-clip product ending in one.
+  static Frustum FromMatrix(const Mat4& clip);
+
+  // Conservative: boxes near a frustum corner may pass without touching the volume.
+  bool Intersects(const Aabb& box) const;
+  bool Intersects(const BoundingSphere& sphere) const;
+};
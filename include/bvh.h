@@ -0,0 +1,63 @@
+#pragma once
+#include "bounds.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy over items identified by index, each with an AABB.
+//
+// Build() splits at the median centroid along the widest axis, so the tree is balanced
+// and every subtree covers a contiguous run of items; a query that finds a node wholly
+// inside the frustum appends that run without descending. Refit() moves one item's box
+// and updates its ancestors, which keeps the tree valid but lets it loosen as items
+// travel; GetDegradation() tells when a rebuild would pay off.
+class Bvh {
+  public:
+  static constexpr uint32_t LEAF_SIZE = 4;
+
+  // Builds over boxes[0, count). Items with empty boxes are left out.
+  void Build(const Aabb* boxes, size_t count);
+
+  // Replaces the box of an item and updates the boxes above it; ignored for items left
+  // out of the last build.
+  void Refit(uint32_t item, const Aabb& box);
+
+  // Summed node surface area relative to the last build; 1 when fresh.
+  float GetDegradation() const;
+
+  // Appends the items whose boxes intersect the frustum, in tree order.
+  void Query(const Frustum& frustum, std::vector<uint32_t>& out) const;
+
+  size_t NodeCount() const { return m_vNodes.size(); }
+
+  private:
+  static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+  struct Node {
+    Aabb bounds;
+    uint32_t first; // items [first, first + count) in m_vItems, for the whole subtree
+    uint32_t count;
+    uint32_t left;   // children are left and left + 1; 0 for a leaf
+    uint32_t parent; // NO_NODE for the root
+  };
+
+  std::vector<Node> m_vNodes;
+
+  // Items in tree order with their boxes, and each item's slot there
+  std::vector<uint32_t> m_vItems;
+  std::vector<Aabb> m_vItemBounds;
+  std::vector<uint32_t> m_vSlotOf;
+  std::vector<uint32_t> m_vLeafOf; // per slot
+
+  double m_fBuildArea = 0.0;
+  double m_fArea = 0.0;
+
+  struct BuildItem {
+    uint32_t item;
+    Aabb bounds;
+    VecThree centroid;
+  };
+  std::vector<BuildItem> m_vBuildItems; // scratch kept so rebuilds reuse its storage
+  void BuildNode(std::vector<BuildItem>& items, uint32_t node, uint32_t first, uint32_t count);
+};
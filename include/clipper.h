@@ -0,0 +1,93 @@
+#pragma once
+#include "matrix.h"
+#include "mesh.h"
+#include "meshlet.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Structure-of-arrays clip-space positions (before the perspective divide).
+struct ClipVertexBuffer {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  std::vector<float> w;
+
+  size_t Size() const { return x.size(); }
+
+  void Resize(size_t count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    w.resize(count);
+  }
+};
+
+// Clip stage between the vertex transform and the rasterizer.
+//
+// Works on clip-space triangles as produced by Mat4::MakeProjection, where the visible
+// volume is -w <= x, y <= w and 0 <= z <= w. Triangles entirely outside one frustum plane
+// are dropped, triangles crossing the near or far plane (or reaching past the rasterizer's
+// guard band) are clipped with Sutherland-Hodgman, and the survivors are divided, mapped
+// to the viewport and optionally back-face culled.
+class Clipper {
+  public:
+  // Screen-space winding that gets culled. With the engine's y-up screen mapping the
+  // primitives:: meshes wind their outward faces clockwise, so CCW removes back faces.
+  enum class CullMode { None, CW, CCW };
+
+  struct Stats {
+    uint64_t trianglesIn = 0;
+    uint64_t trianglesCulledFrustum = 0;  // entirely outside one frustum plane
+    uint64_t trianglesCulledBackFace = 0; // wrong winding after projection
+    uint64_t trianglesClipped = 0;        // crossed a clip plane and were cut
+    uint64_t trianglesClippedAway = 0;    // clipped, but nothing drawable was left
+    uint64_t trianglesOut = 0;            // emitted, counting each triangle of a clipped fan
+    uint64_t meshletsIn = 0;
+    uint64_t meshletsCulledFrustum = 0;   // bounding sphere outside one frustum plane
+    uint64_t meshletsCulledBackFace = 0;  // every triangle would be culled by winding
+  };
+
+  void SetViewport(int width, int height);
+  void SetCullMode(CullMode mode) { m_cullMode = mode; }
+  CullMode GetCullMode() const { return m_cullMode; }
+
+  // Clips, projects and culls triangleCount triangles. Vertex i of triangle t is
+  // clip[indices[3 * t + i]], or clip[3 * t + i] when indices is null. Surviving
+  // triangles are written to out as consecutive screen-space vertex triples.
+  void Process(const ClipVertexBuffer& clip, const uint32_t* indices, size_t triangleCount,
+               VertexBuffer& out);
+
+  // Appends to visible the meshlets of mesh that may have triangles left after Process()
+  // under transform: the others lie wholly outside a frustum plane or, by their normal
+  // cones, face the way the cull mode removes. Conservative, so drawing only the visible
+  // meshlets gives the same image as drawing them all.
+  void CullMeshlets(const MeshletMesh& mesh, const Mat4& transform,
+                    std::vector<uint32_t>& visible);
+
+  const Stats& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats = Stats(); }
+
+  private:
+  struct ClipVertex {
+    float x, y, z, w;
+  };
+
+  void ClipAndEmit(const ClipVertex in[3], VertexBuffer& out);
+  // signedArea is twice the screen-space area, negative for clockwise winding.
+  bool IsCulled(float signedArea) const;
+  void Emit(VertexBuffer& out, float x, float y, float z);
+
+  int m_nWidth = 0;
+  int m_nHeight = 0;
+  float m_fGuardX = 1.0f; // guard band extents in NDC units
+  float m_fGuardY = 1.0f;
+  CullMode m_cullMode = CullMode::None;
+  Stats m_stats;
+
+  // Per-vertex scratch reused across calls
+  std::vector<uint8_t> m_vOutcodes;
+  VertexBuffer m_vScreen;
+  size_t m_nOut = 0;
+};
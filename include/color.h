@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Color structure to handle RGB assets
+struct Color {
+  uint8_t r = 255;
+  uint8_t g = 255;
+  uint8_t b = 255;
+  uint8_t a = 255;
+
+  // The four channels as one 32-bit word in memory order, for wide stores and compares.
+  uint32_t Pack() const {
+    uint32_t packed;
+    std::memcpy(&packed, this, sizeof(packed));
+    return packed;
+  }
+
+  static Color Unpack(uint32_t packed) {
+    Color color;
+    std::memcpy(static_cast<void*>(&color), &packed, sizeof(color));
+    return color;
+  }
+
+  static const Color White;
+  static const Color Red;
+  static const Color Green;
+  static const Color Blue;
+  static const Color Black;
+};
+
+static_assert(sizeof(Color) == 4, "Color must pack into 32 bits");
@@ -1,29 +1,28 @@
 #pragma once
 
+#include "arena.h"
+#include "blend.h"
+#include "clipper.h"
+#include "color.h"
+#include "framepacer.h"
+#include "framepipeline.h"
+#include "input.h"
+#include "jobs.h"
 #include "mesh.h"
+#include "meshlet.h"
+#include "occlusion.h"
+#include "rasterizer.h"
 
 #include <GLFW/glfw3.h>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 // Forward declaration for GLFW window
 struct GLFWwindow;
 
-// Color structure to handle RGB assets
-struct Color {
-  uint8_t r = 255;
-  uint8_t g = 255;
-  uint8_t b = 255;
-  uint8_t a = 255;
-
-  static const Color White;
-  static const Color Red;
-  static const Color Green;
-  static const Color Blue;
-  static const Color Black;
-};
-
 // GLFW thin wrapper (platform abstraction)
 namespace platform {
   bool Init();
@@ -37,13 +36,106 @@ namespace platform {
 
 // Engine
 class Engine {
+  public:
+  // Window presents every frame through GLFW/OpenGL with vsync. Headless needs neither a
+  // display nor a GL context: Run() renders a fixed number of frames as fast as possible
+  // and the results are read back through GetFramebuffer() or frame dumps.
+  enum class Backend { Window, Headless };
+
+  // Buffers reset by Clear(). An application that overwrites every pixel each frame can
+  // pass ClearDepth alone and skip the color fill.
+  enum ClearFlags : uint32_t { ClearColor = 1 << 0, ClearDepth = 1 << 1, ClearAll = 3 };
+
+  // Receives each finished frame on the present thread: width * height pixels, bottom row
+  // first, valid only for the duration of the call.
+  using FrameSink = std::function<void(const Color* pixels, int width, int height, int frame)>;
+
   private:
   // Engine State
+  Backend m_backend = Backend::Window;
   GLFWwindow* m_window = nullptr;
   int m_nScreenWidth = 0;
   int m_nScreenHeight = 0;
   std::string m_sAppName;
-  std::vector<Color> m_vFramebuffer;
+  std::vector<float> m_vDepthBuffer;
+
+  // One framebuffer per present pipeline slot, all allocated by Initialize().
+  // m_pFramebuffer is the slot being drawn; the others are queued or being presented.
+  int m_nFramebufferCount = 2;
+  std::vector<std::vector<Color>> m_vFramebuffers;
+  int m_nFrameSlot = 0;
+  int m_nPresentedSlot = -1; // last slot submitted by Present()
+  Color* m_pFramebuffer = nullptr;
+  FramePipeline m_presentPipeline;
+  FrameSink m_frameSink;
+
+  // Present thread side: displays, dumps and forwards one finished frame.
+  void ConsumeFrame(int slot, int frame);
+
+  // Headless run length and the optional per-frame image dump
+  int m_nHeadlessFrames = 1;
+  int m_nFrameIndex = 0;
+  std::string m_sFrameDumpPrefix;
+  std::string m_sFrameDumpExtension;
+
+  // Frame pacing, and the fixed-timestep mode (off while m_fFixedStep is 0)
+  bool m_bVSync = true;
+  FramePacer m_pacer;
+  float m_fFixedStep = 0.0f;
+  int m_nMaxFixedSteps = 8;
+  double m_fFixedAccumulator = 0.0;
+  uint64_t m_nFixedTicks = 0;
+  double m_fDroppedTime = 0.0;
+
+  // Runs the fixed steps due after deltaT more seconds, then OnRender().
+  bool RunFixedSteps(float deltaT);
+
+  // Writes a finished frame when frame dumps are enabled.
+  void DumpFrame(const Color* pixels, int frame);
+
+  // Job pool shared by the engine stages and the application, started by Initialize()
+  int m_nWorkerCount = 0;
+  JobSystem m_jobs;
+
+  // One frame arena per job thread, reset by Run() at the start of every frame
+  std::vector<std::unique_ptr<FrameArena>> m_vFrameArenas;
+
+  // Binning rasterizer behind the Fill* methods
+  Rasterizer m_rasterizer;
+
+  // Scratch vertex streams reused by DrawMesh across frames
+  ClipVertexBuffer m_vMeshClip;
+  VertexBuffer m_vMeshProjected;
+
+  // Blend mode, depth and color mask state of the filled primitives
+  RenderState m_renderState;
+
+  // Clip, cull and viewport stage shared by DrawMesh and FillMesh
+  Clipper m_clipper;
+
+  // Depth of the application's occluders, for culling before DrawMesh and FillMesh
+  OcclusionBuffer m_occlusion;
+
+  // Key events arrive through a GLFW callback (or QueueInputEvent) as they happen and are
+  // applied once per frame by UpdateInputState().
+  InputQueue m_inputQueue;
+  std::vector<InputEvent> m_vFrameEvents;
+  std::vector<int> m_vChangedKeys; // keys with bPressed or bReleased set this frame
+  static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+
+  // Meshlets that survived culling, and their triangles re-based onto m_vMeshClip
+  std::vector<uint32_t> m_vVisibleMeshlets;
+  std::vector<uint32_t> m_vMeshletIndices;
+
+  // Transforms mesh to clip space and runs it through the clip stage, leaving the
+  // surviving screen-space triangles in m_vMeshProjected as vertex triples.
+  void ProjectMesh(const MeshView& mesh, const Mat4& transform);
+  // The same for the meshlets that pass Clipper::CullMeshlets.
+  void ProjectMesh(const MeshletMesh& mesh, const Mat4& transform);
+
+  // Draw m_vMeshProjected as wireframe or filled triangles.
+  void DrawProjected(Color color);
+  void FillProjected(Color color);
 
   protected:
   // Input State
@@ -52,33 +144,181 @@ class Engine {
     bool bHeld = false;
     bool bReleased = false;
   };
-  sKeyState m_keyStates[512];
+  static constexpr int KEY_COUNT = 512;
+  sKeyState m_keyStates[KEY_COUNT];
+
+  // Drains the input queue into this frame's events and applies them to the key states.
+  // Only keys that changed are touched, this frame and the next (to reset their pressed
+  // and released flags).
   void UpdateInputState();
 
   // Internal Rendering and Primitive Methods
-  void Clear(Color color = Color::Black);
+  void Clear(Color color = Color::Black, uint32_t flags = ClearAll);
+
+  // Fills [x0, x1) x [y0, y1), clipped to the screen. Color only; depth is untouched.
+  void ClearRect(int x0, int y0, int x1, int y1, Color color = Color::Black);
+
   void Draw(int x, int y, Color color = Color::White);
+
+  // Fills pixels [x0, x1) of row y with no bounds checks: the caller guarantees
+  // 0 <= y < height and 0 <= x0 <= x1 <= width. Blends under the render state.
+  void DrawSpan(int y, int x0, int x1, Color color = Color::White);
+
+  // Hands the frame to the present pipeline and switches drawing to the next free
+  // framebuffer, waiting if every one is still queued or being presented.
   void Present();
 
+  // Lines are clipped to the screen before rasterizing, so they cost their visible pixels
+  // however far the endpoints reach (within +-2^29, to keep the clip exact in 64 bits).
   void DrawLine(int x1, int y1, int x2, int y2, Color color = Color::White);
   void DrawTriangle(int x1, int y1, int x2, int y2, int x3, int y3, Color color = Color::White);
   void DrawTriangle(const Triangle& tri, Color color = Color::White);
   void DrawCircle(int xc, int yc, int radius, Color color = Color::White);
 
-  // User Interface Hooks (Overridden by the derived class)
+  // Fills the disc DrawCircle outlines, one clipped span per row.
+  void FillCircle(int xc, int yc, int radius, Color color = Color::White);
+
+  // Transforms every unique vertex of the mesh in one batch, clips and culls in clip space, then
+  // draws the surviving triangles.
+  void DrawMesh(const Mesh& mesh, const Mat4& transform, Color color = Color::White);
+  void DrawMesh(const MeshView& mesh, const Mat4& transform, Color color = Color::White);
+
+  // Draws a mesh split into meshlets (see meshlet.h). Meshlets outside the view or facing
+  // the way the cull mode removes are rejected before any of their vertices are
+  // transformed; the rest draw exactly as DrawMesh of the same triangles would.
+  void DrawMesh(const MeshletMesh& mesh, const Mat4& transform, Color color = Color::White);
+
+  // Filled triangles are binned and rasterized in parallel when FlushTriangles() runs,
+  // which Run() does before every Present(). Clear() discards triangles still pending.
+  // They are depth tested against the depth buffer, which Clear() resets to the far plane;
+  // the integer overloads draw at depth 0.
+  void FillTriangle(int x1, int y1, int x2, int y2, int x3, int y3, Color color = Color::White);
+  void FillTriangle(const Triangle& tri, Color color = Color::White);
+  void FillMesh(const Mesh& mesh, const Mat4& transform, Color color = Color::White);
+  void FillMesh(const MeshView& mesh, const Mat4& transform, Color color = Color::White);
+  void FillMesh(const MeshletMesh& mesh, const Mat4& transform, Color color = Color::White);
+  void FlushTriangles();
+
+  // User Interface Hooks (Overridden by the derived class). Returning false ends Run().
   virtual bool OnCreate() = 0;
-  virtual bool OnUpdate(float deltaT) = 0;
+
+  // Called once per frame with the seconds since the last one, unless a fixed timestep
+  // is set.
+  virtual bool OnUpdate(float /*deltaT*/) { return true; }
+
+  // With a fixed timestep, Run() calls OnFixedUpdate() zero or more times per frame, each
+  // advancing the simulation by exactly fStep, then OnRender() once. fAlpha in [0, 1) is
+  // how far the frame lies between the last two simulation states, for interpolating
+  // what is drawn.
+  virtual bool OnFixedUpdate(float /*fStep*/) { return true; }
+  virtual bool OnRender(float /*fAlpha*/) { return true; }
 
   public:
   // Life Cycle and Initialization
   Engine();
   virtual ~Engine();
 
-  bool Initialize(int width = 800, int height = 600, std::string appName = "Engine");
+  bool Initialize(int width = 800, int height = 600, std::string appName = "Engine",
+                  Backend backend = Backend::Window);
   void Run();
 
+  // Frames rendered by Run() in headless mode (1 by default). Headless frames advance by a
+  // fixed HEADLESS_DELTA_T so runs are reproducible regardless of speed.
+  void SetHeadlessFrameCount(int nFrames) { m_nHeadlessFrames = nFrames; }
+  static constexpr float HEADLESS_DELTA_T = 1.0f / 60.0f;
+
+  // Framebuffers cycled between drawing and presenting, applied by Initialize(). With 1,
+  // Present() displays synchronously. With 2 (the default) or 3, frames are displayed,
+  // dumped and passed to the frame sink on a separate thread while the next ones are
+  // drawn; Present() waits once count - 1 frames are in flight, which bounds latency.
+  // Each frame then starts with the contents of an older one, so Clear() before drawing.
+  void SetFramebufferCount(int nCount) { m_nFramebufferCount = nCount < 1 ? 1 : nCount; }
+
+  // Windowed frame pacing. With vsync (the default, applied by Initialize()) presentation
+  // waits for the display. Without it, frames run uncapped, or at fTargetFps when it is
+  // above 0 by sleeping out the rest of each frame. Headless runs are never paced.
+  void SetFramePacing(bool bVSync, double fTargetFps = 0.0);
+
+  // Switches Run() to the OnFixedUpdate()/OnRender() hooks with fStep seconds per
+  // simulation step; 0 returns to OnUpdate(). After a stall, a frame runs at most
+  // nMaxSteps steps and the remaining time is dropped, so a slow simulation falls behind
+  // real time instead of spiralling into ever longer frames.
+  void SetFixedTimestep(float fStep, int nMaxSteps = 8);
+  uint64_t GetFixedTickCount() const { return m_nFixedTicks; }
+  double GetDroppedSimulationTime() const { return m_fDroppedTime; }
+
+  // Intervals between recent frames: mean, extremes, 99th percentile and jitter.
+  FramePacer::Stats GetFrameTiming() const { return m_pacer.GetStats(); }
+
+  // The frame dump and sink run on the present thread; set them before Run().
+
+  // Writes every frame Run() produces to <sPrefix><frame number><sExtension>, as PNG for a
+  // ".png" extension and PPM otherwise. An empty prefix disables the dump.
+  void SetFrameDump(std::string sPrefix, std::string sExtension = ".ppm");
+
+  // Passes every frame Run() produces to sink (see FrameSink).
+  void SetFrameSink(FrameSink sink) { m_frameSink = std::move(sink); }
+
+  // Writes the framebuffer being drawn, or after Run() the last frame presented, to an
+  // image file (see image.h).
+  bool SaveFrame(const std::string& sFilename) const;
+
+  // Threads in the job pool, applied by Initialize(). 0 (the default) uses every hardware
+  // thread; 1 runs all jobs, rasterization included, on the main thread in a fixed order,
+  // which helps debugging.
+  void SetWorkerCount(int nCount) { m_nWorkerCount = nCount; }
+
+  // The engine's job pool, for spreading OnUpdate work over the same threads that
+  // rasterize. Jobs must be created and waited on from the main thread or other jobs.
+  JobSystem& GetJobs() { return m_jobs; }
+
+  // The calling thread's frame arena, for transient data of the current frame: it is reset
+  // at the start of the next one. Valid after Initialize() on the main thread and in jobs
+  // of the engine's pool; each thread gets its own, so allocating needs no locking.
+  FrameArena& GetFrameArena() { return *m_vFrameArenas[m_jobs.GetThreadIndex()]; }
+
+  // Frame arena statistics summed over all threads.
+  FrameArena::Stats GetFrameArenaStats() const;
+
+  // Back-face culling applied by DrawMesh and FillMesh (none by default).
+  void SetCullMode(Clipper::CullMode mode) { m_clipper.SetCullMode(mode); }
+
+  // Blend mode, depth test and write, and color mask of what is filled from now on:
+  // FillTriangle, FillMesh, FillCircle and DrawSpan (spans ignore the depth settings).
+  // Each triangle keeps the state it was filled under until FlushTriangles(). Points,
+  // lines and outlines always overwrite. For translucent geometry, draw the opaque scene
+  // first, then the translucent layers back to front with depth writes off.
+  void SetRenderState(const RenderState& state);
+  const RenderState& GetRenderState() const { return m_renderState; }
+
+  // Queues a key event for the next frame, from any thread. Windowed runs queue keyboard
+  // input themselves; headless runs and replays feed it here.
+  void QueueInputEvent(const InputEvent& event) { m_inputQueue.Push(event); }
+
   // Public Accessors
+  // A key pressed and released within one frame reads as both bPressed and bReleased.
   sKeyState GetKey(int key) const;
+
+  // This frame's key events in the order they arrived, with their timestamps.
+  const std::vector<InputEvent>& GetInputEvents() const { return m_vFrameEvents; }
   int GetScreenWidth() const { return m_nScreenWidth; }
   int GetScreenHeight() const { return m_nScreenHeight; }
+  Backend GetBackend() const { return m_backend; }
+
+  // The framebuffer being drawn: width * height pixels, bottom row first. After Run()
+  // returns it holds the last frame presented. Finished frames are delivered through
+  // SetFrameSink().
+  const Color* GetFramebuffer() const { return m_pFramebuffer; }
+
+  // Rasterizer and clip stage counters for the last frame (Run() resets them at the start
+  // of each frame).
+  const Rasterizer::Stats& GetRasterStats() const { return m_rasterizer.GetStats(); }
+  const Clipper::Stats& GetClipStats() const { return m_clipper.GetStats(); }
+
+  // Low-resolution occluder depth for Scene::CullOccluded(), rasterized over the job pool.
+  // It shares nothing with the framebuffers, so culling the next frame in OnUpdate() runs
+  // while the present thread is still displaying the previous one. Its occluder and
+  // occludee counts are reset with the other stats at the start of each frame.
+  OcclusionBuffer& GetOcclusionBuffer() { return m_occlusion; }
+  const OcclusionBuffer::Stats& GetOcclusionStats() const { return m_occlusion.GetStats(); }
 };
@@ -0,0 +1,19 @@
+#pragma once
+#include "color.h"
+
+#include <cstddef>
+
+// Bulk fills for framebuffers and depth buffers, vectorized with AVX or SSE when available.
+// Fills of at least NON_TEMPORAL_BYTES use streaming stores, which bypass the cache: a
+// buffer that large would be evicted before it is read again anyway, and skipping the
+// read-for-ownership roughly halves the memory traffic.
+namespace fill {
+  const size_t NON_TEMPORAL_BYTES = 4 << 20;
+
+  void Fill(Color* dst, size_t count, Color color);
+  void Fill(float* dst, size_t count, float value);
+
+  // Fills the rows [y0, y1) between columns [x0, x1) of a buffer with stride pixels per
+  // row. The rectangle must lie inside the buffer.
+  void FillRect(Color* dst, int stride, int x0, int y0, int x1, int y1, Color color);
+} // namespace fill
@@ -0,0 +1,57 @@
+#pragma once
+
+// Frame rate limiting and frame time statistics.
+//
+// Times are seconds on a steady clock (Now()). Frames are scheduled on a fixed grid of
+// periods from Start(), so a frame that finishes late shortens the wait before the next
+// one instead of pushing every later frame back; a frame late by more than a whole
+// period restarts the grid.
+class FramePacer {
+  public:
+  // Frame intervals kept for GetStats()
+  static constexpr int HISTORY = 240;
+
+  // OS sleeps can overshoot by a scheduler tick, so WaitForNextFrame() sleeps until this
+  // long before the deadline and yields for the rest.
+  static constexpr double SPIN_MARGIN = 0.002;
+
+  struct Stats {
+    int nFrames = 0; // intervals in the window, at most HISTORY
+    double meanMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double p99Ms = 0.0;
+    double jitterMs = 0.0; // standard deviation of the interval
+  };
+
+  static double Now();
+
+  // Blocks until Now() >= deadline.
+  static void SleepUntil(double deadline);
+
+  // 0 (the default) disables waiting; frame times are still recorded.
+  void SetTargetFps(double fps);
+  double GetTargetFps() const { return m_fPeriod > 0.0 ? 1.0 / m_fPeriod : 0.0; }
+
+  // Restarts the schedule and the statistics at time now.
+  void Start(double now);
+
+  // Marks the start of a frame and returns the seconds since the previous one.
+  double BeginFrame(double now);
+
+  // With a target rate, sleeps until the next frame is due.
+  void WaitForNextFrame();
+
+  // Intervals between the last HISTORY frames.
+  Stats GetStats() const;
+
+  private:
+  double m_fPeriod = 0.0;
+  double m_fLastFrame = 0.0;
+  double m_fNextDeadline = 0.0;
+  bool m_bFirstFrame = true;
+
+  double m_intervals[HISTORY] = {};
+  int m_nIntervals = 0;
+  int m_nNextInterval = 0;
+};
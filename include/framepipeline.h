@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Hands finished framebuffers to a consumer (display, file writer, callback) on its own
+// thread so the next frame can be simulated and rasterized meanwhile.
+//
+// The pipeline owns slot numbers, not memory: the caller keeps one framebuffer per slot.
+// A slot is acquired for drawing, submitted, consumed, then becomes free again. With N
+// slots at most N - 1 finished frames are queued or being consumed, so Acquire() blocks
+// once the consumer falls that far behind; this bounds latency to N - 1 frames. With a
+// single slot the consumer runs inline in Submit() and no thread is started.
+//
+// All bookkeeping storage is sized in Start(); steady-state frames do not allocate.
+class FramePipeline {
+  public:
+  using Consumer = std::function<void(int slot, int64_t frame)>;
+  using ThreadHook = std::function<void()>;
+
+  FramePipeline() = default;
+  ~FramePipeline();
+
+  FramePipeline(const FramePipeline&) = delete;
+  FramePipeline& operator=(const FramePipeline&) = delete;
+
+  // onThreadStart/onThreadStop run on the consumer thread around its loop, e.g. to move a
+  // GL context there. They are not called when nSlots is 1.
+  void Start(int nSlots, Consumer consumer, ThreadHook onThreadStart = {},
+             ThreadHook onThreadStop = {});
+
+  // Consumes every submitted frame, then stops the thread.
+  void Stop();
+
+  // Returns a free slot, waiting for the consumer if none is.
+  int Acquire();
+
+  // Queues an acquired slot for consumption.
+  void Submit(int slot, int64_t frame);
+
+  // Waits until every submitted frame has been consumed.
+  void WaitIdle();
+
+  int GetSlotCount() const { return m_nSlots; }
+
+  private:
+  struct Pending {
+    int slot;
+    int64_t frame;
+  };
+
+  void ThreadLoop(ThreadHook onThreadStart, ThreadHook onThreadStop);
+
+  int m_nSlots = 0;
+  Consumer m_consumer;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cvSubmitted;
+  std::condition_variable m_cvFreed;
+  std::vector<int> m_vFreeSlots;  // stack
+  std::vector<Pending> m_vQueue;  // ring of m_nSlots entries
+  size_t m_nQueueHead = 0;
+  size_t m_nQueued = 0;
+  int m_nInFlight = 0; // submitted and not yet consumed
+  bool m_bStop = false;
+  std::thread m_thread;
+};
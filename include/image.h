@@ -0,0 +1,18 @@
+#pragma once
+#include "color.h"
+
+#include <string>
+
+// Image file output for framebuffers. Framebuffers store the bottom row first (the layout
+// glDrawPixels expects); files are written top row first. Alpha is dropped.
+namespace image {
+  // Binary PPM (P6).
+  bool WritePPM(const std::string& sFilename, const Color* pixels, int width, int height);
+
+  // 8-bit RGB PNG. Image data is stored uncompressed, which keeps the writer free of
+  // dependencies and fast enough to dump every frame.
+  bool WritePNG(const std::string& sFilename, const Color* pixels, int width, int height);
+
+  // Picks PNG for a .png extension and PPM otherwise.
+  bool Write(const std::string& sFilename, const Color* pixels, int width, int height);
+} // namespace image
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// A key transition as delivered by the platform, stamped with platform::Time() when it
+// was received.
+struct InputEvent {
+  enum class Type : uint8_t { KeyDown, KeyUp };
+
+  Type type = Type::KeyDown;
+  int key = 0;
+  double time = 0.0;
+};
+
+// Bounded lock-free queue of input events. Any number of threads may Push() (the window
+// callback, a replay tool, an input thread) while one thread drains it with Pop(). Storage
+// is fixed; when the queue is full the newest event is dropped and counted.
+class InputQueue {
+  public:
+  static constexpr size_t CAPACITY = 1024; // power of two
+
+  InputQueue();
+
+  InputQueue(const InputQueue&) = delete;
+  InputQueue& operator=(const InputQueue&) = delete;
+
+  bool Push(const InputEvent& event);
+  bool Pop(InputEvent& event);
+
+  // Events lost to a full queue since construction.
+  uint64_t GetDroppedCount() const { return m_nDropped.load(std::memory_order_relaxed); }
+
+  private:
+  // Each cell's sequence number says whose turn it is: equal to the position when a
+  // producer may write it, position + 1 once it holds an event for the consumer.
+  struct Cell {
+    std::atomic<size_t> sequence;
+    InputEvent event;
+  };
+
+  Cell m_cells[CAPACITY];
+  alignas(64) std::atomic<size_t> m_nEnqueue{0};
+  alignas(64) std::atomic<size_t> m_nDequeue{0};
+  std::atomic<uint64_t> m_nDropped{0};
+};
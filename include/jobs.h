@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Work-stealing job pool.
+//
+// Every thread has a fixed-size deque of jobs: it pushes and pops its own work at the
+// bottom (newest first, while the data is warm in cache) and idle threads steal from the
+// top of the others (oldest, usually the largest pieces). The thread that called Start()
+// takes part whenever it waits, so a pool of N threads starts N - 1 workers.
+//
+// Jobs live in a per-thread ring of MAX_JOBS slots allocated by Start(); creating and
+// running one never touches the heap. Slots are handed out in creation order and reused
+// MAX_JOBS creations later whether or not their job has finished, so a job must finish
+// before its creating thread creates MAX_JOBS more. ParallelFor() bounds its chunk count
+// to stay well within this.
+//
+// Jobs may be created, run and waited on from the thread that called Start() and from
+// inside jobs. With one thread nothing is concurrent: jobs run on the calling thread in
+// a fixed order, which makes runs reproducible for debugging.
+class JobSystem {
+  public:
+  static constexpr size_t MAX_JOBS = 4096;     // per thread, power of two
+  static constexpr size_t JOB_DATA_SIZE = 64;  // bytes of captured state per job
+  static constexpr int MAX_CONTINUATIONS = 4;  // dependents per job
+  // Chunks of one ParallelFor: its jobs, all possibly created on one thread while the
+  // root waits, leave the rest of the ring to nested and surrounding work.
+  static constexpr size_t MAX_FOR_CHUNKS = MAX_JOBS / 4;
+
+  // Opaque to callers; only handed back to the system.
+  struct Job {
+    void (*function)(Job& job) = nullptr;
+    Job* parent = nullptr;
+    std::atomic<int> nUnfinished{0}; // itself plus unfinished children
+    std::atomic<int> nBlockers{0};   // unfinished dependencies plus the pending Run()
+    std::atomic<int> nContinuations{0};
+    Job* continuations[MAX_CONTINUATIONS] = {};
+    alignas(16) unsigned char data[JOB_DATA_SIZE];
+  };
+
+  JobSystem() = default;
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  // Starts the pool with nThreads threads including the caller: 0 uses every hardware
+  // thread, 1 runs every job on the calling thread.
+  void Start(int nThreads = 0);
+
+  // Joins the workers. Every job must have been waited on.
+  void Stop();
+
+  int GetThreadCount() const { return m_nThreads; }
+
+  // Index of the calling thread in [0, GetThreadCount()): 0 for the thread that called
+  // Start() (and any thread outside the pool), 1 and up for the workers.
+  int GetThreadIndex() const { return CurrentWorker(); }
+
+  // Creates a job calling f(). f is stored in the job, so it must be trivially destructible
+  // and at most JOB_DATA_SIZE bytes: capture by reference or pointer. A job created with
+  // a parent counts as unfinished work of the parent until it completes.
+  template <typename F>
+  Job* Create(F&& f, Job* parent = nullptr);
+
+  // Makes job wait for dependency (and its children) to finish. Both must be created and
+  // neither Run() yet.
+  void AddDependency(Job* job, Job* dependency);
+
+  // Schedules a created job; it starts once its dependencies have finished.
+  void Run(Job* job);
+
+  // Runs other jobs until job and its children have finished.
+  void Wait(const Job* job);
+  bool IsFinished(const Job* job) const {
+    return job->nUnfinished.load(std::memory_order_acquire) == 0;
+  }
+
+  // Calls body(chunkBegin, chunkEnd) over disjoint chunks covering [begin, end) and
+  // returns once all are done. grain is the chunk length; 0 picks one that gives each
+  // thread a few chunks to balance uneven work. The grain is raised as needed to keep
+  // the chunks within MAX_FOR_CHUNKS. The calling thread works on chunks too.
+  template <typename F>
+  void ParallelFor(size_t begin, size_t end, F&& body, size_t grain = 0);
+
+  private:
+  // State shared by the jobs of one ParallelFor call
+  template <typename Body>
+  struct ForRange {
+    JobSystem* system;
+    Body* body;
+    size_t grain;
+    Job* root;
+  };
+  template <typename Body>
+  void SplitRange(const ForRange<Body>* range, size_t begin, size_t end);
+
+  // Chase-Lev deque over a fixed ring: Push and Pop by the owner only, Steal by anyone.
+  struct Deque {
+    std::atomic<int64_t> top{0};
+    std::atomic<int64_t> bottom{0};
+    std::atomic<Job*> items[MAX_JOBS];
+
+    bool Push(Job* job);
+    Job* Pop();
+    Job* Steal();
+  };
+
+  struct alignas(64) Worker {
+    Deque deque;
+    std::unique_ptr<Job[]> jobs;
+    size_t nNextJob = 0;
+    std::thread thread;
+  };
+
+  Job* Allocate();
+  int CurrentWorker() const;
+  void Push(Job* job);
+  Job* Take(int worker);
+  void Execute(Job* job);
+  void Finish(Job* job);
+  void WorkerLoop(int worker);
+
+  int m_nThreads = 0;
+  std::unique_ptr<Worker[]> m_pWorkers;
+
+  // Sleeping workers are woken when jobs are pushed; see Push() and WorkerLoop().
+  std::atomic<int> m_nQueued{0};
+  std::atomic<int> m_nSleeping{0};
+  std::atomic<bool> m_bStop{false};
+  std::mutex m_mutex;
+  std::condition_variable m_cvWork;
+};
+
+template <typename F>
+JobSystem::Job* JobSystem::Create(F&& f, Job* parent) {
+  using Function = typename std::decay<F>::type;
+  static_assert(sizeof(Function) <= JOB_DATA_SIZE, "job captures too much; capture by pointer");
+  static_assert(alignof(Function) <= 16, "job capture alignment too large");
+  static_assert(std::is_trivially_destructible<Function>::value,
+                "job functions are never destroyed; capture by reference or pointer");
+
+  Job* job = Allocate();
+  new (job->data) Function(std::forward<F>(f));
+  job->function = [](Job& self) { (*std::launder(reinterpret_cast<Function*>(self.data)))(); };
+  job->parent = parent;
+  job->nUnfinished.store(1, std::memory_order_relaxed);
+  job->nBlockers.store(1, std::memory_order_relaxed);
+  job->nContinuations.store(0, std::memory_order_relaxed);
+  if (parent)
+    parent->nUnfinished.fetch_add(1, std::memory_order_relaxed);
+  return job;
+}
+
+template <typename F>
+void JobSystem::ParallelFor(size_t begin, size_t end, F&& body, size_t grain) {
+  if (begin >= end)
+    return;
+  size_t count = end - begin;
+  if (grain == 0)
+    grain = std::max<size_t>(1, count / ((size_t)m_nThreads * 4));
+  grain = std::max(grain, (count + MAX_FOR_CHUNKS - 1) / MAX_FOR_CHUNKS);
+
+  if (m_nThreads <= 1 || grain >= count) {
+    for (size_t chunk = begin; chunk < end; chunk += grain)
+      body(chunk, chunk + std::min(grain, end - chunk));
+    return;
+  }
+
+  using Body = typename std::remove_reference<F>::type;
+  ForRange<Body> range{this, &body, grain, Create([] {})};
+  SplitRange(&range, begin, end);
+  Run(range.root);
+  Wait(range.root);
+}
+
+template <typename Body>
+void JobSystem::SplitRange(const ForRange<Body>* range, size_t begin, size_t end) {
+  // Hands the upper half to a job and keeps splitting the lower one, so only a logarithmic
+  // number of jobs is alive and thieves take the largest pieces first. Chunks start at
+  // multiples of grain from the first split's begin whichever thread runs them.
+  while (end - begin > range->grain) {
+    size_t mid = begin + ((end - begin) / range->grain + 1) / 2 * range->grain;
+    Run(Create([range, mid, end] { range->system->SplitRange(range, mid, end); }, range->root));
+    end = mid;
+  }
+  (*range->body)(begin, end);
+}
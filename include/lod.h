@@ -0,0 +1,43 @@
+#pragma once
+#include "mesh.h"
+
+#include <cstddef>
+#include <vector>
+
+struct LodLevel {
+  Mesh mesh;
+  float fError; // how far the surface may stray from the full mesh, in mesh units
+};
+
+// Levels of detail of a mesh, from the full mesh down.
+//
+// Each level is simplified from the full mesh (meshopt::Simplify) to a fraction of its
+// triangles and records its error; errors never decrease down the chain. Select() picks
+// the coarsest level whose error, projected to the screen, stays within a pixel budget,
+// so an object costs triangles in proportion to the pixels it covers rather than to the
+// asset's detail.
+class LodChain {
+  public:
+  // An object only moves to a coarser level once it fits the budget with this margin to
+  // spare, and only back to a finer one once it exceeds the budget by the same margin, so
+  // one hovering at a threshold does not flip between levels every frame.
+  static constexpr float HYSTERESIS = 0.25f;
+
+  std::vector<LodLevel> levels; // levels[0] is the full mesh, with error 0
+
+  // Fractions of the full mesh's triangle count for the levels after the first. The chain
+  // ends early when a level no longer sheds at least a tenth of the previous one's
+  // triangles.
+  static LodChain Build(const Mesh& mesh, const std::vector<float>& vRatios = {
+                                            0.5f, 0.25f, 0.125f, 0.0625f, 0.03125f, 0.015625f,
+                                            0.0078125f});
+
+  // The level to draw next for an object drawn at current last frame, where one mesh unit
+  // covers fPixelsPerUnit pixels on screen, keeping the projected error within
+  // fMaxPixelError.
+  size_t Select(size_t current, float fPixelsPerUnit, float fMaxPixelError = 1.0f) const;
+
+  // Pixels covered by one world unit at fDistance in front of a Mat4::MakeProjection
+  // camera with the given vertical field of view, on a screen nScreenHeight pixels high.
+  static float PixelsPerUnit(float fDistance, float fFovDegrees, int nScreenHeight);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped, so the
+// contents are paged in on demand and never copied; elsewhere it is read into memory.
+class MappedFile {
+  public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const std::string& sFilename);
+  void Close();
+
+  const char* Data() const { return m_pData; }
+  size_t Size() const { return m_nSize; }
+  bool IsOpen() const { return m_pData != nullptr || m_bOpenEmpty; }
+
+  private:
+  const char* m_pData = nullptr;
+  size_t m_nSize = 0;
+  bool m_bMapped = false;
+  bool m_bOpenEmpty = false; // mmap rejects zero-length files; they open with no data
+  std::vector<char> m_vFallback;
+};
@@ -4,6 +4,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstddef>
 
 namespace mathematics {
   const float PI = 3.14159265f;
@@ -14,6 +15,7 @@ namespace mathematics {
   // Multiplies a VecThree by a 4x4 Matrix.
   void MultiplyMatrixVector(const VecThree& inVec, VecThree& outVec, float& w,
                             const Matrix& matrix);
+  void MultiplyMatrixVector(const VecThree& inVec, VecThree& outVec, float& w, const Mat4& matrix);
 
   // Performs the perspective divide (Division by W) on the vector.
   void PerspectiveDivide(VecThree& vec, float w);
@@ -23,8 +25,35 @@ namespace mathematics {
 
   // Combined helper that handles Transformation and Projection.
   void ProjectToScreen(const VecThree& inVec, VecThree& outVec, const Matrix& matrix);
+  void ProjectToScreen(const VecThree& inVec, VecThree& outVec, const Mat4& matrix);
 
   // Overload that also handles Viewport Scaling (NDC to Screen).
   void ProjectToScreen(const VecThree& inVec, VecThree& outVec, const Matrix& matrix, int width,
                        int height);
+  void ProjectToScreen(const VecThree& inVec, VecThree& outVec, const Mat4& matrix, int width,
+                       int height);
+
+  // Batch kernels. These process whole vertex streams in one pass and are vectorized
+  // with AVX or SSE when available, falling back to scalar code otherwise. Input and
+  // output streams may alias.
+
+  // Transforms count points in place (w is assumed 1 and not divided out).
+  void TransformPoints(VecThree* points, size_t count, const Mat4& matrix);
+
+  // Transforms count SoA positions without the perspective divide.
+  void TransformBatch(const float* inX, const float* inY, const float* inZ, float* outX,
+                      float* outY, float* outZ, size_t count, const Mat4& matrix);
+
+  // Same, also writing w: produces clip-space positions for the clip stage.
+  void TransformBatch(const float* inX, const float* inY, const float* inZ, float* outX,
+                      float* outY, float* outZ, float* outW, size_t count, const Mat4& matrix);
+
+  // Fused transform, perspective divide and NDCToScreen over count SoA positions.
+  void ProjectToScreenBatch(const float* inX, const float* inY, const float* inZ, float* outX,
+                            float* outY, float* outZ, size_t count, const Mat4& matrix, int width,
+                            int height);
+
+  // Convenience wrapper over the pointer form; resizes out to match in.
+  void ProjectToScreenBatch(const VertexBuffer& in, VertexBuffer& out, const Mat4& matrix,
+                            int width, int height);
 } // namespace mathematics
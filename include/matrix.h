@@ -1,5 +1,46 @@
 #pragma once
 
+// Fixed-size 4x4 matrix value type. Row-major, 16-byte aligned so each row is a single
+// 128-bit load, and allocation-free, so it is cheap to build and copy every frame.
+// Vectors are treated as rows (v' = v * M), matching Matrix and the helpers in mathematics.
+struct alignas(16) Mat4 {
+  float m[4][4];
+
+  constexpr Mat4() : m{} {}
+  constexpr Mat4(float m00, float m01, float m02, float m03, float m10, float m11, float m12,
+                 float m13, float m20, float m21, float m22, float m23, float m30, float m31,
+                 float m32, float m33)
+    : m{{m00, m01, m02, m03}, {m10, m11, m12, m13}, {m20, m21, m22, m23}, {m30, m31, m32, m33}} {}
+
+  constexpr void Set(int row, int col, float value) { m[row][col] = value; }
+  constexpr float Get(int row, int col) const { return m[row][col]; }
+
+  static constexpr Mat4 MakeIdentity() {
+    return Mat4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+                0.0f, 1.0f);
+  }
+  static constexpr Mat4 MakeScale(float x, float y, float z) {
+    return Mat4(x, 0.0f, 0.0f, 0.0f, 0.0f, y, 0.0f, 0.0f, 0.0f, 0.0f, z, 0.0f, 0.0f, 0.0f, 0.0f,
+                1.0f);
+  }
+  static constexpr Mat4 MakeTranslation(float x, float y, float z) {
+    return Mat4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, x, y, z,
+                1.0f);
+  }
+  static Mat4 MakeRotationX(float fAngleRad);
+  static Mat4 MakeRotationY(float fAngleRad);
+  static Mat4 MakeRotationZ(float fAngleRad);
+  static Mat4 MakeProjection(float fFovDegrees, float fAspectRatio, float fNear, float fFar);
+
+  // SIMD (SSE, or AVX when available) matrix product matOne * matTwo.
+  static Mat4 Multiply(const Mat4& matOne, const Mat4& matTwo);
+  static Mat4 Transpose(const Mat4& mat);
+
+  // General inverse. Returns false and leaves outMat untouched if mat is singular.
+  static bool Inverse(const Mat4& mat, Mat4& outMat);
+};
+
+// General heap-backed matrix for arbitrary dimensions. Prefer Mat4 for 4x4 transforms.
 class Matrix {
   int m_iRows;
   int m_iCols;
@@ -7,6 +48,7 @@ class Matrix {
 
   public:
   Matrix(int rows, int cols);
+  explicit Matrix(const Mat4& mat);
   ~Matrix();
 
   // Disable copy constructor and assignment for now to prevent double-delete of m_data
@@ -23,6 +65,9 @@ class Matrix {
   int GetRows() const;
   int GetCols() const;
 
+  // Copies a 4x4 Matrix into a Mat4.
+  Mat4 ToMat4() const;
+
   static Matrix MakeIdentity();
   static Matrix MakeRotationX(float fAngleRad);
   static Matrix MakeRotationY(float fAngleRad);
@@ -30,4 +75,5 @@ class Matrix {
   static Matrix MakeTranslation(float x, float y, float z);
   static Matrix MakeProjection(float fFovDegrees, float fAspectRatio, float fNear, float fFar);
   static Matrix Multiply(const Matrix& matOne, const Matrix& matTwo);
+  static Mat4 Multiply(const Mat4& matOne, const Mat4& matTwo);
 };
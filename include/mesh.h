@@ -1,6 +1,8 @@
 #pragma once
 #include "matrix.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -14,11 +16,82 @@ struct Triangle {
   VecThree points[3];
 };
 
+// Structure-of-arrays position stream consumed by the batch transform kernels in
+// mathematics. Keeping each component contiguous lets one SIMD register hold the same
+// coordinate of 4 (SSE) or 8 (AVX) vertices.
+struct VertexBuffer {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+
+  size_t Size() const { return x.size(); }
+
+  // Resizing keeps capacity, so a buffer reused every frame stops allocating after warm-up.
+  void Resize(size_t count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+  }
+
+  void Set(size_t i, const VecThree& v) {
+    x[i] = v.x;
+    y[i] = v.y;
+    z[i] = v.z;
+  }
+
+  VecThree Get(size_t i) const { return {x[i], y[i], z[i]}; }
+};
+
+// Read-only view of indexed triangle data held elsewhere: a Mesh, or a memory-mapped
+// mesh cache (see meshcache.h) drawn without copying.
+struct MeshView {
+  const float* x = nullptr;
+  const float* y = nullptr;
+  const float* z = nullptr;
+  size_t nVertices = 0;
+  const uint32_t* indices = nullptr; // three per triangle
+  size_t nTriangles = 0;
+};
+
+// Indexed triangle mesh: every distinct position is stored once and triangles refer to
+// it through three indices, so transforms touch each shared vertex a single time.
 class Mesh {
   public:
-  std::vector<Triangle> tris;
+  VertexBuffer vertices;
+  std::vector<uint32_t> indices; // three per triangle
 
   public:
+  size_t VertexCount() const { return vertices.Size(); }
+  size_t TriangleCount() const { return indices.size() / 3; }
+
+  // Valid until the mesh is next modified.
+  MeshView View() const {
+    return {vertices.x.data(), vertices.y.data(), vertices.z.data(), VertexCount(),
+            indices.data(), TriangleCount()};
+  }
+
+  // Appends a vertex and returns its index.
+  uint32_t AddVertex(const VecThree& v);
+
+  // Appends a triangle over existing vertices.
+  void AddTriangle(uint32_t a, uint32_t b, uint32_t c);
+
+  // Appends a triangle with three new vertices of its own; Weld() merges them later.
+  void AddTriangle(const Triangle& tri);
+
+  // Expands triangle t into its three positions.
+  Triangle GetTriangle(size_t t) const;
+
+  void Clear();
+
+  // Merges vertices whose positions match (bit-exact when fEpsilon is 0, otherwise ones
+  // that fall into the same fEpsilon-sized grid cell), drops triangles that collapse as a
+  // result and removes vertices no triangle references. Returns how many vertices were
+  // removed.
+  size_t Weld(float fEpsilon = 0.0f);
+
+  // Replaces the mesh with the triangles of a Wavefront OBJ file (see objloader.h).
+  // Positions shared by several OBJ vertices are welded.
   bool LoadFromObjectFile(std::string sFilename);
 
   // Rotates the mesh around the X axis. fAngle is in degrees.
@@ -34,6 +107,6 @@ class Mesh {
   void Translate(float x, float y, float z);
 
   private:
-  // Internal helper to apply a transformation matrix to all triangles in the mesh.
-  void ApplyMatrix(Matrix& mat);
+  // Internal helper to apply a transformation matrix to all vertices in the mesh.
+  void ApplyMatrix(const Mat4& mat);
 };
@@ -0,0 +1,84 @@
+#pragma once
+#include "bounds.h"
+#include "mappedfile.h"
+#include "mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Binary mesh cache that is memory-mapped and drawn in place.
+//
+// A file is a Header followed by the x, y and z position streams and the index buffer,
+// each starting on an ALIGNMENT boundary, in the layout of VertexBuffer and Mesh::indices
+// and in the byte order of the machine that wrote it. Opening one checks the header and
+// points a MeshView into the mapping: nothing is parsed or copied, and pages are read
+// from disk only as they are first touched.
+namespace meshcache {
+  const uint32_t VERSION = 2; // 2: meshes are stored optimized (meshopt::Optimize)
+  const size_t ALIGNMENT = 64;
+
+  // Size and modification time of the file a cache was converted from.
+  struct SourceStamp {
+    uint64_t size = 0;
+    int64_t time = 0;
+
+    bool operator==(const SourceStamp& other) const {
+      return size == other.size && time == other.time;
+    }
+  };
+
+  struct Header {
+    char magic[8];          // "GEMESH\0\0"
+    uint32_t version;       // VERSION
+    uint32_t byteOrder;     // 0x01020304 as the writer stored it
+    uint64_t fileSize;
+    uint64_t vertexCount;
+    uint64_t triangleCount;
+    uint64_t offsets[4];    // x, y, z and index streams from the start of the file
+    float boundsMin[3];
+    float boundsMax[3];
+    uint64_t contentHash;   // Hash() of the four streams in order
+    SourceStamp source;     // zero when not converted from a file
+  };
+
+  // 64-bit hash of size bytes, chained through seed.
+  uint64_t Hash(const void* data, size_t size, uint64_t seed = 0);
+
+  // False if the file cannot be read.
+  bool GetSourceStamp(const std::string& sFilename, SourceStamp& out);
+
+  // Writes mesh to sFilename. The file is written beside it and renamed into place, so a
+  // process that has the old version mapped keeps a consistent view.
+  bool Write(const std::string& sFilename, const Mesh& mesh, const SourceStamp& source = {});
+
+  // A cache file mapped into memory.
+  class MappedMesh {
+    public:
+    // Fails on a missing or truncated file, a different VERSION or byte order, or
+    // streams outside the file. bVerify also checks the content hash and index range,
+    // which reads the whole file; without it the writer is trusted.
+    bool Open(const std::string& sFilename, bool bVerify = false);
+    void Close();
+    bool IsOpen() const { return m_file.IsOpen(); }
+
+    // Valid while the file stays open.
+    const MeshView& View() const { return m_view; }
+    Aabb GetBounds() const;
+    const Header& GetHeader() const { return m_header; }
+
+    // Copies the streams into an editable mesh.
+    void CopyTo(Mesh& mesh) const;
+
+    private:
+    MappedFile m_file;
+    Header m_header = {};
+    MeshView m_view;
+  };
+
+  // Opens the cache of an OBJ file, sCacheFile or else sObjFile + ".mesh", converting
+  // the OBJ first when the cache is missing, unreadable, from another VERSION or was made
+  // from a different size or modification time of the source. Conversion runs
+  // meshopt::Optimize(), so cached meshes come out in cache-friendly order.
+  bool LoadObj(const std::string& sObjFile, MappedMesh& out, const std::string& sCacheFile = "");
+} // namespace meshcache
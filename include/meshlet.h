@@ -0,0 +1,46 @@
+#pragma once
+#include "bounds.h"
+#include "mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A cluster of neighbouring triangles that is culled as a unit.
+//
+// bounds encloses the meshlet's vertices. Every triangle's unit normal lies within the
+// cone around coneAxis for which the meshlet faces away from any eye at or beyond
+// coneCutoff: it is back-facing as a whole when
+//   dot(center - eye, coneAxis) >= coneCutoff * |center - eye| + radius.
+// A coneCutoff of 1 (normals spread over a half space or more) never passes the test.
+struct Meshlet {
+  uint32_t vertexOffset;   // first position in MeshletMesh::vertices
+  uint32_t triangleOffset; // first local index in MeshletMesh::triangles
+  uint32_t nVertices;
+  uint32_t nTriangles;
+  BoundingSphere bounds;
+  VecThree coneAxis;
+  float coneCutoff;
+};
+
+// A mesh split into meshlets for cluster culling (see Clipper::CullMeshlets).
+//
+// Each meshlet carries its own copy of the positions it uses, so the vertices of the
+// meshlets that survive culling are transformed as contiguous runs and the others are
+// never touched. Triangles index those positions with 8-bit local indices. Build from a
+// mesh that went through meshopt::Optimize(): meshlets are cut from consecutive
+// triangles, so their size and tightness follow the triangle order.
+class MeshletMesh {
+  public:
+  static constexpr size_t MAX_VERTICES = 64;   // per meshlet, at most 256
+  static constexpr size_t MAX_TRIANGLES = 124; // per meshlet
+
+  std::vector<Meshlet> meshlets;
+  VertexBuffer vertices;
+  std::vector<uint8_t> triangles; // three local indices per triangle
+
+  size_t TriangleCount() const { return triangles.size() / 3; }
+
+  static MeshletMesh Build(const MeshView& mesh, size_t nMaxVertices = MAX_VERTICES,
+                           size_t nMaxTriangles = MAX_TRIANGLES);
+};
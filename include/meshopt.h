@@ -0,0 +1,47 @@
+#pragma once
+#include "mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Offline processing of indexed meshes for cheaper drawing.
+//
+// The reordering passes do not change what is drawn, only the order: OptimizeVertexCache()
+// puts triangles that share vertices next to each other, and OptimizeVertexFetch() then
+// numbers the vertices in the order the triangles first use them. Together they keep the
+// clip stage's per-index gathers, and the meshlets built from the result (see meshlet.h),
+// local. Simplify() does change the geometry, for levels of detail (see lod.h). Run them
+// once when a mesh is loaded or converted, not per frame.
+namespace meshopt {
+  // Entries in the simulated LRU cache the triangle order is tuned for.
+  const size_t CACHE_SIZE = 32;
+
+  // Reorders the triangles of indices (three per triangle, each below nVertices) with
+  // Forsyth's greedy scoring: the next triangle is the one whose vertices are most
+  // recently used and have the fewest triangles left, so the mesh is consumed in tight
+  // fans instead of strips across the whole surface. Linear in the triangle count.
+  void OptimizeVertexCache(uint32_t* indices, size_t nIndices, size_t nVertices);
+
+  // Renumbers the vertices of mesh in the order the indices first reference them and
+  // drops vertices no triangle uses. Returns how many vertices were removed.
+  size_t OptimizeVertexFetch(Mesh& mesh);
+
+  // OptimizeVertexCache() on the mesh's indices, then OptimizeVertexFetch().
+  void Optimize(Mesh& mesh);
+
+  // Average vertices transformed per triangle with a FIFO post-transform cache of
+  // cacheSize entries: 3 with no reuse, approaching 0.5 for a large regular grid.
+  float AverageCacheMissRatio(const uint32_t* indices, size_t nIndices, size_t nVertices,
+                              size_t cacheSize = 16);
+
+  // Writes to out a version of mesh with about nTargetTriangles triangles, made by edge
+  // collapses in order of quadric error (Garland-Heckbert). Each collapse moves a vertex
+  // onto a neighbour, so out uses a subset of the original positions. Open borders are
+  // held in place by extra planes along them, and collapses that would flip a triangle
+  // are skipped. Stops early rather than exceed fMaxError, in mesh units. Returns the
+  // error of the result: the worst collapse's root mean square distance to the planes
+  // it absorbed, an estimate in mesh units of how far the surface strays from the
+  // original. out comes out optimized as by Optimize().
+  float Simplify(const Mesh& mesh, size_t nTargetTriangles, Mesh& out,
+                 float fMaxError = 1e30f);
+} // namespace meshopt
@@ -1,35 +1,21 @@
 #pragma once
-#include "mathematics.h"
-#include "matrix.h"
+#include "lod.h"
 #include "mesh.h"
+#include "transform.h"
 
+// A mesh instance placed by a node of the scene's TransformHierarchy.
 struct Object {
-  Mesh* meshAsset;
-  VecThree position;
-  VecThree rotation; // in degrees
-  float scale = 1.0f;
+  Mesh* meshAsset = nullptr;
+  TransformId transform = INVALID_TRANSFORM;
 
-  Matrix GetWorldMatrix() const {
-    // 1. Create Scale matrix
-    Matrix matScale = Matrix::MakeIdentity();
-    matScale.Set(0, 0, scale);
-    matScale.Set(1, 1, scale);
-    matScale.Set(2, 2, scale);
+  // Optional levels of detail of meshAsset, and the one Scene::SelectLods() last chose
+  const LodChain* lods = nullptr;
+  uint32_t lod = 0;
 
-    // 2. Create Rotation matrices
-    Matrix matRotX = Matrix::MakeRotationX(mathematics::DegToRad(rotation.x));
-    Matrix matRotY = Matrix::MakeRotationY(mathematics::DegToRad(rotation.y));
-    Matrix matRotZ = Matrix::MakeRotationZ(mathematics::DegToRad(rotation.z));
+  // Optional mesh, in the same local space, drawn into the occlusion buffer by
+  // Scene::CullOccluded(): meshAsset itself, or a simpler stand-in inside it.
+  const Mesh* occluder = nullptr;
 
-    // 3. Create Translation matrix
-    Matrix matTrans = Matrix::MakeTranslation(position.x, position.y, position.z);
-
-    // 4. Combine them: Scale -> Rotate -> Translate
-    Matrix world = Matrix::Multiply(matScale, matRotX);
-    world = Matrix::Multiply(world, matRotY);
-    world = Matrix::Multiply(world, matRotZ);
-    world = Matrix::Multiply(world, matTrans);
-
-    return world;
-  }
+  // The mesh to draw this frame: the selected level of detail, or meshAsset without any.
+  const Mesh& GetMesh() const { return lods ? lods->levels[lod].mesh : *meshAsset; }
 };
@@ -0,0 +1,47 @@
+#pragma once
+#include "mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Wavefront OBJ parser.
+//
+// The file is memory-mapped and split into chunks at line boundaries that are parsed on
+// separate threads (floats via std::from_chars), then stitched together. Supports v, vt,
+// vn and f records; faces may use any of the v, v/vt, v//vn and v/vt/vn forms, negative
+// (relative) indices, and any number of corners, which are triangulated as fans. Other
+// records (o, g, s, usemtl, comments, ...) are skipped.
+namespace objloader {
+  // Index used for a missing vt or vn reference.
+  const uint32_t NO_INDEX = 0xFFFFFFFFu;
+
+  struct TexCoord {
+    float u = 0.0f;
+    float v = 0.0f;
+    float w = 0.0f;
+  };
+
+  // Zero-based references of one triangle corner.
+  struct Corner {
+    uint32_t v;
+    uint32_t vt;
+    uint32_t vn;
+  };
+
+  struct ObjData {
+    std::vector<VecThree> positions;
+    std::vector<TexCoord> texcoords;
+    std::vector<VecThree> normals;
+    std::vector<Corner> corners; // three per triangle
+  };
+
+  // Parses an in-memory OBJ file. nThreads <= 0 picks one thread per hardware thread; small
+  // inputs are always parsed on the calling thread. Returns false on malformed records or
+  // out-of-range indices.
+  bool Parse(const char* data, size_t size, ObjData& out, int nThreads = 0);
+
+  // Memory-maps sFilename and parses it.
+  bool LoadFile(const std::string& sFilename, ObjData& out, int nThreads = 0);
+} // namespace objloader
@@ -0,0 +1,100 @@
+#pragma once
+#include "bounds.h"
+#include "clipper.h"
+#include "matrix.h"
+#include "mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Low-resolution depth buffer for rejecting objects hidden behind large occluders before
+// they reach the main pipeline.
+//
+// Begin() clears the buffer for a view, AddOccluder() clips and sets up the triangles of a
+// few big meshes (walls, floors, terrain) and Rasterize() writes their depth, 4 pixels at a
+// time with SSE where available and in row bands over a JobSystem. IsOccluded() then tests
+// world boxes against it. Only depth is written, at a fraction of the screen resolution,
+// so the pass costs a small part of drawing the occluders themselves.
+//
+// The test is conservative: each pixel keeps the farthest depth its covering triangle
+// reaches within the pixel, and a box only counts as occluded if every pixel of its screen
+// rectangle, grown by one pixel on each side to cover partially covered pixels along
+// occluder silhouettes, is nearer than the box. Cracks between occluders narrower than a
+// buffer pixel are the exception and may hide what shows through them.
+class OcclusionBuffer {
+  public:
+  static const int DEFAULT_WIDTH = 256;
+  static const int DEFAULT_HEIGHT = 128;
+
+  struct Stats {
+    uint64_t occluders = 0;
+    uint64_t occluderTriangles = 0; // rasterized after clipping
+    uint64_t occludeesTested = 0;
+    uint64_t occludeesOccluded = 0;
+    uint64_t occludeesVisible = 0;
+  };
+
+  explicit OcclusionBuffer(int width = DEFAULT_WIDTH, int height = DEFAULT_HEIGHT);
+
+  // Sets the dimensions. The buffer is independent of the screen resolution; a 2:1 or
+  // screen-shaped aspect works, the view's own projection does the mapping.
+  void Resize(int width, int height);
+
+  // Pool Rasterize() spreads row bands over; null (the default) runs on the calling thread.
+  void SetJobSystem(JobSystem* jobs) { m_pJobs = jobs; }
+
+  // Clears the depth and the pending occluders for a view through viewProjection, the
+  // world-to-clip matrix the occludees will be tested with.
+  void Begin(const Mat4& viewProjection);
+
+  // Queues the triangles of mesh placed by world. They are clipped like DrawMesh ones, but
+  // never back-face culled, so open meshes occlude from both sides.
+  void AddOccluder(const MeshView& mesh, const Mat4& world);
+
+  // Writes the depth of every queued occluder triangle.
+  void Rasterize();
+
+  // Whether a world-space box lies entirely behind the rasterized occluders. Boxes reaching
+  // in front of the near plane or wholly off screen are reported visible.
+  bool IsOccluded(const Aabb& worldBox);
+
+  int GetWidth() const { return m_nWidth; }
+  int GetHeight() const { return m_nHeight; }
+
+  // width * height depths, bottom row first, with Rasterizer::DEPTH_FAR where no occluder
+  // was drawn.
+  const float* GetDepth() const { return m_vDepth.data(); }
+
+  const Stats& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats = Stats(); }
+
+  private:
+  // Edge equations e = a * x + b * y + c, non-negative inside, and the depth plane with the
+  // half-pixel slope already added, all at pixel centers.
+  struct SetupTriangle {
+    float a[3], b[3], c[3];
+    float z0, dzdx, dzdy;
+    int minX, minY, maxX, maxY; // inclusive pixel bounds, clipped to the buffer
+  };
+
+  void Setup(float x0, float y0, float z0, float x1, float y1, float z1, float x2, float y2,
+             float z2);
+  void RasterizeRows(int y0, int y1);
+
+  int m_nWidth = 0;
+  int m_nHeight = 0;
+  std::vector<float> m_vDepth;
+  Mat4 m_viewProjection;
+
+  // Occluder transform and clip, with scratch reused across calls
+  Clipper m_clipper;
+  ClipVertexBuffer m_vClip;
+  VertexBuffer m_vProjected;
+  std::vector<SetupTriangle> m_vTriangles;
+
+  Stats m_stats;
+  JobSystem* m_pJobs = nullptr;
+};
@@ -1,60 +1,116 @@
 #pragma once
 #include "mesh.h"
+#include "voxel.h"
+
+#include <cmath>
 
 namespace primitives {
+  // Adds an axis-aligned box spanning [x, x + sx) x [y, y + sy) x [z, z + sz): 8 corners and
+  // 12 triangles whatever its size.
+  inline void AddBoxToMesh(Mesh &mesh, float x, float y, float z, float sx, float sy, float sz) {
+    // Corner i is offset along X, Y and Z for bits 0, 1 and 2 of i.
+    uint32_t base = (uint32_t)mesh.VertexCount();
+    for (int i = 0; i < 8; i++) {
+      mesh.AddVertex({x + ((i & 1) ? sx : 0.0f), y + ((i & 2) ? sy : 0.0f),
+                      z + ((i & 4) ? sz : 0.0f)});
+    }
+
+    // Define the 12 triangles of a cube over those corners
+    static const uint32_t cubeIndices[36] = {// SOUTH
+                                             0, 2, 3, 0, 3, 1,
+                                             // EAST
+                                             1, 3, 7, 1, 7, 5,
+                                             // NORTH
+                                             5, 7, 6, 5, 6, 4,
+                                             // WEST
+                                             4, 6, 2, 4, 2, 0,
+                                             // TOP
+                                             2, 6, 7, 2, 7, 3,
+                                             // BOTTOM
+                                             5, 4, 0, 5, 0, 1};
+
+    for (int i = 0; i < 36; i += 3) {
+      mesh.AddTriangle(base + cubeIndices[i], base + cubeIndices[i + 1],
+                       base + cubeIndices[i + 2]);
+    }
+  }
+
   // Adds a unit cube to an existing mesh at the specified location
   inline void AddCubeToMesh(Mesh &mesh, float x, float y, float z, float fScale = 1.0f) {
-    float s = fScale;
-
-    // Define the 12 triangles of a cube relative to (x, y, z)
-    std::vector<Triangle> cubeTris = {// SOUTH
-                                      {x, y, z, x, y + s, z, x + s, y + s, z},
-                                      {x, y, z, x + s, y + s, z, x + s, y, z},
-                                      // EAST
-                                      {x + s, y, z, x + s, y + s, z, x + s, y + s, z + s},
-                                      {x + s, y, z, x + s, y + s, z + s, x + s, y, z + s},
-                                      // NORTH
-                                      {x + s, y, z + s, x + s, y + s, z + s, x, y + s, z + s},
-                                      {x + s, y, z + s, x, y + s, z + s, x, y, z + s},
-                                      // WEST
-                                      {x, y, z + s, x, y + s, z + s, x, y + s, z},
-                                      {x, y, z + s, x, y + s, z, x, y, z},
-                                      // TOP
-                                      {x, y + s, z, x, y + s, z + s, x + s, y + s, z + s},
-                                      {x, y + s, z, x + s, y + s, z + s, x + s, y + s, z},
-                                      // BOTTOM
-                                      {x + s, y, z + s, x, y, z + s, x, y, z},
-                                      {x + s, y, z + s, x, y, z, x + s, y, z}};
-
-    for (auto &t : cubeTris) {
-      mesh.tris.push_back(t);
+    AddBoxToMesh(mesh, x, y, z, fScale, fScale, fScale);
+  }
+
+  // Adds a UV sphere centred on (x, y, z): nRings bands of latitude, 2 * nRings segments of
+  // longitude and one shared vertex per pole, so no triangle is degenerate. Faces wind
+  // like the box's.
+  inline void AddSphereToMesh(Mesh &mesh, float x, float y, float z, float fRadius,
+                              int nRings) {
+    const float PI = 3.14159265358979f;
+    const int nSegments = 2 * nRings;
+    uint32_t top = mesh.AddVertex({x, y + fRadius, z});
+    for (int ring = 1; ring < nRings; ++ring) {
+      float theta = PI * (float)ring / (float)nRings;
+      for (int seg = 0; seg < nSegments; ++seg) {
+        float phi = 2.0f * PI * (float)seg / (float)nSegments;
+        mesh.AddVertex({x + fRadius * std::sin(theta) * std::cos(phi),
+                        y + fRadius * std::cos(theta),
+                        z + fRadius * std::sin(theta) * std::sin(phi)});
+      }
+    }
+    uint32_t bottom = mesh.AddVertex({x, y - fRadius, z});
+
+    // Vertex seg of ring r (1 to nRings - 1)
+    auto at = [&](int ring, int seg) {
+      return top + 1 + (uint32_t)((ring - 1) * nSegments + seg % nSegments);
+    };
+    for (int seg = 0; seg < nSegments; ++seg) {
+      mesh.AddTriangle(top, at(1, seg + 1), at(1, seg));
+      for (int ring = 1; ring + 1 < nRings; ++ring) {
+        mesh.AddTriangle(at(ring, seg), at(ring, seg + 1), at(ring + 1, seg + 1));
+        mesh.AddTriangle(at(ring, seg), at(ring + 1, seg + 1), at(ring + 1, seg));
+      }
+      mesh.AddTriangle(at(nRings - 1, seg), at(nRings - 1, seg + 1), bottom);
     }
   }
 
+  // The block builders below describe solid runs of cubes. Their faces between touching
+  // cubes are hidden and the outer faces coplanar, so each reduces to the single box a
+  // greedy voxel mesher would produce. To remove the faces hidden between several such
+  // pieces, build them into a VoxelWorld with the overloads further down instead. A run
+  // with no cubes adds nothing.
+
   // Adds a horizontal floor of cubes
   inline void AddFloor(Mesh &mesh, float x, float y, float z, int w, int d, float fScale = 1.0f) {
-    for (int i = 0; i < w; i++) {
-      for (int j = 0; j < d; j++) {
-        AddCubeToMesh(mesh, x + (i * fScale), y, z + (j * fScale), fScale);
-      }
-    }
+    if (w <= 0 || d <= 0)
+      return;
+    AddBoxToMesh(mesh, x, y, z, w * fScale, fScale, d * fScale);
   }
 
   // Adds a vertical wall of cubes (along the X axis)
   inline void AddWallX(Mesh &mesh, float x, float y, float z, int w, int h, float fScale = 1.0f) {
-    for (int i = 0; i < w; i++) {
-      for (int j = 0; j < h; j++) {
-        AddCubeToMesh(mesh, x + (i * fScale), y + (j * fScale), z, fScale);
-      }
-    }
+    if (w <= 0 || h <= 0)
+      return;
+    AddBoxToMesh(mesh, x, y, z, w * fScale, h * fScale, fScale);
   }
 
   // Adds a vertical wall of cubes (along the Z axis)
   inline void AddWallZ(Mesh &mesh, float x, float y, float z, int d, int h, float fScale = 1.0f) {
-    for (int i = 0; i < d; i++) {
-      for (int j = 0; j < h; j++) {
-        AddCubeToMesh(mesh, x, y + (j * fScale), z + (i * fScale), fScale);
-      }
-    }
+    if (d <= 0 || h <= 0)
+      return;
+    AddBoxToMesh(mesh, x, y, z, fScale, h * fScale, d * fScale);
+  }
+
+  // The same pieces as voxels, in the world's integer voxel coordinates. Call
+  // VoxelWorld::Remesh() once the level is built.
+  inline void AddFloor(VoxelWorld &world, int x, int y, int z, int w, int d) {
+    world.FillBox(x, y, z, x + w, y + 1, z + d);
+  }
+
+  inline void AddWallX(VoxelWorld &world, int x, int y, int z, int w, int h) {
+    world.FillBox(x, y, z, x + w, y + h, z + 1);
+  }
+
+  inline void AddWallZ(VoxelWorld &world, int x, int y, int z, int d, int h) {
+    world.FillBox(x, y, z, x + 1, y + h, z + d);
   }
 } // namespace primitives
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define ENGINE_PROFILE_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Frame profiler.
+//
+// ENGINE_PROFILE_ZONE("Name") times the enclosing scope. Each thread records its zones into
+// its own fixed-size ring buffer without locks; Engine::Run calls EndFrame() once per frame,
+// which drains every buffer on the main thread into per-zone statistics and, while a
+// capture is running, into a trace that WriteChromeTrace() exports as Chrome trace_event
+// JSON (loadable in Perfetto or chrome://tracing).
+//
+// Zones compile to nothing unless ENGINE_PROFILING is defined (the CMake option of the
+// same name, on by default). Zone names must be string literals or otherwise outlive the
+// profiler.
+namespace profiler {
+  struct ZoneStats {
+    std::string sName;
+    double lastMs = 0.0; // summed over all calls and threads in the last frame it ran
+    double avgMs = 0.0;  // over the frames kept in history
+    double p99Ms = 0.0;
+    uint32_t nCalls = 0; // in the last frame it ran
+  };
+
+  // Zone timestamp: the CPU time-stamp counter on x86, which costs a fraction of a clock
+  // query, and steady-clock nanoseconds elsewhere. Ticks are converted to time when
+  // EndFrame() drains them, against a calibration refined every frame.
+  inline int64_t Ticks() {
+#if defined(ENGINE_PROFILE_TSC)
+    return (int64_t)__rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+  }
+
+  // Records a finished zone on the calling thread. Dropped if the thread's buffer is full.
+  void Record(const char* sName, int64_t startTicks, int64_t endTicks);
+
+  // Names the calling thread in trace exports.
+  void SetThreadName(const char* sName);
+
+  // Allocates ahead the buffers of up to nThreads recording threads and the tables for
+  // nZones distinct zone names, so that a thread or zone first seen later does not touch
+  // the heap in EndFrame().
+  void Reserve(int nThreads, size_t nZones = 256);
+
+  // Drains all thread buffers and updates the statistics. Call from one thread only.
+  void EndFrame();
+
+  // Zones seen within the last HISTORY_FRAMES frames, in order of first appearance.
+  const int HISTORY_FRAMES = 120;
+  std::vector<ZoneStats> GetZoneStats();
+
+  // Zones recorded between StartCapture() and StopCapture() are kept for export, up to
+  // MAX_CAPTURE_EVENTS events.
+  const size_t MAX_CAPTURE_EVENTS = 1 << 20;
+  void StartCapture();
+  void StopCapture();
+  bool WriteChromeTrace(const std::string& sFilename);
+
+  // Events lost to full thread buffers or the capture limit.
+  uint64_t GetDroppedEvents();
+
+  class ScopedZone {
+    public:
+    explicit ScopedZone(const char* sName) : m_sName(sName), m_nStart(Ticks()) {}
+    ~ScopedZone() { Record(m_sName, m_nStart, Ticks()); }
+
+    ScopedZone(const ScopedZone&) = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+
+    private:
+    const char* m_sName;
+    int64_t m_nStart;
+  };
+} // namespace profiler
+
+#define ENGINE_PROFILE_CONCAT_(a, b) a##b
+#define ENGINE_PROFILE_CONCAT(a, b) ENGINE_PROFILE_CONCAT_(a, b)
+
+#if defined(ENGINE_PROFILING)
+#define ENGINE_PROFILE_ZONE(name)                                                              \
+  profiler::ScopedZone ENGINE_PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#else
+#define ENGINE_PROFILE_ZONE(name) ((void)0)
+#endif
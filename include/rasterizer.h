@@ -0,0 +1,163 @@
+#pragma once
+#include "blend.h"
+#include "color.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Tiled, binning triangle rasterizer.
+//
+// Submitted triangles are set up once (fixed-point edge equations, top-left fill rule) and
+// binned into screen tiles. Flush() then rasterizes tiles in parallel on a JobSystem: every
+// tile is owned by exactly one job and walks its bin in submission order, so the
+// framebuffer needs no locks and the output is identical for any thread count.
+//
+// Fragments are depth tested (less-or-equal) against the caller's depth buffer. A coarse
+// hierarchical-Z (per-block depth bounds, plus a per-tile maximum) rejects occluded
+// triangles and blocks before any per-pixel work.
+//
+// Each triangle carries the RenderState it was submitted under. The per-pixel loops are
+// instantiated for every combination of blend mode, depth test, depth write and partial
+// color mask, and run four pixels per step with SSE, so a triangle pays for its state once
+// rather than per pixel.
+class Rasterizer {
+  public:
+  static const int TILE_SIZE = 64;
+  static const int BLOCK_SIZE = 8;
+  static const int SUBPIXEL_BITS = 4;
+  static const int SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+
+  // Vertices must lie within +-GUARD_BAND pixels so that edge values inside a block fit in
+  // 32 bits; triangles reaching further out are dropped.
+  static const int GUARD_BAND = 1 << 16;
+
+  // Depth assigned by ClearDepth() to the farthest representable sample.
+  static constexpr float DEPTH_FAR = 1.0f;
+
+  struct Stats {
+    uint64_t trianglesSubmitted = 0;
+    uint64_t trianglesBinned = 0;
+    uint64_t trianglesDropped = 0; // degenerate, off-screen or outside the guard band
+    uint64_t binEntries = 0;
+
+    // Hierarchical-Z early rejection
+    uint64_t hiZTrianglesRejected = 0; // triangle/tile pairs rejected by the tile bound
+    uint64_t hiZBlocksRejected = 0;
+    uint64_t hiZFragmentsRejected = 0; // candidate pixels skipped by either test above
+
+    // Per-pixel depth test
+    uint64_t fragmentsTested = 0;
+    uint64_t fragmentsWritten = 0;
+  };
+
+  Rasterizer();
+  ~Rasterizer();
+
+  Rasterizer(const Rasterizer&) = delete;
+  Rasterizer& operator=(const Rasterizer&) = delete;
+
+  // Sets the target dimensions and (re)allocates the tile bins.
+  void Resize(int width, int height);
+
+  // Pool Flush() spreads tiles over; null (the default) rasterizes on the calling thread.
+  void SetJobSystem(JobSystem* jobs) { m_pJobs = jobs; }
+
+  // State of the triangles submitted from now on (see blend.h).
+  void SetRenderState(const RenderState& state) { m_state = state; }
+  const RenderState& GetRenderState() const { return m_state; }
+
+  // Sets up and bins a screen-space triangle. x and y are in pixels, with fractional
+  // positions kept to 1/SUBPIXEL_SCALE of a pixel; z is the post-divide depth.
+  void Submit(float x0, float y0, float z0, float x1, float y1, float z1, float x2, float y2,
+              float z2, Color color);
+
+  // Resets the hierarchical-Z bounds. Must accompany every clear of the depth buffer.
+  void ClearDepth(float depth = DEPTH_FAR);
+
+  // Rasterizes all pending triangles into framebuffer and depthBuffer (both width * height,
+  // row-major).
+  void Flush(Color* framebuffer, float* depthBuffer);
+
+  // Drops all pending triangles.
+  void Discard();
+
+  bool HasPending() const { return !m_vTriangles.empty(); }
+  const Stats& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats = Stats(); }
+
+  private:
+  // Edge equation E(x, y) = A * x + B * y + C in subpixel units, positive inside, with the
+  // fill-rule bias folded into C.
+  struct Edge {
+    int32_t A;
+    int32_t B;
+    int64_t C;
+  };
+
+  struct SetupTriangle {
+    Edge edges[3];
+    int minX, minY, maxX, maxY; // inclusive pixel bounds, clipped to the screen
+    // Depth plane z = z0 + dzdx * x + dzdy * y at pixel centers, and its range
+    float z0, dzdx, dzdy;
+    float minZ, maxZ;
+    blend::Source source;
+    uint8_t kernel; // index into TRIANGLE_KERNELS
+    bool bDepthTest;
+  };
+
+  // Counters accumulated per tile and merged into m_stats once the flush completes.
+  struct TileCounters {
+    uint64_t hiZTrianglesRejected = 0;
+    uint64_t hiZBlocksRejected = 0;
+    uint64_t hiZFragmentsRejected = 0;
+    uint64_t fragmentsTested = 0;
+    uint64_t fragmentsWritten = 0;
+  };
+
+  void RasterizeTile(int tile);
+  template <BlendMode MODE, bool DEPTH_TEST, bool DEPTH_WRITE, bool MASKED>
+  void RasterizeTriangle(const SetupTriangle& tri, int tile, int x0, int y0, int x1, int y1,
+                         TileCounters& counters);
+
+  // RasterizeTriangle for each state, indexed by blend mode, then depth test, depth write
+  // and partial color mask as bits 2, 1 and 0.
+  using TriangleKernel = void (Rasterizer::*)(const SetupTriangle&, int, int, int, int, int,
+                                              TileCounters&);
+  static const TriangleKernel TRIANGLE_KERNELS[24];
+  float TileMaxDepth(int tile);
+  void ProcessTiles(int firstTile, int endTile);
+
+  int m_nWidth = 0;
+  int m_nHeight = 0;
+  int m_nTilesX = 0;
+  int m_nTilesY = 0;
+
+  int m_nBlocksX = 0;
+  int m_nBlocksY = 0;
+
+  RenderState m_state;
+  std::vector<SetupTriangle> m_vTriangles;
+  std::vector<std::vector<uint32_t>> m_vBins;
+  Stats m_stats;
+
+  // Hierarchical-Z: conservative depth bounds per block, and the maximum over each tile,
+  // recomputed lazily after one of its blocks moved closer.
+  std::vector<float> m_vBlockMinZ;
+  std::vector<float> m_vBlockMaxZ;
+  std::vector<float> m_vTileMaxZ;
+  std::vector<uint8_t> m_vTileMaxDirty;
+
+  // Flush state shared with the tile jobs
+  Color* m_pTarget = nullptr;
+  float* m_pDepth = nullptr;
+  std::atomic<uint64_t> m_nHiZTrianglesRejected{0};
+  std::atomic<uint64_t> m_nHiZBlocksRejected{0};
+  std::atomic<uint64_t> m_nHiZFragmentsRejected{0};
+  std::atomic<uint64_t> m_nFragmentsTested{0};
+  std::atomic<uint64_t> m_nFragmentsWritten{0};
+
+  JobSystem* m_pJobs = nullptr;
+};
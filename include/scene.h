@@ -0,0 +1,109 @@
+#pragma once
+#include "bounds.h"
+#include "bvh.h"
+#include "jobs.h"
+#include "object.h"
+#include "occlusion.h"
+#include "transform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using ObjectId = uint32_t;
+const ObjectId INVALID_OBJECT = UINT32_MAX;
+
+// Object container with world bounds and a BVH for visibility queries.
+//
+// Objects are placed by nodes of the scene's own transform hierarchy. Update() runs the
+// transform update and then refits the BVH leaves of just the objects whose world matrix
+// changed, so static objects cost nothing; adding or removing objects, or a tree that
+// has loosened past REBUILD_DEGRADATION, triggers a full rebuild instead.
+//
+//   scene.Update();
+//   scene.Cull(Frustum::FromMatrix(viewProjection), visible);
+//   scene.CullOccluded(occlusionBuffer, viewProjection, visible);
+//   scene.SelectLods(visible, eye, fFovDegrees, nScreenHeight);
+class Scene {
+  public:
+  TransformHierarchy transforms;
+
+  // Rebuild once the summed BVH node area has grown by this factor through refits.
+  static constexpr float REBUILD_DEGRADATION = 1.5f;
+
+  // mesh must outlive the object. Several objects may share a transform node.
+  ObjectId Add(Mesh* mesh, TransformId transform);
+  void Remove(ObjectId id);
+
+  const Object& GetObject(ObjectId id) const { return m_vObjects[id]; }
+  // Upper bound on object ids; slots of removed objects have a null meshAsset.
+  size_t ObjectCapacity() const { return m_vObjects.size(); }
+
+  // Local bounds of a mesh, computed once per mesh. Call RefreshMeshBounds() after
+  // editing its vertices; that also re-derives every object's world bounds.
+  const Aabb& GetMeshBounds(const Mesh* mesh);
+  const BoundingSphere& GetMeshSphere(const Mesh* mesh);
+  void RefreshMeshBounds(const Mesh* mesh);
+
+  // Updates transforms, world bounds and the BVH. With a job pool, the transforms and
+  // bounds of independently moving subtrees are updated in parallel.
+  void Update(JobSystem* jobs = nullptr);
+
+  // World bounds as of the last Update().
+  const Aabb& GetWorldBounds(ObjectId id) const { return m_vWorldBounds[id]; }
+
+  // Appends the objects whose world bounds intersect the frustum.
+  void Cull(const Frustum& frustum, std::vector<ObjectId>& visible) const;
+
+  const Bvh& GetBvh() const { return m_bvh; }
+
+  // Makes an object an occluder through mesh, in its local space (null clears it); mesh
+  // must outlive the object. Worth it for large objects that hide many others, such as
+  // walls and floors, and not for small ones, which cost more to draw than they hide.
+  void SetOccluder(ObjectId id, const Mesh* mesh) { m_vObjects[id].occluder = mesh; }
+
+  // Draws the occluders among visible (typically the Cull() result) into buffer for a view
+  // through viewProjection, then removes from visible, keeping the order of the rest, the
+  // objects whose world bounds are hidden behind them. Counts go to buffer's stats.
+  void CullOccluded(OcclusionBuffer& buffer, const Mat4& viewProjection,
+                    std::vector<ObjectId>& visible) const;
+
+  // Gives an object levels of detail of its mesh (null removes them); lods must outlive
+  // the object. Its bounds stay those of the full mesh.
+  void SetLods(ObjectId id, const LodChain* lods);
+
+  // Picks the level of detail of each object in ids (typically the culled visible list)
+  // whose error stays within fMaxPixelError pixels, seen from eye through a
+  // Mat4::MakeProjection camera with the given vertical field of view on a screen
+  // nScreenHeight pixels high. Distances are to the nearest point of the object's world
+  // bounds, so an object the eye is inside of gets full detail.
+  void SelectLods(const std::vector<ObjectId>& ids, const VecThree& eye, float fFovDegrees,
+                  int nScreenHeight, float fMaxPixelError = 1.0f);
+
+  private:
+  struct MeshBounds {
+    Aabb box;
+    BoundingSphere sphere;
+  };
+  std::unordered_map<const Mesh*, MeshBounds> m_meshBounds;
+
+  std::vector<Object> m_vObjects;
+  std::vector<Aabb> m_vWorldBounds;
+  std::vector<ObjectId> m_vFreeObjects;
+
+  // Objects per transform node as singly linked lists
+  std::vector<ObjectId> m_vFirstByTransform;
+  std::vector<ObjectId> m_vNextSameTransform;
+
+  Bvh m_bvh;
+  bool m_bRebuild = true;
+
+  // Cached per mesh by Add(), so lookups from parallel updates only read the map.
+  const MeshBounds& BoundsOf(const Mesh* mesh);
+  void UpdateWorldBounds(ObjectId id);
+
+  // Calls f(id) for every object placed by a node in range.
+  template <typename F>
+  void ForEachObject(const TransformHierarchy::Range& range, F&& f) const;
+};
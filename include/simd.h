@@ -0,0 +1,24 @@
+#pragma once
+
+// Compile-time SIMD capability detection. Code paths are selected by the flags the
+// translation unit is built with (see ENGINE_NATIVE_ARCH in CMakeLists.txt); every
+// vectorized routine keeps a scalar fallback for targets without these extensions.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENGINE_SIMD_SSE 1
+#endif
+
+#if defined(__AVX__)
+#define ENGINE_SIMD_AVX 1
+#endif
+
+#if defined(__AVX2__)
+#define ENGINE_SIMD_AVX2 1
+#endif
+
+#if defined(__FMA__)
+#define ENGINE_SIMD_FMA 1
+#endif
+
+#if defined(ENGINE_SIMD_SSE)
+#include <immintrin.h>
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+#include "matrix.h"
+#include "mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Handle to a node of a TransformHierarchy. Stable across reparenting; the id of a
+// destroyed node is reused by a later Create().
+using TransformId = uint32_t;
+const TransformId INVALID_TRANSFORM = UINT32_MAX;
+
+// Scene graph of position/rotation/scale nodes with cached local and world matrices.
+//
+// Nodes are kept in depth-first order, so every subtree occupies a contiguous range with
+// parents ahead of their children, and world matrices sit in one array in that order.
+// Setters only mark a node dirty; Update() rebuilds the local matrices of dirty nodes and
+// the world matrices of their subtrees in a single forward pass over each dirty range,
+// leaving everything else untouched, so a static scene costs nothing per frame.
+//
+// The dirty ranges are disjoint subtrees and can be updated concurrently:
+//
+//   size_t nRanges = transforms.BeginUpdate();
+//   // on any threads, each index once
+//   transforms.UpdateRange(i);
+//
+// Create() under a parent, SetParent() and Destroy() move nodes to keep subtrees
+// contiguous and are linear in the node count; creating roots, or children of the most
+// recently created subtree, appends.
+class TransformHierarchy {
+  public:
+  TransformId Create(TransformId parent = INVALID_TRANSFORM);
+
+  // Destroys the node and all of its descendants.
+  void Destroy(TransformId id);
+
+  // Moves the node and its subtree under parent (a root if INVALID_TRANSFORM), keeping its
+  // local transform. Returns false, changing nothing, if parent is the node or one of its
+  // descendants.
+  bool SetParent(TransformId id, TransformId parent);
+  TransformId GetParent(TransformId id) const;
+
+  void SetPosition(TransformId id, const VecThree& position);
+  void SetRotation(TransformId id, const VecThree& rotation); // in degrees
+  void SetScale(TransformId id, float scale);
+
+  const VecThree& GetPosition(TransformId id) const { return NodeOf(id).position; }
+  const VecThree& GetRotation(TransformId id) const { return NodeOf(id).rotation; }
+  float GetScale(TransformId id) const { return NodeOf(id).scale; }
+
+  // Matrices as of the last Update().
+  const Mat4& GetLocalMatrix(TransformId id) const { return NodeOf(id).local; }
+  const Mat4& GetWorldMatrix(TransformId id) const { return m_vWorld[m_vIndexOf[id]]; }
+
+  // World matrices of all nodes in hierarchy order.
+  const Mat4* GetWorldMatrices() const { return m_vWorld.data(); }
+  size_t Size() const { return m_vNodes.size(); }
+
+  // Brings every world matrix up to date.
+  void Update();
+
+  // Collects the subtrees touched since the last update into disjoint ranges and returns
+  // their count. Each must then be passed to UpdateRange() exactly once before the next
+  // structural change or BeginUpdate().
+  size_t BeginUpdate();
+  void UpdateRange(size_t nRange);
+
+  // Node indices [begin, end) in hierarchy order rebuilt by the last update, valid until
+  // the next structural change, so dependents such as bounds can follow what moved.
+  struct Range {
+    uint32_t begin;
+    uint32_t end;
+  };
+  const std::vector<Range>& GetUpdatedRanges() const { return m_vRanges; }
+  TransformId GetIdAt(uint32_t index) const { return m_vNodes[index].id; }
+
+  // Scale, then rotation about x, y and z, then translation.
+  static Mat4 ComposeLocal(const VecThree& position, const VecThree& rotation, float scale);
+
+  private:
+  static constexpr uint32_t NO_NODE = UINT32_MAX; // parent of roots, index of destroyed ids
+
+  struct Node {
+    Mat4 local = Mat4::MakeIdentity();
+    VecThree position;
+    VecThree rotation;
+    float scale = 1.0f;
+    uint32_t parent = NO_NODE; // index into m_vNodes
+    uint32_t subtreeSize = 1;  // this node and its descendants
+    TransformId id = INVALID_TRANSFORM;
+    bool bDirty = true; // local matrix out of date
+  };
+
+  // Hierarchy order
+  std::vector<Node> m_vNodes;
+  std::vector<Mat4> m_vWorld;
+
+  // Id to current index, and ids free for reuse
+  std::vector<uint32_t> m_vIndexOf;
+  std::vector<TransformId> m_vFreeIds;
+
+  // Nodes changed since the last BeginUpdate(), and the ranges it produced
+  std::vector<TransformId> m_vDirty;
+  std::vector<uint32_t> m_vDirtyIndices;
+  std::vector<Range> m_vRanges;
+
+  const Node& NodeOf(TransformId id) const { return m_vNodes[m_vIndexOf[id]]; }
+  Node& NodeOf(TransformId id) { return m_vNodes[m_vIndexOf[id]]; }
+  void MarkDirty(Node& node);
+
+  // Adds delta to the subtree size of the node at index and of all its ancestors.
+  void AdjustSubtreeSizes(uint32_t index, int64_t delta);
+
+  // Inserts count nodes, whose parents are already final indices, at pos, or removes count
+  // nodes from pos, renumbering the nodes that follow.
+  void Insert(uint32_t pos, const Node* nodes, const Mat4* worlds, uint32_t count);
+  void Erase(uint32_t pos, uint32_t count);
+};
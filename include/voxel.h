@@ -0,0 +1,88 @@
+#pragma once
+#include "mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Dense 32^3 occupancy bitset. Each (y, z) row is one 32-bit word with bit x set for a
+// solid voxel, so neighbour tests along x are shifts and along y or z whole-word ANDs.
+class VoxelChunk {
+  public:
+  static constexpr int SIZE = 32;
+
+  bool Get(int x, int y, int z) const { return (m_rows[y][z] >> x) & 1u; }
+  void Set(int x, int y, int z, bool bSolid) {
+    if (bSolid)
+      m_rows[y][z] |= 1u << x;
+    else
+      m_rows[y][z] &= ~(1u << x);
+  }
+
+  uint32_t Row(int y, int z) const { return m_rows[y][z]; }
+  void SetRow(int y, int z, uint32_t row) { m_rows[y][z] = row; }
+  bool IsEmpty() const;
+
+  // Appends the faces of solid voxels not covered by a solid neighbour, merging coplanar
+  // faces greedily into rectangles. neighbours holds the adjacent chunks in the order
+  // -x, +x, -y, +y, -z, +z; null means empty. Voxel (x, y, z) spans origin + [x, x + 1) *
+  // fVoxelSize on each axis, and outward faces wind like the primitives:: meshes.
+  //
+  // Merged quads can meet a finer neighbour mid-edge (a T-junction); the rasterizer's fill
+  // convention keeps those seams closed only up to float rounding.
+  void AppendMesh(Mesh& mesh, const VoxelChunk* const neighbours[6], const VecThree& origin,
+                  float fVoxelSize) const;
+
+  private:
+  uint32_t m_rows[SIZE][SIZE] = {};
+};
+
+// Unbounded voxel grid stored as sparse VoxelChunks, each with its own cached mesh.
+//
+// Set() and FillBox() only mark chunks dirty: the edited chunk, plus a neighbour when the
+// voxel lies on their shared face. Remesh() rebuilds just those, so editing one voxel
+// costs one chunk (rarely two), not the level.
+class VoxelWorld {
+  public:
+  explicit VoxelWorld(float fVoxelSize = 1.0f, const VecThree& origin = {});
+
+  bool Get(int x, int y, int z) const;
+  void Set(int x, int y, int z, bool bSolid = true);
+
+  // Sets every voxel in [x0, x1) x [y0, y1) x [z0, z1).
+  void FillBox(int x0, int y0, int z0, int x1, int y1, int z1, bool bSolid = true);
+
+  // Re-meshes the chunks edited since the last call and returns how many there were.
+  size_t Remesh();
+
+  // Chunk meshes as of the last Remesh(), in world space. Indices stay valid while chunks
+  // are only edited; Set() on a new chunk may move the meshes in memory.
+  size_t ChunkCount() const { return m_vChunks.size(); }
+  const Mesh& GetChunkMesh(size_t nChunk) const { return m_vChunks[nChunk].mesh; }
+  size_t TriangleCount() const;
+
+  // Appends every chunk mesh, for geometry that will not be edited again.
+  void AppendTo(Mesh& mesh) const;
+
+  private:
+  struct Chunk {
+    VoxelChunk voxels;
+    Mesh mesh;
+    int cx, cy, cz;
+    bool bDirty = false;
+  };
+
+  float m_fVoxelSize;
+  VecThree m_origin;
+  std::vector<Chunk> m_vChunks;
+  std::unordered_map<uint64_t, uint32_t> m_chunkIndex;
+  std::vector<uint32_t> m_vDirty;
+
+  static uint64_t Key(int cx, int cy, int cz);
+  const Chunk* FindChunk(int cx, int cy, int cz) const;
+  Chunk& GetOrCreateChunk(int cx, int cy, int cz);
+
+  // Marks the existing chunks overlapping a voxel box.
+  void MarkDirty(int x0, int y0, int z0, int x1, int y1, int z1);
+};
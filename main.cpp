@@ -4,16 +4,21 @@
 #include "mesh.h"
 #include "object.h"
 #include "primitives.h"
+#include "profiler.h"
+#include "scene.h"
 
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 #include <vector>
 
 class ThreeEngine : public Engine {
   private:
   Mesh m_cubeAsset;
-  std::vector<Object> m_sceneObjects;
-  Matrix m_projectionMatrix{4, 4};
+  Scene m_scene;
+  std::vector<ObjectId> m_vVisible;
+  Mat4 m_projectionMatrix;
 
   public:
   ThreeEngine() = default;
@@ -24,15 +29,16 @@ class ThreeEngine : public Engine {
     primitives::AddCubeToMesh(m_cubeAsset, -0.5f, -0.5f, -0.5f);
 
     // 2. Create actual game objects that USE that asset
-    Object cube1;
-    cube1.meshAsset = &m_cubeAsset;
-    cube1.position = {0.0f, 0.0f, 8.0f}; // Pushed back from 3.0
-    cube1.rotation = {0.0f, 0.0f, 0.0f};
-    m_sceneObjects.push_back(cube1);
+    TransformId cube1 = m_scene.transforms.Create();
+    m_scene.transforms.SetPosition(cube1, {0.0f, 0.0f, 8.0f}); // Pushed back from 3.0
+    m_scene.Add(&m_cubeAsset, cube1);
 
     // 3. Setup Projection
     float fAspectRatio = (float)GetScreenWidth() / (float)GetScreenHeight();
-    m_projectionMatrix = Matrix::MakeProjection(90.0f, fAspectRatio, 0.1f, 100.0f);
+    m_projectionMatrix = Mat4::MakeProjection(90.0f, fAspectRatio, 0.1f, 100.0f);
+
+    // Outward faces of the primitives wind clockwise on screen; drop the ones facing away.
+    SetCullMode(Clipper::CullMode::CCW);
 
     return true;
   }
@@ -40,36 +46,96 @@ class ThreeEngine : public Engine {
   bool OnUpdate(float deltaT) override {
     Clear();
 
-    for (auto& obj : m_sceneObjects) {
-      // 1. Update State
-      obj.rotation.y += 60.0f * deltaT;
-      obj.rotation.x += 30.0f * deltaT;
-
-      // 2. Pipeline: Final Matrix = World * Projection
-      Matrix matFinal = Matrix::Multiply(obj.GetWorldMatrix(), m_projectionMatrix);
+    // 1. Update State
+    TransformHierarchy& transforms = m_scene.transforms;
+    for (ObjectId id = 0; id < (ObjectId)m_scene.ObjectCapacity(); ++id) {
+      const Object& obj = m_scene.GetObject(id);
+      if (!obj.meshAsset) // removed
+        continue;
+      TransformId transform = obj.transform;
+      VecThree rotation = transforms.GetRotation(transform);
+      rotation.y += 60.0f * deltaT;
+      rotation.x += 30.0f * deltaT;
+      transforms.SetRotation(transform, rotation);
+    }
+    // Transform and bounds updates spread over the engine's job pool
+    m_scene.Update(&GetJobs());
 
-      // 3. Render
-      for (const auto& tri : obj.meshAsset->tris) {
-        Triangle triProjected;
-        for (int i = 0; i < 3; i++) {
-          mathematics::ProjectToScreen(tri.points[i], triProjected.points[i], matFinal,
-                                       GetScreenWidth(), GetScreenHeight());
-        }
+    // 2. Only objects inside the view volume go down the pipeline
+    m_vVisible.clear();
+    m_scene.Cull(Frustum::FromMatrix(m_projectionMatrix), m_vVisible);
+    for (ObjectId id : m_vVisible) {
+      const Object& obj = m_scene.GetObject(id);
+      // Pipeline: Final Matrix = World * Projection
+      const Mat4& matWorld = transforms.GetWorldMatrix(obj.transform);
+      Mat4 matFinal = Mat4::Multiply(matWorld, m_projectionMatrix);
 
-        // Now we can just draw the triangle directly
-        DrawTriangle(triProjected, Color::White);
-      }
+      // 3. Render (all vertices projected in one batch)
+      DrawMesh(*obj.meshAsset, matFinal, Color::White);
     }
 
     return true;
   }
 };
 
-int main() {
+// Usage: GraphicsEngine [--headless <frames>] [--dump <prefix> [.ppm|.png]] [--trace <file>]
+//                       [--framebuffers <count>] [--workers <count>] [--fps <target>]
+// --fps turns vsync off and caps the frame rate at target, or leaves it uncapped for 0.
+int main(int argc, char** argv) {
+  Engine::Backend backend = Engine::Backend::Window;
+  int nFrames = 1;
+  std::string sDumpPrefix, sDumpExtension = ".ppm";
+  std::string sTraceFile;
+  int nFramebuffers = 2;
+  int nWorkers = 0;
+  double fTargetFps = -1.0; // vsync
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--headless" && i + 1 < argc) {
+      backend = Engine::Backend::Headless;
+      nFrames = std::atoi(argv[++i]);
+    } else if (arg == "--dump" && i + 1 < argc) {
+      sDumpPrefix = argv[++i];
+      if (i + 1 < argc && argv[i + 1][0] == '.')
+        sDumpExtension = argv[++i];
+    } else if (arg == "--trace" && i + 1 < argc) {
+      sTraceFile = argv[++i];
+    } else if (arg == "--framebuffers" && i + 1 < argc) {
+      nFramebuffers = std::atoi(argv[++i]);
+    } else if (arg == "--workers" && i + 1 < argc) {
+      nWorkers = std::atoi(argv[++i]);
+    } else if (arg == "--fps" && i + 1 < argc) {
+      fTargetFps = std::atof(argv[++i]);
+    } else {
+      std::cerr << "Unknown argument " << arg << std::endl;
+      return 1;
+    }
+  }
+
   ThreeEngine app;
+  app.SetHeadlessFrameCount(nFrames);
+  app.SetFrameDump(sDumpPrefix, sDumpExtension);
+  app.SetFramebufferCount(nFramebuffers);
+  app.SetWorkerCount(nWorkers);
+  if (fTargetFps >= 0.0)
+    app.SetFramePacing(false, fTargetFps);
   // Use our new flexible Initialize method
-  if (app.Initialize(800, 600, "ThreeEngine")) {
+  if (app.Initialize(800, 600, "ThreeEngine", backend)) {
+    if (!sTraceFile.empty())
+      profiler::StartCapture();
     app.Run();
+    if (!sTraceFile.empty()) {
+      profiler::StopCapture();
+      if (!profiler::WriteChromeTrace(sTraceFile))
+        std::cerr << "Failed to write " << sTraceFile << std::endl;
+      for (const profiler::ZoneStats& zone : profiler::GetZoneStats()) {
+        std::cout << zone.sName << ": last " << zone.lastMs << " ms, avg " << zone.avgMs
+                  << " ms, p99 " << zone.p99Ms << " ms" << std::endl;
+      }
+      FramePacer::Stats timing = app.GetFrameTiming();
+      std::cout << "Frame interval: avg " << timing.meanMs << " ms, p99 " << timing.p99Ms
+                << " ms, jitter " << timing.jitterMs << " ms" << std::endl;
+    }
   } else {
     std::cerr << "Failed to initialize engine" << std::endl;
   }
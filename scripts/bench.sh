@@ -0,0 +1,19 @@
+#!/bin/bash
+# Builds and runs the benchmark suite, saving results as build/bench/<commit>.json.
+# Usage: ./scripts/bench.sh [baseline.json] [extra GraphicsEngineBench options]
+set -e
+
+./scripts/build.sh
+
+mkdir -p build/bench
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo local)
+OUT="build/bench/$COMMIT.json"
+
+if [ -n "$1" ] && [ -f "$1" ]; then
+    BASELINE="$1"
+    shift
+    ./build/GraphicsEngineBench --json "$OUT" --baseline "$BASELINE" "$@"
+else
+    ./build/GraphicsEngineBench --json "$OUT" "$@"
+fi
+echo "Results written to $OUT"
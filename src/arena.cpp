@@ -0,0 +1,58 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cassert>
+
+FrameArena::FrameArena(size_t nInitialSize) {
+  m_vBlocks.reserve(8);
+  AddBlock(nInitialSize);
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+  assert((alignment & (alignment - 1)) == 0);
+  while (true) {
+    Block& block = m_vBlocks[m_nCurrent];
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+    size_t offset = ((base + m_nOffset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+    if (offset + size <= block.size) {
+      m_nOffset = offset + size;
+      m_nHighWater = std::max(m_nHighWater, m_nUsedBefore + m_nOffset);
+      return block.memory.get() + offset;
+    }
+    // Move on to the next block, adding one big enough if there is none.
+    m_nUsedBefore += m_nOffset;
+    m_nOffset = 0;
+    if (++m_nCurrent == m_vBlocks.size())
+      AddBlock(std::max(block.size * 2, size + alignment));
+  }
+}
+
+void FrameArena::Reset() {
+  if (m_vBlocks.size() > 1) {
+    // Outgrown: one block sized for the busiest frame replaces the chain.
+    size_t nSize = m_vBlocks[0].size;
+    while (nSize < m_nHighWater)
+      nSize *= 2;
+    m_vBlocks.clear();
+    AddBlock(nSize);
+  }
+  m_nCurrent = 0;
+  m_nOffset = 0;
+  m_nUsedBefore = 0;
+}
+
+FrameArena::Stats FrameArena::GetStats() const {
+  Stats stats;
+  stats.nUsed = m_nUsedBefore + m_nOffset;
+  for (const Block& block : m_vBlocks)
+    stats.nCapacity += block.size;
+  stats.nHighWater = m_nHighWater;
+  stats.nBlockAllocations = m_nBlockAllocations;
+  return stats;
+}
+
+void FrameArena::AddBlock(size_t nMinSize) {
+  size_t nSize = std::max<size_t>(nMinSize, 64);
+  m_vBlocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[nSize]), nSize});
+  ++m_nBlockAllocations;
+}
@@ -0,0 +1,54 @@
+#include "blend.h"
+
+namespace {
+  template <BlendMode MODE, bool MASKED>
+  void SpanT(Color* dst, size_t count, const blend::Source& src) {
+    uint32_t* pixels = reinterpret_cast<uint32_t*>(dst);
+    size_t i = 0;
+#if defined(ENGINE_SIMD_SSE)
+    const blend::Source4 src4(src);
+    for (; i + 4 <= count; i += 4) {
+      __m128i* p = reinterpret_cast<__m128i*>(pixels + i);
+      _mm_storeu_si128(p, blend::Apply<MODE, MASKED>(_mm_loadu_si128(p), src4));
+    }
+#endif
+    for (; i < count; ++i)
+      pixels[i] = blend::Apply<MODE, MASKED>(pixels[i], src);
+  }
+
+  template <BlendMode MODE>
+  void SpanMasked(Color* dst, size_t count, const blend::Source& src, bool bMasked) {
+    if (bMasked)
+      SpanT<MODE, true>(dst, count, src);
+    else
+      SpanT<MODE, false>(dst, count, src);
+  }
+} // namespace
+
+namespace blend {
+  Source MakeSource(Color color, BlendMode mode, uint8_t colorMask) {
+    Source src;
+    const uint8_t channels[4] = {color.r, color.g, color.b, color.a};
+    for (int c = 0; c < 4; ++c) {
+      src.premultiplied[c] = (uint16_t)(channels[c] * color.a);
+      if (mode == BlendMode::Additive)
+        src.color |= DivideBy255(src.premultiplied[c]) << (8 * c);
+      if (colorMask & (1 << c))
+        src.mask |= 0xffu << (8 * c);
+    }
+    src.inverseAlpha = (uint16_t)(255 - color.a);
+    if (mode != BlendMode::Additive)
+      src.color = color.Pack();
+    return src;
+  }
+
+  void Span(Color* dst, size_t count, Color color, BlendMode mode, uint8_t colorMask) {
+    const Source src = MakeSource(color, mode, colorMask);
+    const bool bMasked = colorMask != MaskAll;
+    switch (mode) {
+      case BlendMode::Opaque: SpanMasked<BlendMode::Opaque>(dst, count, src, bMasked); break;
+      case BlendMode::Alpha: SpanMasked<BlendMode::Alpha>(dst, count, src, bMasked); break;
+      case BlendMode::Additive: SpanMasked<BlendMode::Additive>(dst, count, src, bMasked); break;
+    }
+  }
+} // namespace blend
@@ -0,0 +1,134 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+VecThree Aabb::Center() const {
+  return {(min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f};
+}
+
+float Aabb::SurfaceArea() const {
+  if (IsEmpty())
+    return 0.0f;
+  float dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+  return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+float Aabb::Distance(const VecThree& point) const {
+  float dx = std::max({min.x - point.x, 0.0f, point.x - max.x});
+  float dy = std::max({min.y - point.y, 0.0f, point.y - max.y});
+  float dz = std::max({min.z - point.z, 0.0f, point.z - max.z});
+  return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void Aabb::Expand(const VecThree& point) {
+  min = {std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z)};
+  max = {std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z)};
+}
+
+void Aabb::Merge(const Aabb& box) {
+  min = {std::min(min.x, box.min.x), std::min(min.y, box.min.y), std::min(min.z, box.min.z)};
+  max = {std::max(max.x, box.max.x), std::max(max.y, box.max.y), std::max(max.z, box.max.z)};
+}
+
+Aabb Aabb::Transformed(const Mat4& transform) const {
+  if (IsEmpty())
+    return *this;
+  // Each output axis starts from the translation and takes, per input axis, whichever
+  // end of the box pushes it further (Arvo).
+  const float* in[2] = {&min.x, &max.x};
+  float lo[3], hi[3];
+  for (int col = 0; col < 3; ++col) {
+    lo[col] = hi[col] = transform.m[3][col];
+    for (int row = 0; row < 3; ++row) {
+      float a = transform.m[row][col] * in[0][row];
+      float b = transform.m[row][col] * in[1][row];
+      lo[col] += std::min(a, b);
+      hi[col] += std::max(a, b);
+    }
+  }
+  Aabb box;
+  box.min = {lo[0], lo[1], lo[2]};
+  box.max = {hi[0], hi[1], hi[2]};
+  return box;
+}
+
+Aabb Aabb::FromMesh(const Mesh& mesh) {
+  Aabb box;
+  for (size_t i = 0; i < mesh.VertexCount(); ++i)
+    box.Expand(mesh.vertices.Get(i));
+  return box;
+}
+
+BoundingSphere BoundingSphere::FromMesh(const Mesh& mesh) {
+  BoundingSphere sphere;
+  Aabb box = Aabb::FromMesh(mesh);
+  if (box.IsEmpty())
+    return sphere;
+  sphere.center = box.Center();
+  float radiusSq = 0.0f;
+  for (size_t i = 0; i < mesh.VertexCount(); ++i) {
+    VecThree v = mesh.vertices.Get(i);
+    float dx = v.x - sphere.center.x, dy = v.y - sphere.center.y, dz = v.z - sphere.center.z;
+    radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+  }
+  sphere.radius = std::sqrt(radiusSq);
+  return sphere;
+}
+
+Frustum Frustum::FromMatrix(const Mat4& clip) {
+  // With row vectors clip = v * M, so each clip coordinate is v dotted with a column of M
+  // and every bound such as x <= w becomes the plane (column w - column x) . v >= 0.
+  auto column = [&](int c) {
+    return Plane{clip.m[0][c], clip.m[1][c], clip.m[2][c], clip.m[3][c]};
+  };
+  auto combine = [](const Plane& p, const Plane& q, float sign) {
+    return Plane{p.a + sign * q.a, p.b + sign * q.b, p.c + sign * q.c, p.d + sign * q.d};
+  };
+  Plane x = column(0), y = column(1), z = column(2), w = column(3);
+
+  Frustum frustum;
+  frustum.planes[Left] = combine(w, x, 1.0f);
+  frustum.planes[Right] = combine(w, x, -1.0f);
+  frustum.planes[Bottom] = combine(w, y, 1.0f);
+  frustum.planes[Top] = combine(w, y, -1.0f);
+  frustum.planes[Near] = z;
+  frustum.planes[Far] = combine(w, z, -1.0f);
+
+  // Unit normals make the plane value a distance, as the sphere test needs.
+  for (Plane& p : frustum.planes) {
+    float length = std::sqrt(p.a * p.a + p.b * p.b + p.c * p.c);
+    if (length > 0.0f) {
+      p.a /= length;
+      p.b /= length;
+      p.c /= length;
+      p.d /= length;
+    }
+  }
+  return frustum;
+}
+
+bool Frustum::Intersects(const Aabb& box) const {
+  if (box.IsEmpty())
+    return false;
+  for (const Plane& p : planes) {
+    // The corner furthest along the plane normal
+    float x = p.a >= 0.0f ? box.max.x : box.min.x;
+    float y = p.b >= 0.0f ? box.max.y : box.min.y;
+    float z = p.c >= 0.0f ? box.max.z : box.min.z;
+    if (p.a * x + p.b * y + p.c * z + p.d < 0.0f)
+      return false;
+  }
+  return true;
+}
+
+bool Frustum::Intersects(const BoundingSphere& sphere) const {
+  if (sphere.radius < 0.0f)
+    return false;
+  for (const Plane& p : planes) {
+    float distance = p.a * sphere.center.x + p.b * sphere.center.y + p.c * sphere.center.z + p.d;
+    if (distance < -sphere.radius)
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,164 @@
+#include "bvh.h"
+
+#include <algorithm>
+
+namespace {
+  // Per-plane classification of a box: -1 when outside any plane in mask, otherwise the
+  // subset of mask whose planes still cut the box (0 once it is wholly inside).
+  int ClassifyBox(const Frustum& frustum, const Aabb& box, int mask) {
+    int remaining = 0;
+    for (int i = 0; i < Frustum::PlaneCount; ++i) {
+      if (!(mask & (1 << i)))
+        continue;
+      const Frustum::Plane& p = frustum.planes[i];
+      float farthest = p.a * (p.a >= 0.0f ? box.max.x : box.min.x) +
+                       p.b * (p.b >= 0.0f ? box.max.y : box.min.y) +
+                       p.c * (p.c >= 0.0f ? box.max.z : box.min.z) + p.d;
+      if (farthest < 0.0f)
+        return -1;
+      float nearest = p.a * (p.a >= 0.0f ? box.min.x : box.max.x) +
+                      p.b * (p.b >= 0.0f ? box.min.y : box.max.y) +
+                      p.c * (p.c >= 0.0f ? box.min.z : box.max.z) + p.d;
+      if (nearest < 0.0f)
+        remaining |= 1 << i;
+    }
+    return remaining;
+  }
+
+  const int ALL_PLANES = (1 << Frustum::PlaneCount) - 1;
+} // namespace
+
+void Bvh::Build(const Aabb* boxes, size_t count) {
+  std::vector<BuildItem>& items = m_vBuildItems;
+  items.clear();
+  items.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (!boxes[i].IsEmpty())
+      items.push_back({(uint32_t)i, boxes[i], boxes[i].Center()});
+  }
+
+  m_vNodes.clear();
+  m_vSlotOf.assign(count, NO_NODE);
+  m_vItems.resize(items.size());
+  m_vItemBounds.resize(items.size());
+  m_vLeafOf.resize(items.size());
+  m_fArea = 0.0;
+  if (items.empty()) {
+    m_fBuildArea = 0.0;
+    return;
+  }
+
+  m_vNodes.reserve(2 * (items.size() / LEAF_SIZE + 1));
+  m_vNodes.push_back(Node{Aabb(), 0, 0, 0, NO_NODE});
+  BuildNode(items, 0, 0, (uint32_t)items.size());
+  for (uint32_t slot = 0; slot < (uint32_t)items.size(); ++slot) {
+    m_vItems[slot] = items[slot].item;
+    m_vItemBounds[slot] = items[slot].bounds;
+    m_vSlotOf[items[slot].item] = slot;
+  }
+  m_fBuildArea = m_fArea;
+}
+
+void Bvh::BuildNode(std::vector<BuildItem>& items, uint32_t node, uint32_t first,
+                    uint32_t count) {
+  Aabb bounds, centroids;
+  for (uint32_t i = first; i < first + count; ++i) {
+    bounds.Merge(items[i].bounds);
+    centroids.Expand(items[i].centroid);
+  }
+  m_vNodes[node].bounds = bounds;
+  m_vNodes[node].first = first;
+  m_vNodes[node].count = count;
+  m_fArea += bounds.SurfaceArea();
+
+  if (count <= LEAF_SIZE) {
+    for (uint32_t i = first; i < first + count; ++i)
+      m_vLeafOf[i] = node;
+    return;
+  }
+
+  VecThree extent = {centroids.max.x - centroids.min.x, centroids.max.y - centroids.min.y,
+                     centroids.max.z - centroids.min.z};
+  int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+  uint32_t half = count / 2;
+  std::nth_element(items.begin() + first, items.begin() + first + half,
+                   items.begin() + first + count,
+                   [axis](const BuildItem& a, const BuildItem& b) {
+                     return (&a.centroid.x)[axis] < (&b.centroid.x)[axis];
+                   });
+
+  uint32_t left = (uint32_t)m_vNodes.size();
+  m_vNodes.push_back(Node{Aabb(), 0, 0, 0, node});
+  m_vNodes.push_back(Node{Aabb(), 0, 0, 0, node});
+  m_vNodes[node].left = left;
+  BuildNode(items, left, first, half);
+  BuildNode(items, left + 1, first + half, count - half);
+}
+
+void Bvh::Refit(uint32_t item, const Aabb& box) {
+  uint32_t slot = item < m_vSlotOf.size() ? m_vSlotOf[item] : NO_NODE;
+  if (slot == NO_NODE)
+    return;
+  m_vItemBounds[slot] = box;
+
+  uint32_t node = m_vLeafOf[slot];
+  const Node& leaf = m_vNodes[node];
+  Aabb bounds;
+  for (uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i)
+    bounds.Merge(m_vItemBounds[i]);
+
+  // Walk up until a node's box comes out unchanged; everything above is then still exact.
+  // Items moving together mostly stop below ancestors an earlier one already updated.
+  while (true) {
+    Node& n = m_vNodes[node];
+    if (n.bounds.min.x == bounds.min.x && n.bounds.min.y == bounds.min.y &&
+        n.bounds.min.z == bounds.min.z && n.bounds.max.x == bounds.max.x &&
+        n.bounds.max.y == bounds.max.y && n.bounds.max.z == bounds.max.z)
+      break;
+    m_fArea += (double)bounds.SurfaceArea() - (double)n.bounds.SurfaceArea();
+    n.bounds = bounds;
+    if (n.parent == NO_NODE)
+      break;
+    node = n.parent;
+    bounds = m_vNodes[m_vNodes[node].left].bounds;
+    bounds.Merge(m_vNodes[m_vNodes[node].left + 1].bounds);
+  }
+}
+
+float Bvh::GetDegradation() const {
+  return m_fBuildArea > 0.0 ? (float)(m_fArea / m_fBuildArea) : 1.0f;
+}
+
+void Bvh::Query(const Frustum& frustum, std::vector<uint32_t>& out) const {
+  if (m_vNodes.empty())
+    return;
+
+  // Median splits keep the depth near log2(items / LEAF_SIZE), far below this.
+  struct Entry {
+    uint32_t node;
+    int mask;
+  };
+  Entry stack[64];
+  int nStack = 0;
+  stack[nStack++] = {0, ALL_PLANES};
+
+  while (nStack > 0) {
+    Entry e = stack[--nStack];
+    const Node& node = m_vNodes[e.node];
+    int mask = ClassifyBox(frustum, node.bounds, e.mask);
+    if (mask < 0)
+      continue;
+    if (mask == 0) {
+      out.insert(out.end(), m_vItems.begin() + node.first,
+                 m_vItems.begin() + node.first + node.count);
+    } else if (node.left == 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        if (ClassifyBox(frustum, m_vItemBounds[i], mask) >= 0)
+          out.push_back(m_vItems[i]);
+      }
+    } else {
+      stack[nStack++] = {node.left + 1, mask};
+      stack[nStack++] = {node.left, mask};
+    }
+  }
+}
@@ -0,0 +1,246 @@
+#include "clipper.h"
+
+#include "bounds.h"
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  // Outcode bits. The first six are the frustum planes; GUARD marks vertices the
+  // rasterizer cannot take in fixed point, which only forces clipping, never rejection.
+  const uint8_t OUT_LEFT = 1 << 0;
+  const uint8_t OUT_RIGHT = 1 << 1;
+  const uint8_t OUT_BOTTOM = 1 << 2;
+  const uint8_t OUT_TOP = 1 << 3;
+  const uint8_t OUT_NEAR = 1 << 4;
+  const uint8_t OUT_FAR = 1 << 5;
+  const uint8_t OUT_GUARD = 1 << 6;
+
+  const uint8_t OUT_FRUSTUM = OUT_LEFT | OUT_RIGHT | OUT_BOTTOM | OUT_TOP | OUT_NEAR | OUT_FAR;
+  const uint8_t OUT_NEEDS_CLIP = OUT_NEAR | OUT_FAR | OUT_GUARD;
+
+  // Sutherland-Hodgman needs at most one extra vertex per plane: 3 + 6.
+  const int MAX_POLY_VERTICES = 9;
+} // namespace
+
+void Clipper::SetViewport(int width, int height) {
+  m_nWidth = width;
+  m_nHeight = height;
+  // Keep clipped vertices well inside the rasterizer's fixed-point range.
+  m_fGuardX = 0.5f * (float)Rasterizer::GUARD_BAND / (0.5f * (float)width);
+  m_fGuardY = 0.5f * (float)Rasterizer::GUARD_BAND / (0.5f * (float)height);
+}
+
+void Clipper::Process(const ClipVertexBuffer& clip, const uint32_t* indices, size_t triangleCount,
+                      VertexBuffer& out) {
+  const size_t nVertices = clip.Size();
+  const float fHalfWidth = 0.5f * (float)m_nWidth;
+  const float fHalfHeight = 0.5f * (float)m_nHeight;
+
+  // One pass over the vertices: outcodes plus the projected position. The projection is
+  // only consumed for triangles with every vertex in front of the near plane (w > 0).
+  m_vOutcodes.resize(nVertices);
+  m_vScreen.Resize(nVertices);
+  for (size_t i = 0; i < nVertices; ++i) {
+    float x = clip.x[i], y = clip.y[i], z = clip.z[i], w = clip.w[i];
+    uint8_t code = 0;
+    code |= (x < -w) ? OUT_LEFT : 0;
+    code |= (x > w) ? OUT_RIGHT : 0;
+    code |= (y < -w) ? OUT_BOTTOM : 0;
+    code |= (y > w) ? OUT_TOP : 0;
+    code |= (z < 0.0f) ? OUT_NEAR : 0;
+    code |= (z > w) ? OUT_FAR : 0;
+    code |= (std::abs(x) > m_fGuardX * w || std::abs(y) > m_fGuardY * w) ? OUT_GUARD : 0;
+    m_vOutcodes[i] = code;
+
+    float invW = (w > 0.0f) ? 1.0f / w : 0.0f;
+    m_vScreen.x[i] = (x * invW + 1.0f) * fHalfWidth;
+    m_vScreen.y[i] = (y * invW + 1.0f) * fHalfHeight;
+    m_vScreen.z[i] = z * invW;
+  }
+
+  out.Resize(std::max<size_t>(out.Size(), triangleCount * 3));
+  m_nOut = 0;
+  m_stats.trianglesIn += triangleCount;
+
+  for (size_t t = 0; t < triangleCount; ++t) {
+    uint32_t i0, i1, i2;
+    if (indices) {
+      i0 = indices[t * 3];
+      i1 = indices[t * 3 + 1];
+      i2 = indices[t * 3 + 2];
+    } else {
+      i0 = (uint32_t)(t * 3);
+      i1 = i0 + 1;
+      i2 = i0 + 2;
+    }
+
+    uint8_t c0 = m_vOutcodes[i0], c1 = m_vOutcodes[i1], c2 = m_vOutcodes[i2];
+    if (c0 & c1 & c2 & OUT_FRUSTUM) {
+      ++m_stats.trianglesCulledFrustum;
+      continue;
+    }
+
+    if ((c0 | c1 | c2) & OUT_NEEDS_CLIP) {
+      ClipVertex tri[3] = {{clip.x[i0], clip.y[i0], clip.z[i0], clip.w[i0]},
+                           {clip.x[i1], clip.y[i1], clip.z[i1], clip.w[i1]},
+                           {clip.x[i2], clip.y[i2], clip.z[i2], clip.w[i2]}};
+      ClipAndEmit(tri, out);
+      continue;
+    }
+
+    const float* sx = m_vScreen.x.data();
+    const float* sy = m_vScreen.y.data();
+    const float* sz = m_vScreen.z.data();
+    float area = (sx[i1] - sx[i0]) * (sy[i2] - sy[i0]) - (sy[i1] - sy[i0]) * (sx[i2] - sx[i0]);
+    if (IsCulled(area)) {
+      ++m_stats.trianglesCulledBackFace;
+      continue;
+    }
+    Emit(out, sx[i0], sy[i0], sz[i0]);
+    Emit(out, sx[i1], sy[i1], sz[i1]);
+    Emit(out, sx[i2], sy[i2], sz[i2]);
+    ++m_stats.trianglesOut;
+  }
+
+  out.Resize(m_nOut);
+}
+
+void Clipper::ClipAndEmit(const ClipVertex in[3], VertexBuffer& out) {
+  ClipVertex bufA[MAX_POLY_VERTICES];
+  ClipVertex bufB[MAX_POLY_VERTICES];
+  ClipVertex* poly = bufA;
+  ClipVertex* next = bufB;
+  int nPoly = 3;
+  std::copy(in, in + 3, poly);
+
+  // Signed distance to each clip plane, positive inside.
+  auto distance = [this](int plane, const ClipVertex& v) {
+    switch (plane) {
+      case 0: return v.z;
+      case 1: return v.w - v.z;
+      case 2: return m_fGuardX * v.w - v.x;
+      case 3: return m_fGuardX * v.w + v.x;
+      case 4: return m_fGuardY * v.w - v.y;
+      default: return m_fGuardY * v.w + v.y;
+    }
+  };
+
+  for (int plane = 0; plane < 6 && nPoly > 0; ++plane) {
+    int nNext = 0;
+    for (int i = 0; i < nPoly; ++i) {
+      const ClipVertex& a = poly[i];
+      const ClipVertex& b = poly[(i + 1) % nPoly];
+      float da = distance(plane, a);
+      float db = distance(plane, b);
+      if (da >= 0.0f)
+        next[nNext++] = a;
+      if ((da >= 0.0f) != (db >= 0.0f)) {
+        float t = da / (da - db);
+        next[nNext++] = {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t,
+                         a.w + (b.w - a.w) * t};
+      }
+    }
+    std::swap(poly, next);
+    nPoly = nNext;
+  }
+
+  ++m_stats.trianglesClipped;
+  if (nPoly < 3) {
+    ++m_stats.trianglesClippedAway;
+    return;
+  }
+
+  // Divide and map to the viewport.
+  const float fHalfWidth = 0.5f * (float)m_nWidth;
+  const float fHalfHeight = 0.5f * (float)m_nHeight;
+  float sx[MAX_POLY_VERTICES], sy[MAX_POLY_VERTICES], sz[MAX_POLY_VERTICES];
+  for (int i = 0; i < nPoly; ++i) {
+    if (poly[i].w <= 0.0f) {
+      ++m_stats.trianglesClippedAway;
+      return;
+    }
+    float invW = 1.0f / poly[i].w;
+    sx[i] = (poly[i].x * invW + 1.0f) * fHalfWidth;
+    sy[i] = (poly[i].y * invW + 1.0f) * fHalfHeight;
+    sz[i] = poly[i].z * invW;
+  }
+
+  // The clipped polygon is planar and convex, so its winding is that of the whole fan.
+  float area = 0.0f;
+  for (int i = 0; i < nPoly; ++i) {
+    int j = (i + 1) % nPoly;
+    area += sx[i] * sy[j] - sx[j] * sy[i];
+  }
+  if (IsCulled(area)) {
+    ++m_stats.trianglesCulledBackFace;
+    return;
+  }
+
+  for (int i = 1; i + 1 < nPoly; ++i) {
+    Emit(out, sx[0], sy[0], sz[0]);
+    Emit(out, sx[i], sy[i], sz[i]);
+    Emit(out, sx[i + 1], sy[i + 1], sz[i + 1]);
+    ++m_stats.trianglesOut;
+  }
+}
+
+void Clipper::CullMeshlets(const MeshletMesh& mesh, const Mat4& transform,
+                           std::vector<uint32_t>& visible) {
+  const Frustum frustum = Frustum::FromMatrix(transform);
+
+  // The eye is the object-space point the transform sends to x = y = w = 0, found as the
+  // cofactors of the x, y and w columns. A projected triangle facing it then has a screen
+  // area of sign -eye.w, which together with the cull mode says whether meshlets facing
+  // the eye or facing away are rejected. An orthographic transform (eye.w = 0) has no eye
+  // point and only gets frustum culling.
+  const Mat4& m = transform;
+  auto minor = [&](int r0, int r1, int r2) {
+    return m.m[r0][0] * (m.m[r1][1] * m.m[r2][3] - m.m[r1][3] * m.m[r2][1]) -
+           m.m[r0][1] * (m.m[r1][0] * m.m[r2][3] - m.m[r1][3] * m.m[r2][0]) +
+           m.m[r0][3] * (m.m[r1][0] * m.m[r2][1] - m.m[r1][1] * m.m[r2][0]);
+  };
+  float ex = -minor(1, 2, 3), ey = minor(0, 2, 3), ez = -minor(0, 1, 3), ew = minor(0, 1, 2);
+  float facing = 0.0f; // 1 rejects meshlets facing away from the eye, -1 those facing it
+  if (m_cullMode != CullMode::None && ew != 0.0f) {
+    bool bFacingAreaPositive = ew < 0.0f;
+    facing = (m_cullMode == CullMode::CCW) == bFacingAreaPositive ? -1.0f : 1.0f;
+  }
+  const VecThree eye = {ex / ew, ey / ew, ez / ew};
+
+  m_stats.meshletsIn += mesh.meshlets.size();
+  for (uint32_t i = 0; i < (uint32_t)mesh.meshlets.size(); ++i) {
+    const Meshlet& meshlet = mesh.meshlets[i];
+    if (!frustum.Intersects(meshlet.bounds)) {
+      ++m_stats.meshletsCulledFrustum;
+      continue;
+    }
+    if (facing != 0.0f) {
+      const VecThree& c = meshlet.bounds.center;
+      const VecThree& axis = meshlet.coneAxis;
+      float dx = c.x - eye.x, dy = c.y - eye.y, dz = c.z - eye.z;
+      float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+      if (facing * (dx * axis.x + dy * axis.y + dz * axis.z) >=
+          meshlet.coneCutoff * distance + meshlet.bounds.radius) {
+        ++m_stats.meshletsCulledBackFace;
+        continue;
+      }
+    }
+    visible.push_back(i);
+  }
+}
+
+bool Clipper::IsCulled(float signedArea) const {
+  return (m_cullMode == CullMode::CW && signedArea < 0.0f) ||
+         (m_cullMode == CullMode::CCW && signedArea > 0.0f);
+}
+
+void Clipper::Emit(VertexBuffer& out, float x, float y, float z) {
+  if (m_nOut == out.Size())
+    out.Resize(std::max<size_t>(64, out.Size() * 2));
+  out.x[m_nOut] = x;
+  out.y[m_nOut] = y;
+  out.z[m_nOut] = z;
+  ++m_nOut;
+}
@@ -0,0 +1,8 @@
+#include "color.h"
+
+// Static Color definitions
+const Color Color::White = {255, 255, 255, 255};
+const Color Color::Red = {255, 0, 0, 255};
+const Color Color::Green = {0, 255, 0, 255};
+const Color Color::Blue = {0, 0, 255, 255};
+const Color Color::Black = {0, 0, 0, 255};
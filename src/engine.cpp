@@ -1,21 +1,25 @@
 #include "engine.h"
 
+#include "fill.h"
+#include "image.h"
+#include "mathematics.h"
+#include "profiler.h"
+
 #include <GL/gl.h>
+#include <algorithm>
+#include <cassert>
 #include <cmath>
-
-// Static Color definitions
-const Color Color::White = {255, 255, 255, 255};
-const Color Color::Red = {255, 0, 0, 255};
-const Color Color::Green = {0, 255, 0, 255};
-const Color Color::Blue = {0, 0, 255, 255};
-const Color Color::Black = {0, 0, 0, 255};
+#include <cstddef>
+#include <cstdio>
 
 namespace platform {
   bool Init() { return glfwInit() == GLFW_TRUE; }
   void Shutdown() { glfwTerminate(); }
   void PollEvents() { glfwPollEvents(); }
   bool WindowShouldClose(GLFWwindow* w) { return glfwWindowShouldClose(w); }
-  double Time() { return glfwGetTime(); }
+  // The pacing clock rather than glfwGetTime(), so input timestamps line up with frame
+  // times and work without a window.
+  double Time() { return FramePacer::Now(); }
   int GetKey(GLFWwindow* w, int key) { return glfwGetKey(w, key); }
   void SwapBuffers(GLFWwindow* w) { glfwSwapBuffers(w); }
 } // namespace platform
@@ -23,29 +27,71 @@ namespace platform {
 Engine::Engine() {}
 
 Engine::~Engine() {
+  // The present thread may hold the GL context and still be reading framebuffers.
+  m_presentPipeline.Stop();
+  if (m_backend == Backend::Headless)
+    return;
   if (m_window)
     glfwDestroyWindow(m_window);
   platform::Shutdown();
 }
 
-bool Engine::Initialize(int width, int height, std::string appName) {
+bool Engine::Initialize(int width, int height, std::string appName, Backend backend) {
   m_nScreenWidth = width;
   m_nScreenHeight = height;
   m_sAppName = appName;
+  m_backend = backend;
 
-  if (!platform::Init())
-    return false;
+  if (m_backend == Backend::Window) {
+    if (!platform::Init())
+      return false;
 
-  m_window =
-    glfwCreateWindow(m_nScreenWidth, m_nScreenHeight, m_sAppName.c_str(), nullptr, nullptr);
+    m_window =
+      glfwCreateWindow(m_nScreenWidth, m_nScreenHeight, m_sAppName.c_str(), nullptr, nullptr);
 
-  if (!m_window)
-    return false;
+    if (!m_window)
+      return false;
 
-  glfwMakeContextCurrent(m_window);
-  glfwSwapInterval(1);
-
-  m_vFramebuffer.resize(m_nScreenWidth * m_nScreenHeight);
+    glfwMakeContextCurrent(m_window);
+    glfwSwapInterval(m_bVSync ? 1 : 0);
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetKeyCallback(m_window, KeyCallback);
+  }
+  m_vFrameEvents.reserve(InputQueue::CAPACITY);
+  m_vChangedKeys.reserve(KEY_COUNT);
+
+  m_vFramebuffers.assign(m_nFramebufferCount, std::vector<Color>(m_nScreenWidth * m_nScreenHeight));
+  m_vDepthBuffer.resize(m_nScreenWidth * m_nScreenHeight);
+
+  // With more than one framebuffer, presenting moves to the pipeline thread and the GL
+  // context moves with it.
+  bool bThreaded = m_nFramebufferCount > 1 && m_window;
+  if (bThreaded)
+    glfwMakeContextCurrent(nullptr);
+  m_presentPipeline.Start(
+    m_nFramebufferCount, [this](int slot, int64_t frame) { ConsumeFrame(slot, (int)frame); },
+    [this, bThreaded] {
+      if (bThreaded)
+        glfwMakeContextCurrent(m_window);
+    },
+    [bThreaded] {
+      if (bThreaded)
+        glfwMakeContextCurrent(nullptr);
+    });
+  m_nFrameSlot = m_presentPipeline.Acquire();
+  m_nPresentedSlot = -1;
+  m_pFramebuffer = m_vFramebuffers[m_nFrameSlot].data();
+
+  m_rasterizer.Resize(m_nScreenWidth, m_nScreenHeight);
+  m_clipper.SetViewport(m_nScreenWidth, m_nScreenHeight);
+  m_jobs.Start(m_nWorkerCount);
+  // Every job thread, the main thread and the present thread record zones.
+  profiler::Reserve(m_jobs.GetThreadCount() + 1);
+  m_rasterizer.SetJobSystem(&m_jobs);
+  m_occlusion.SetJobSystem(&m_jobs);
+  m_vFrameArenas.clear();
+  for (int i = 0; i < m_jobs.GetThreadCount(); ++i)
+    m_vFrameArenas.push_back(std::make_unique<FrameArena>());
   Clear();
 
   return true;
@@ -55,58 +101,249 @@ void Engine::Run() {
   if (!OnCreate())
     return;
 
-  double lastTime = platform::Time();
+  const bool bHeadless = m_backend == Backend::Headless;
+  m_pacer.Start(platform::Time());
+
+  profiler::SetThreadName("Main");
+  m_nFrameIndex = 0;
+  m_fFixedAccumulator = 0.0;
+  while (bHeadless ? m_nFrameIndex < m_nHeadlessFrames : !platform::WindowShouldClose(m_window)) {
+    {
+      ENGINE_PROFILE_ZONE("Frame");
+      float deltaT = static_cast<float>(m_pacer.BeginFrame(platform::Time()));
+      if (bHeadless) {
+        deltaT = HEADLESS_DELTA_T;
+      } else {
+        ENGINE_PROFILE_ZONE("PollEvents");
+        platform::PollEvents();
+      }
+
+      for (auto& arena : m_vFrameArenas)
+        arena->Reset();
+      {
+        ENGINE_PROFILE_ZONE("UpdateInputState");
+        UpdateInputState();
+      }
+      m_rasterizer.ResetStats();
+      m_clipper.ResetStats();
+      m_occlusion.ResetStats();
+
+      if (m_fFixedStep > 0.0f) {
+        if (!RunFixedSteps(deltaT))
+          break;
+      } else {
+        ENGINE_PROFILE_ZONE("OnUpdate");
+        if (!OnUpdate(deltaT))
+          break;
+      }
+
+      FlushTriangles();
+      Present();
+    }
+    if (!bHeadless) {
+      ENGINE_PROFILE_ZONE("Pacing");
+      m_pacer.WaitForNextFrame();
+    }
+    profiler::EndFrame();
+    ++m_nFrameIndex;
+  }
+
+  // Leave with every frame displayed, dumped and delivered, and the last one readable
+  // through GetFramebuffer() and SaveFrame().
+  m_presentPipeline.WaitIdle();
+  if (m_nPresentedSlot >= 0 && m_nPresentedSlot != m_nFrameSlot)
+    std::copy(m_vFramebuffers[m_nPresentedSlot].begin(), m_vFramebuffers[m_nPresentedSlot].end(),
+              m_vFramebuffers[m_nFrameSlot].begin());
+}
+
+bool Engine::RunFixedSteps(float deltaT) {
+  m_fFixedAccumulator += deltaT;
+  double maxLag = (double)m_fFixedStep * m_nMaxFixedSteps;
+  if (m_fFixedAccumulator > maxLag) {
+    m_fDroppedTime += m_fFixedAccumulator - maxLag;
+    m_fFixedAccumulator = maxLag;
+  }
+
+  while (m_fFixedAccumulator >= m_fFixedStep) {
+    ENGINE_PROFILE_ZONE("OnFixedUpdate");
+    if (!OnFixedUpdate(m_fFixedStep))
+      return false;
+    m_fFixedAccumulator -= m_fFixedStep;
+    ++m_nFixedTicks;
+  }
+
+  ENGINE_PROFILE_ZONE("OnRender");
+  return OnRender(static_cast<float>(m_fFixedAccumulator / m_fFixedStep));
+}
+
+void Engine::SetFramePacing(bool bVSync, double fTargetFps) {
+  m_bVSync = bVSync;
+  m_pacer.SetTargetFps(bVSync ? 0.0 : fTargetFps);
+}
+
+void Engine::SetFixedTimestep(float fStep, int nMaxSteps) {
+  m_fFixedStep = fStep > 0.0f ? fStep : 0.0f;
+  m_nMaxFixedSteps = nMaxSteps < 1 ? 1 : nMaxSteps;
+}
+
+FrameArena::Stats Engine::GetFrameArenaStats() const {
+  FrameArena::Stats total;
+  for (const auto& arena : m_vFrameArenas) {
+    FrameArena::Stats stats = arena->GetStats();
+    total.nUsed += stats.nUsed;
+    total.nCapacity += stats.nCapacity;
+    total.nHighWater += stats.nHighWater;
+    total.nBlockAllocations += stats.nBlockAllocations;
+  }
+  return total;
+}
+
+void Engine::SetFrameDump(std::string sPrefix, std::string sExtension) {
+  m_sFrameDumpPrefix = sPrefix;
+  m_sFrameDumpExtension = sExtension;
+}
 
-  while (!platform::WindowShouldClose(m_window)) {
-    double now = platform::Time();
-    float deltaT = static_cast<float>(now - lastTime);
-    lastTime = now;
+bool Engine::SaveFrame(const std::string& sFilename) const {
+  return image::Write(sFilename, m_pFramebuffer, m_nScreenWidth, m_nScreenHeight);
+}
 
-    platform::PollEvents();
-    UpdateInputState();
+void Engine::DumpFrame(const Color* pixels, int frame) {
+  if (m_sFrameDumpPrefix.empty())
+    return;
+  ENGINE_PROFILE_ZONE("DumpFrame");
+  char number[16];
+  std::snprintf(number, sizeof(number), "%05d", frame);
+  std::string sFilename = m_sFrameDumpPrefix + number + m_sFrameDumpExtension;
+  if (!image::Write(sFilename, pixels, m_nScreenWidth, m_nScreenHeight))
+    std::fprintf(stderr, "Failed to write frame %s\n", sFilename.c_str());
+}
 
-    if (!OnUpdate(deltaT))
-      break;
+void Engine::ConsumeFrame(int slot, int frame) {
+  const Color* pixels = m_vFramebuffers[slot].data();
+  DumpFrame(pixels, frame);
+  if (m_frameSink)
+    m_frameSink(pixels, m_nScreenWidth, m_nScreenHeight, frame);
+  if (m_window) {
+    ENGINE_PROFILE_ZONE("Display");
+    glDrawPixels(m_nScreenWidth, m_nScreenHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    platform::SwapBuffers(m_window);
+  }
+}
 
-    Present();
+void Engine::Clear(Color color, uint32_t flags) {
+  ENGINE_PROFILE_ZONE("Clear");
+  m_rasterizer.Discard();
+  if (flags & ClearColor)
+    fill::Fill(m_pFramebuffer, (size_t)m_nScreenWidth * m_nScreenHeight, color);
+  if (flags & ClearDepth) {
+    fill::Fill(m_vDepthBuffer.data(), m_vDepthBuffer.size(), Rasterizer::DEPTH_FAR);
+    m_rasterizer.ClearDepth(Rasterizer::DEPTH_FAR);
   }
 }
 
-void Engine::Clear(Color color) {
-  for (auto& p : m_vFramebuffer)
-    p = color;
+void Engine::ClearRect(int x0, int y0, int x1, int y1, Color color) {
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  x1 = std::min(x1, m_nScreenWidth);
+  y1 = std::min(y1, m_nScreenHeight);
+  fill::FillRect(m_pFramebuffer, m_nScreenWidth, x0, y0, x1, y1, color);
+}
+
+void Engine::SetRenderState(const RenderState& state) {
+  m_renderState = state;
+  m_rasterizer.SetRenderState(state);
 }
 
 void Engine::Draw(int x, int y, Color color) {
   if (x < 0 || y < 0 || x >= m_nScreenWidth || y >= m_nScreenHeight)
     return;
-  m_vFramebuffer[y * m_nScreenWidth + x] = color;
+  m_pFramebuffer[y * m_nScreenWidth + x] = color;
+}
+
+void Engine::DrawSpan(int y, int x0, int x1, Color color) {
+  assert(y >= 0 && y < m_nScreenHeight && x0 >= 0 && x0 <= x1 && x1 <= m_nScreenWidth);
+  Color* dst = m_pFramebuffer + (size_t)y * m_nScreenWidth + x0;
+  if (m_renderState.IsReplace())
+    fill::Fill(dst, (size_t)(x1 - x0), color);
+  else
+    blend::Span(dst, (size_t)(x1 - x0), color, m_renderState.blend, m_renderState.colorMask);
 }
 
 void Engine::Present() {
-  glDrawPixels(m_nScreenWidth, m_nScreenHeight, GL_RGBA, GL_UNSIGNED_BYTE, m_vFramebuffer.data());
-  platform::SwapBuffers(m_window);
+  ENGINE_PROFILE_ZONE("Present");
+  m_presentPipeline.Submit(m_nFrameSlot, m_nFrameIndex);
+  m_nPresentedSlot = m_nFrameSlot;
+  m_nFrameSlot = m_presentPipeline.Acquire();
+  m_pFramebuffer = m_vFramebuffers[m_nFrameSlot].data();
 }
 
 void Engine::DrawLine(int x1, int y1, int x2, int y2, Color color) {
-  int dx = std::abs(x2 - x1);
-  int dy = std::abs(y2 - y1);
-  int sx = (x1 < x2) ? 1 : -1;
-  int sy = (y1 < y2) ? 1 : -1;
-  int err = dx - dy;
-
-  while (true) {
-    Draw(x1, y1, color);
-    if (x1 == x2 && y1 == y2)
-      break;
-    int e2 = err << 1;
-    if (e2 > -dy) {
-      err -= dy;
-      x1 += sx;
-    }
-    if (e2 < dx) {
-      err += dx;
-      y1 += sy;
+  int w = m_nScreenWidth, h = m_nScreenHeight;
+  if (std::max(x1, x2) < 0 || std::min(x1, x2) >= w || std::max(y1, y2) < 0 ||
+      std::min(y1, y2) >= h)
+    return;
+
+  // Horizontal and vertical lines are spans and strided columns.
+  if (y1 == y2) {
+    int x0 = std::max(std::min(x1, x2), 0), xEnd = std::min(std::max(x1, x2), w - 1);
+    fill::Fill(m_pFramebuffer + (size_t)y1 * w + x0, (size_t)(xEnd - x0 + 1), color);
+    return;
+  }
+  if (x1 == x2) {
+    int y0 = std::max(std::min(y1, y2), 0), yEnd = std::min(std::max(y1, y2), h - 1);
+    Color* pixel = m_pFramebuffer + (size_t)y0 * w + x1;
+    for (int y = y0; y <= yEnd; ++y, pixel += w)
+      *pixel = color;
+    return;
+  }
+
+  // Pixel j of the line steps j times along its major axis and minor(j) =
+  // floor((2 * j * dMinor + dMajor - 1) / (2 * dMajor)) times along the minor one, the same
+  // pixels as the symmetric Bresenham loop. Inverting that against the viewport (a
+  // Liang-Barsky clip in exact integers) gives the visible run of j, so a long line
+  // crossing the screen costs only its visible pixels and never shifts as it is clipped.
+  bool bXMajor = std::abs((int64_t)x2 - x1) >= std::abs((int64_t)y2 - y1);
+  int64_t major1 = bXMajor ? x1 : y1, major2 = bXMajor ? x2 : y2;
+  int64_t minor1 = bXMajor ? y1 : x1, minor2 = bXMajor ? y2 : x2;
+  int64_t majorSize = bXMajor ? w : h, minorSize = bXMajor ? h : w;
+  int64_t dMajor = std::abs(major2 - major1), dMinor = std::abs(minor2 - minor1);
+  int sMajor = major1 < major2 ? 1 : -1, sMinor = minor1 < minor2 ? 1 : -1;
+
+  // Offsets from the start that stay on screen, counted in the direction of travel
+  auto offsets = [](int64_t start, int sign, int64_t size, int64_t& lo, int64_t& hi) {
+    lo = sign > 0 ? -start : start - (size - 1);
+    hi = sign > 0 ? size - 1 - start : start;
+  };
+  int64_t jLo, jHi, kLo, kHi;
+  offsets(major1, sMajor, majorSize, jLo, jHi);
+  offsets(minor1, sMinor, minorSize, kLo, kHi);
+  jLo = std::max<int64_t>(jLo, 0);
+  jHi = std::min(jHi, dMajor);
+  // minor(j) >= k from j = ceil(((2k - 1) * dMajor + 1) / (2 * dMinor)), and minor(j) <= k
+  // up to one before the first j reaching k + 1.
+  int64_t twoMinor = 2 * dMinor, twoMajor = 2 * dMajor;
+  if (kLo > 0)
+    jLo = std::max(jLo, ((2 * kLo - 1) * dMajor + twoMinor) / twoMinor);
+  if (kHi < dMinor)
+    jHi = std::min(jHi, ((2 * kHi + 1) * dMajor + twoMinor) / twoMinor - 1);
+  if (jLo > jHi)
+    return;
+
+  int64_t numerator = 2 * jLo * dMinor + dMajor - 1;
+  int64_t k = numerator / twoMajor, remainder = numerator % twoMajor;
+  int64_t x = bXMajor ? x1 + sMajor * jLo : x1 + sMinor * k;
+  int64_t y = bXMajor ? y1 + sMinor * k : y1 + sMajor * jLo;
+  ptrdiff_t majorStep = bXMajor ? sMajor : (ptrdiff_t)sMajor * w;
+  ptrdiff_t minorStep = bXMajor ? (ptrdiff_t)sMinor * w : sMinor;
+
+  Color* pixel = m_pFramebuffer + y * w + x;
+  for (int64_t j = jLo; j <= jHi; ++j) {
+    *pixel = color;
+    pixel += majorStep;
+    remainder += twoMinor;
+    if (remainder >= twoMajor) {
+      remainder -= twoMajor;
+      pixel += minorStep;
     }
   }
 }
@@ -122,44 +359,225 @@ void Engine::DrawTriangle(const Triangle& tri, Color color) {
                (int)tri.points[1].y, (int)tri.points[2].x, (int)tri.points[2].y, color);
 }
 
+void Engine::ProjectMesh(const MeshView& mesh, const Mat4& transform) {
+  // One zone for transform, clip and projection: a zone per stage would cost more than
+  // the stages themselves for small meshes.
+  ENGINE_PROFILE_ZONE("Transform");
+
+  // Each unique vertex is transformed once; the clip stage then follows the indices.
+  m_vMeshClip.Resize(mesh.nVertices);
+  mathematics::TransformBatch(mesh.x, mesh.y, mesh.z, m_vMeshClip.x.data(), m_vMeshClip.y.data(),
+                              m_vMeshClip.z.data(), m_vMeshClip.w.data(), mesh.nVertices,
+                              transform);
+  m_clipper.Process(m_vMeshClip, mesh.indices, mesh.nTriangles, m_vMeshProjected);
+}
+
+void Engine::DrawMesh(const Mesh& mesh, const Mat4& transform, Color color) {
+  DrawMesh(mesh.View(), transform, color);
+}
+
+void Engine::ProjectMesh(const MeshletMesh& mesh, const Mat4& transform) {
+  ENGINE_PROFILE_ZONE("Transform");
+
+  m_vVisibleMeshlets.clear();
+  m_clipper.CullMeshlets(mesh, transform, m_vVisibleMeshlets);
+  size_t nVertices = 0, nTriangles = 0;
+  for (uint32_t i : m_vVisibleMeshlets) {
+    nVertices += mesh.meshlets[i].nVertices;
+    nTriangles += mesh.meshlets[i].nTriangles;
+  }
+
+  // Survivors are packed into the clip buffer one after another, their local indices
+  // offset by where each one starts.
+  m_vMeshClip.Resize(nVertices);
+  m_vMeshletIndices.resize(nTriangles * 3);
+  size_t base = 0;
+  uint32_t* indices = m_vMeshletIndices.data();
+  for (uint32_t i : m_vVisibleMeshlets) {
+    const Meshlet& meshlet = mesh.meshlets[i];
+    size_t v = meshlet.vertexOffset;
+    mathematics::TransformBatch(mesh.vertices.x.data() + v, mesh.vertices.y.data() + v,
+                                mesh.vertices.z.data() + v, m_vMeshClip.x.data() + base,
+                                m_vMeshClip.y.data() + base, m_vMeshClip.z.data() + base,
+                                m_vMeshClip.w.data() + base, meshlet.nVertices, transform);
+    const uint8_t* local = mesh.triangles.data() + meshlet.triangleOffset;
+    for (uint32_t k = 0; k < meshlet.nTriangles * 3; ++k)
+      *indices++ = (uint32_t)base + local[k];
+    base += meshlet.nVertices;
+  }
+  m_clipper.Process(m_vMeshClip, m_vMeshletIndices.data(), nTriangles, m_vMeshProjected);
+}
+
+void Engine::DrawMesh(const MeshView& mesh, const Mat4& transform, Color color) {
+  ProjectMesh(mesh, transform);
+  DrawProjected(color);
+}
+
+void Engine::DrawMesh(const MeshletMesh& mesh, const Mat4& transform, Color color) {
+  ProjectMesh(mesh, transform);
+  DrawProjected(color);
+}
+
+void Engine::DrawProjected(Color color) {
+  size_t nVertices = m_vMeshProjected.Size();
+
+  const float* px = m_vMeshProjected.x.data();
+  const float* py = m_vMeshProjected.y.data();
+  for (size_t v = 0; v < nVertices; v += 3) {
+    DrawTriangle((int)px[v], (int)py[v], (int)px[v + 1], (int)py[v + 1], (int)px[v + 2],
+                 (int)py[v + 2], color);
+  }
+}
+
+void Engine::FillTriangle(int x1, int y1, int x2, int y2, int x3, int y3, Color color) {
+  m_rasterizer.Submit((float)x1, (float)y1, 0.0f, (float)x2, (float)y2, 0.0f, (float)x3, (float)y3,
+                      0.0f, color);
+}
+
+void Engine::FillTriangle(const Triangle& tri, Color color) {
+  const VecThree* p = tri.points;
+  m_rasterizer.Submit(p[0].x, p[0].y, p[0].z, p[1].x, p[1].y, p[1].z, p[2].x, p[2].y, p[2].z,
+                      color);
+}
+
+void Engine::FillMesh(const Mesh& mesh, const Mat4& transform, Color color) {
+  FillMesh(mesh.View(), transform, color);
+}
+
+void Engine::FillMesh(const MeshView& mesh, const Mat4& transform, Color color) {
+  ProjectMesh(mesh, transform);
+  FillProjected(color);
+}
+
+void Engine::FillMesh(const MeshletMesh& mesh, const Mat4& transform, Color color) {
+  ProjectMesh(mesh, transform);
+  FillProjected(color);
+}
+
+void Engine::FillProjected(Color color) {
+  size_t nVertices = m_vMeshProjected.Size();
+
+  const float* px = m_vMeshProjected.x.data();
+  const float* py = m_vMeshProjected.y.data();
+  const float* pz = m_vMeshProjected.z.data();
+  for (size_t v = 0; v < nVertices; v += 3) {
+    m_rasterizer.Submit(px[v], py[v], pz[v], px[v + 1], py[v + 1], pz[v + 1], px[v + 2],
+                        py[v + 2], pz[v + 2], color);
+  }
+}
+
+void Engine::FlushTriangles() {
+  ENGINE_PROFILE_ZONE("Raster");
+  m_rasterizer.Flush(m_pFramebuffer, m_vDepthBuffer.data());
+}
+
 void Engine::DrawCircle(int xc, int yc, int radius, Color color) {
-  int x = 0;
-  int y = radius;
-  int p = 3 - 2 * radius;
+  if (radius <= 0 || xc + radius < 0 || xc - radius >= m_nScreenWidth || yc + radius < 0 ||
+      yc - radius >= m_nScreenHeight)
+    return;
+
+  // Midpoint circle, one point per octant per step. Circles wholly on screen skip the
+  // per-pixel bounds checks.
+  auto trace = [&](auto plot) {
+    int x = 0;
+    int y = radius;
+    int p = 3 - 2 * radius;
+    while (y >= x) {
+      plot(xc - x, yc - y);
+      plot(xc - y, yc - x);
+      plot(xc + y, yc - x);
+      plot(xc + x, yc - y);
+      plot(xc - x, yc + y);
+      plot(xc - y, yc + x);
+      plot(xc + y, yc + x);
+      plot(xc + x, yc + y);
+
+      if (p < 0)
+        p += 4 * x++ + 6;
+      else
+        p += 4 * (x++ - y--) + 10;
+    }
+  };
+  if (xc - radius >= 0 && xc + radius < m_nScreenWidth && yc - radius >= 0 &&
+      yc + radius < m_nScreenHeight) {
+    Color* framebuffer = m_pFramebuffer;
+    int w = m_nScreenWidth;
+    trace([=](int x, int y) { framebuffer[y * w + x] = color; });
+  } else {
+    trace([&](int x, int y) { Draw(x, y, color); });
+  }
+}
 
-  if (radius == 0)
+void Engine::FillCircle(int xc, int yc, int radius, Color color) {
+  if (radius < 0 || xc + radius < 0 || xc - radius >= m_nScreenWidth || yc + radius < 0 ||
+      yc - radius >= m_nScreenHeight)
     return;
 
+  // Row y of the disc spans [xl, xr], clipped to the screen.
+  auto span = [&](int y, int xl, int xr) {
+    if (y < 0 || y >= m_nScreenHeight)
+      return;
+    xl = std::max(xl, 0);
+    xr = std::min(xr, m_nScreenWidth - 1);
+    if (xl <= xr)
+      DrawSpan(y, xl, xr + 1, color);
+  };
+
+  // The same midpoint steps as DrawCircle, so the disc fills its outline exactly. Rows
+  // yc +- x come once per step; rows yc +- y only when y is about to shrink, at their
+  // widest x.
+  int x = 0;
+  int y = radius;
+  int p = 3 - 2 * radius;
   while (y >= x) {
-    Draw(xc - x, yc - y, color);
-    Draw(xc - y, yc - x, color);
-    Draw(xc + y, yc - x, color);
-    Draw(xc + x, yc - y, color);
-    Draw(xc - x, yc + y, color);
-    Draw(xc - y, yc + x, color);
-    Draw(xc + y, yc + x, color);
-    Draw(xc + x, yc + y, color);
-
-    if (p < 0)
+    span(yc - x, xc - y, xc + y);
+    if (x != 0)
+      span(yc + x, xc - y, xc + y);
+
+    if (p < 0) {
       p += 4 * x++ + 6;
-    else
+    } else {
+      if (y != x) {
+        span(yc - y, xc - x, xc + x);
+        span(yc + y, xc - x, xc + x);
+      }
       p += 4 * (x++ - y--) + 10;
+    }
   }
 }
 
+void Engine::KeyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/) {
+  // Repeats carry no state change.
+  if (action == GLFW_REPEAT)
+    return;
+  Engine* engine = static_cast<Engine*>(glfwGetWindowUserPointer(window));
+  InputEvent::Type type =
+    action == GLFW_PRESS ? InputEvent::Type::KeyDown : InputEvent::Type::KeyUp;
+  engine->QueueInputEvent({type, key, platform::Time()});
+}
+
 void Engine::UpdateInputState() {
-  for (int k = 0; k < 512; ++k) {
-    bool isDown = platform::GetKey(m_window, k) == GLFW_PRESS;
-    m_keyStates[k].bPressed = false;
-    m_keyStates[k].bReleased = false;
-
-    if (isDown && !m_keyStates[k].bHeld) {
-      m_keyStates[k].bPressed = true;
-      m_keyStates[k].bHeld = true;
-    } else if (!isDown && m_keyStates[k].bHeld) {
-      m_keyStates[k].bReleased = true;
-      m_keyStates[k].bHeld = false;
-    }
+  for (int key : m_vChangedKeys) {
+    m_keyStates[key].bPressed = false;
+    m_keyStates[key].bReleased = false;
+  }
+  m_vChangedKeys.clear();
+  m_vFrameEvents.clear();
+
+  InputEvent event;
+  while (m_inputQueue.Pop(event)) {
+    m_vFrameEvents.push_back(event);
+    if (event.key < 0 || event.key >= KEY_COUNT)
+      continue;
+    sKeyState& state = m_keyStates[event.key];
+    bool bDown = event.type == InputEvent::Type::KeyDown;
+    if (bDown == state.bHeld)
+      continue;
+    // Both flags may end up set when a key goes down and up within the frame.
+    if (!state.bPressed && !state.bReleased)
+      m_vChangedKeys.push_back(event.key);
+    state.bHeld = bDown;
+    (bDown ? state.bPressed : state.bReleased) = true;
   }
 }
 
@@ -0,0 +1,83 @@
+#include "fill.h"
+
+#include "simd.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace fill {
+  namespace {
+    // Fills count 32-bit elements of type T, with streaming stores if bStream. The vector
+    // stores go through __m128i/__m256i, which may alias anything; the ragged ends use T.
+    template <typename T>
+    void Fill32(T* dst, size_t count, T value, bool bStream) {
+      static_assert(sizeof(T) == 4, "32-bit elements only");
+      size_t i = 0;
+#if defined(ENGINE_SIMD_SSE)
+      uint32_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+#if defined(ENGINE_SIMD_AVX)
+      const size_t ALIGN = 32;
+#else
+      const size_t ALIGN = 16;
+#endif
+      while (i < count && ((uintptr_t)(dst + i) & (ALIGN - 1)) != 0)
+        dst[i++] = value;
+#if defined(ENGINE_SIMD_AVX)
+      const __m256i v = _mm256_set1_epi32((int)bits);
+      if (bStream) {
+        for (; i + 8 <= count; i += 8)
+          _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), v);
+      } else {
+        for (; i + 16 <= count; i += 16) {
+          _mm256_store_si256(reinterpret_cast<__m256i*>(dst + i), v);
+          _mm256_store_si256(reinterpret_cast<__m256i*>(dst + i + 8), v);
+        }
+        for (; i + 8 <= count; i += 8)
+          _mm256_store_si256(reinterpret_cast<__m256i*>(dst + i), v);
+      }
+#else
+      const __m128i v = _mm_set1_epi32((int)bits);
+      if (bStream) {
+        for (; i + 4 <= count; i += 4)
+          _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), v);
+      } else {
+        for (; i + 4 <= count; i += 4)
+          _mm_store_si128(reinterpret_cast<__m128i*>(dst + i), v);
+      }
+#endif
+      // Streaming stores are weakly ordered; publish them before anyone reads the buffer.
+      if (bStream)
+        _mm_sfence();
+#else
+      (void)bStream;
+#endif
+      for (; i < count; ++i)
+        dst[i] = value;
+    }
+
+    bool UseStreaming(size_t count) { return count * 4 >= NON_TEMPORAL_BYTES; }
+  } // namespace
+
+  void Fill(Color* dst, size_t count, Color color) {
+    Fill32(dst, count, color, UseStreaming(count));
+  }
+
+  void Fill(float* dst, size_t count, float value) {
+    Fill32(dst, count, value, UseStreaming(count));
+  }
+
+  void FillRect(Color* dst, int stride, int x0, int y0, int x1, int y1, Color color) {
+    if (x1 <= x0 || y1 <= y0)
+      return;
+    size_t width = (size_t)(x1 - x0);
+    bool bStream = UseStreaming(width * (size_t)(y1 - y0));
+    // Full-width rows are contiguous.
+    if (width == (size_t)stride) {
+      Fill32(dst + (size_t)y0 * stride, width * (size_t)(y1 - y0), color, bStream);
+      return;
+    }
+    for (int y = y0; y < y1; ++y)
+      Fill32(dst + (size_t)y * stride + x0, width, color, bStream);
+  }
+} // namespace fill
@@ -0,0 +1,85 @@
+#include "framepacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+double FramePacer::Now() {
+  using Clock = std::chrono::steady_clock;
+  static const Clock::time_point epoch = Clock::now();
+  return std::chrono::duration<double>(Clock::now() - epoch).count();
+}
+
+void FramePacer::SleepUntil(double deadline) {
+  double remaining = deadline - Now();
+  if (remaining > SPIN_MARGIN)
+    std::this_thread::sleep_for(std::chrono::duration<double>(remaining - SPIN_MARGIN));
+  while (Now() < deadline)
+    std::this_thread::yield();
+}
+
+void FramePacer::SetTargetFps(double fps) {
+  m_fPeriod = fps > 0.0 ? 1.0 / fps : 0.0;
+  m_fNextDeadline = m_fLastFrame + m_fPeriod;
+}
+
+void FramePacer::Start(double now) {
+  m_fLastFrame = now;
+  m_fNextDeadline = now + m_fPeriod;
+  m_nIntervals = 0;
+  m_nNextInterval = 0;
+  m_bFirstFrame = true;
+}
+
+double FramePacer::BeginFrame(double now) {
+  double interval = now - m_fLastFrame;
+  m_fLastFrame = now;
+  // The first frame measures from Start(), not from another frame.
+  if (m_bFirstFrame) {
+    m_bFirstFrame = false;
+    return interval;
+  }
+  m_intervals[m_nNextInterval] = interval;
+  m_nNextInterval = (m_nNextInterval + 1) % HISTORY;
+  m_nIntervals = std::min(m_nIntervals + 1, HISTORY);
+  return interval;
+}
+
+void FramePacer::WaitForNextFrame() {
+  if (m_fPeriod <= 0.0)
+    return;
+  double now = Now();
+  if (now > m_fNextDeadline + m_fPeriod) {
+    // Too far behind to catch up: start a new grid from here.
+    m_fNextDeadline = now + m_fPeriod;
+    return;
+  }
+  SleepUntil(m_fNextDeadline);
+  m_fNextDeadline += m_fPeriod;
+}
+
+FramePacer::Stats FramePacer::GetStats() const {
+  Stats stats;
+  stats.nFrames = m_nIntervals;
+  if (m_nIntervals == 0)
+    return stats;
+
+  double sorted[HISTORY];
+  std::copy(m_intervals, m_intervals + m_nIntervals, sorted);
+  std::sort(sorted, sorted + m_nIntervals);
+  double sum = 0.0;
+  for (int i = 0; i < m_nIntervals; ++i)
+    sum += sorted[i];
+  double mean = sum / m_nIntervals;
+  double variance = 0.0;
+  for (int i = 0; i < m_nIntervals; ++i)
+    variance += (sorted[i] - mean) * (sorted[i] - mean);
+
+  stats.meanMs = mean * 1000.0;
+  stats.minMs = sorted[0] * 1000.0;
+  stats.maxMs = sorted[m_nIntervals - 1] * 1000.0;
+  stats.p99Ms = sorted[(m_nIntervals - 1) * 99 / 100] * 1000.0;
+  stats.jitterMs = std::sqrt(variance / m_nIntervals) * 1000.0;
+  return stats;
+}
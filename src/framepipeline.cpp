@@ -0,0 +1,105 @@
+#include "framepipeline.h"
+
+#include "profiler.h"
+
+FramePipeline::~FramePipeline() { Stop(); }
+
+void FramePipeline::Start(int nSlots, Consumer consumer, ThreadHook onThreadStart,
+                          ThreadHook onThreadStop) {
+  Stop();
+
+  m_nSlots = nSlots < 1 ? 1 : nSlots;
+  m_consumer = std::move(consumer);
+  m_vFreeSlots.clear();
+  m_vFreeSlots.reserve(m_nSlots);
+  for (int slot = m_nSlots - 1; slot >= 0; --slot)
+    m_vFreeSlots.push_back(slot);
+  m_vQueue.assign(m_nSlots, {});
+  m_nQueueHead = 0;
+  m_nQueued = 0;
+  m_nInFlight = 0;
+  m_bStop = false;
+
+  if (m_nSlots > 1)
+    m_thread = std::thread(&FramePipeline::ThreadLoop, this, onThreadStart, onThreadStop);
+}
+
+void FramePipeline::Stop() {
+  if (!m_thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bStop = true;
+  }
+  m_cvSubmitted.notify_one();
+  m_thread.join();
+}
+
+int FramePipeline::Acquire() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_vFreeSlots.empty()) {
+    ENGINE_PROFILE_ZONE("WaitForFreeFrame");
+    m_cvFreed.wait(lock, [this] { return !m_vFreeSlots.empty(); });
+  }
+  int slot = m_vFreeSlots.back();
+  m_vFreeSlots.pop_back();
+  return slot;
+}
+
+void FramePipeline::Submit(int slot, int64_t frame) {
+  if (!m_thread.joinable()) {
+    // Serial mode: consume now and recycle the slot straight away.
+    if (m_consumer)
+      m_consumer(slot, frame);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_vFreeSlots.push_back(slot);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_vQueue[(m_nQueueHead + m_nQueued) % m_vQueue.size()] = {slot, frame};
+    ++m_nQueued;
+    ++m_nInFlight;
+  }
+  m_cvSubmitted.notify_one();
+}
+
+void FramePipeline::WaitIdle() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cvFreed.wait(lock, [this] { return m_nInFlight == 0; });
+}
+
+void FramePipeline::ThreadLoop(ThreadHook onThreadStart, ThreadHook onThreadStop) {
+  profiler::SetThreadName("Present");
+  if (onThreadStart)
+    onThreadStart();
+
+  while (true) {
+    Pending next;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cvSubmitted.wait(lock, [this] { return m_bStop || m_nQueued > 0; });
+      // Stop only once everything submitted has been consumed.
+      if (m_nQueued == 0)
+        break;
+      next = m_vQueue[m_nQueueHead];
+      m_nQueueHead = (m_nQueueHead + 1) % m_vQueue.size();
+      --m_nQueued;
+    }
+
+    if (m_consumer)
+      m_consumer(next.slot, next.frame);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_vFreeSlots.push_back(next.slot);
+      --m_nInFlight;
+    }
+    // Wakes both Acquire() and WaitIdle().
+    m_cvFreed.notify_all();
+  }
+
+  if (onThreadStop)
+    onThreadStop();
+}
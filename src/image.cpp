@@ -0,0 +1,142 @@
+#include "image.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace image {
+  namespace {
+    // Rows top first, 3 bytes per pixel, each row preceded by filterBytes zero bytes.
+    std::vector<uint8_t> PackRGB(const Color* pixels, int width, int height, int filterBytes) {
+      const size_t rowSize = (size_t)filterBytes + (size_t)width * 3;
+      std::vector<uint8_t> rgb(rowSize * (size_t)height);
+      for (int y = 0; y < height; ++y) {
+        const Color* src = pixels + (size_t)(height - 1 - y) * width;
+        uint8_t* dst = rgb.data() + (size_t)y * rowSize;
+        for (int i = 0; i < filterBytes; ++i)
+          *dst++ = 0;
+        for (int x = 0; x < width; ++x) {
+          *dst++ = src[x].r;
+          *dst++ = src[x].g;
+          *dst++ = src[x].b;
+        }
+      }
+      return rgb;
+    }
+
+    struct CrcTable {
+      uint32_t entries[256];
+      CrcTable() {
+        for (uint32_t n = 0; n < 256; ++n) {
+          uint32_t c = n;
+          for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+          entries[n] = c;
+        }
+      }
+    };
+
+    uint32_t Crc32(const uint8_t* data, size_t size) {
+      static const CrcTable table;
+      uint32_t crc = 0xFFFFFFFFu;
+      for (size_t i = 0; i < size; ++i)
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+      return ~crc;
+    }
+
+    uint32_t Adler32(const uint8_t* data, size_t size) {
+      const uint32_t MOD = 65521;
+      uint32_t a = 1, b = 0;
+      while (size > 0) {
+        // 5552 bytes is the longest run that cannot overflow b before the modulo.
+        size_t n = size < 5552 ? size : 5552;
+        size -= n;
+        for (size_t i = 0; i < n; ++i) {
+          a += data[i];
+          b += a;
+        }
+        data += n;
+        a %= MOD;
+        b %= MOD;
+      }
+      return (b << 16) | a;
+    }
+
+    void PutBE32(std::vector<uint8_t>& out, uint32_t v) {
+      out.push_back((uint8_t)(v >> 24));
+      out.push_back((uint8_t)(v >> 16));
+      out.push_back((uint8_t)(v >> 8));
+      out.push_back((uint8_t)v);
+    }
+
+    void PutChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+      PutBE32(out, (uint32_t)data.size());
+      size_t start = out.size();
+      out.insert(out.end(), type, type + 4);
+      out.insert(out.end(), data.begin(), data.end());
+      PutBE32(out, Crc32(out.data() + start, out.size() - start));
+    }
+
+    bool WriteFile(const std::string& sFilename, const uint8_t* data, size_t size) {
+      FILE* file = std::fopen(sFilename.c_str(), "wb");
+      if (!file)
+        return false;
+      bool bOk = std::fwrite(data, 1, size, file) == size;
+      return std::fclose(file) == 0 && bOk;
+    }
+  } // namespace
+
+  bool WritePPM(const std::string& sFilename, const Color* pixels, int width, int height) {
+    char header[64];
+    int nHeader = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    std::vector<uint8_t> file(header, header + nHeader);
+    std::vector<uint8_t> rgb = PackRGB(pixels, width, height, 0);
+    file.insert(file.end(), rgb.begin(), rgb.end());
+    return WriteFile(sFilename, file.data(), file.size());
+  }
+
+  bool WritePNG(const std::string& sFilename, const Color* pixels, int width, int height) {
+    // Every scanline starts with filter type 0 (none).
+    std::vector<uint8_t> raw = PackRGB(pixels, width, height, 1);
+
+    // zlib stream made of stored deflate blocks.
+    const size_t MAX_BLOCK = 65535;
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    zlib.reserve(raw.size() + raw.size() / MAX_BLOCK * 5 + 16);
+    size_t offset = 0;
+    do {
+      size_t n = raw.size() - offset < MAX_BLOCK ? raw.size() - offset : MAX_BLOCK;
+      bool bFinal = offset + n == raw.size();
+      zlib.push_back(bFinal ? 1 : 0);
+      zlib.push_back((uint8_t)n);
+      zlib.push_back((uint8_t)(n >> 8));
+      zlib.push_back((uint8_t)~n);
+      zlib.push_back((uint8_t)(~n >> 8));
+      zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + n);
+      offset += n;
+    } while (offset < raw.size());
+    PutBE32(zlib, Adler32(raw.data(), raw.size()));
+
+    std::vector<uint8_t> ihdr;
+    PutBE32(ihdr, (uint32_t)width);
+    PutBE32(ihdr, (uint32_t)height);
+    const uint8_t format[5] = {8, 2, 0, 0, 0}; // 8-bit RGB, deflate, no interlace
+    ihdr.insert(ihdr.end(), format, format + 5);
+
+    std::vector<uint8_t> file = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.reserve(zlib.size() + 64);
+    PutChunk(file, "IHDR", ihdr);
+    PutChunk(file, "IDAT", zlib);
+    PutChunk(file, "IEND", {});
+    return WriteFile(sFilename, file.data(), file.size());
+  }
+
+  bool Write(const std::string& sFilename, const Color* pixels, int width, int height) {
+    size_t n = sFilename.size();
+    bool bPng = n >= 4 && (sFilename.compare(n - 4, 4, ".png") == 0 ||
+                           sFilename.compare(n - 4, 4, ".PNG") == 0);
+    if (bPng)
+      return WritePNG(sFilename, pixels, width, height);
+    return WritePPM(sFilename, pixels, width, height);
+  }
+} // namespace image
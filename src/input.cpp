@@ -0,0 +1,45 @@
+#include "input.h"
+
+static_assert((InputQueue::CAPACITY & (InputQueue::CAPACITY - 1)) == 0,
+              "InputQueue::CAPACITY must be a power of two");
+
+InputQueue::InputQueue() {
+  for (size_t i = 0; i < CAPACITY; ++i)
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool InputQueue::Push(const InputEvent& event) {
+  size_t position = m_nEnqueue.load(std::memory_order_relaxed);
+  while (true) {
+    Cell& cell = m_cells[position & (CAPACITY - 1)];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+    if (diff == 0) {
+      // Free cell: claim the position, or retry from wherever another producer left it.
+      if (m_nEnqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        cell.event = event;
+        cell.sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      // The cell still holds an event from one lap ago: full.
+      m_nDropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = m_nEnqueue.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool InputQueue::Pop(InputEvent& event) {
+  size_t position = m_nDequeue.load(std::memory_order_relaxed);
+  Cell& cell = m_cells[position & (CAPACITY - 1)];
+  size_t sequence = cell.sequence.load(std::memory_order_acquire);
+  if ((intptr_t)sequence - (intptr_t)(position + 1) < 0)
+    return false;
+  // Single consumer: the position is ours without a compare-exchange.
+  event = cell.event;
+  m_nDequeue.store(position + 1, std::memory_order_relaxed);
+  cell.sequence.store(position + CAPACITY, std::memory_order_release);
+  return true;
+}
@@ -0,0 +1,189 @@
+#include "jobs.h"
+
+#include "profiler.h"
+
+#include <cassert>
+
+namespace {
+  // Which pool, if any, owns the current thread, and its worker index there
+  thread_local const JobSystem* t_pPool = nullptr;
+  thread_local int t_nWorker = 0;
+} // namespace
+
+static_assert((JobSystem::MAX_JOBS & (JobSystem::MAX_JOBS - 1)) == 0,
+              "JobSystem::MAX_JOBS must be a power of two");
+
+JobSystem::~JobSystem() { Stop(); }
+
+void JobSystem::Start(int nThreads) {
+  Stop();
+  if (nThreads <= 0)
+    nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+  m_nThreads = nThreads;
+  m_pWorkers.reset(new Worker[m_nThreads]);
+  for (int i = 0; i < m_nThreads; ++i)
+    m_pWorkers[i].jobs.reset(new Job[MAX_JOBS]);
+  m_nQueued.store(0);
+  m_bStop.store(false);
+
+  t_pPool = this;
+  t_nWorker = 0;
+  for (int i = 1; i < m_nThreads; ++i)
+    m_pWorkers[i].thread = std::thread(&JobSystem::WorkerLoop, this, i);
+}
+
+void JobSystem::Stop() {
+  if (!m_pWorkers)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bStop.store(true);
+  }
+  m_cvWork.notify_all();
+  for (int i = 1; i < m_nThreads; ++i)
+    m_pWorkers[i].thread.join();
+  m_pWorkers.reset();
+  m_nThreads = 0;
+}
+
+void JobSystem::AddDependency(Job* job, Job* dependency) {
+  int slot = dependency->nContinuations.fetch_add(1, std::memory_order_relaxed);
+  assert(slot < MAX_CONTINUATIONS && "too many jobs depend on one job");
+  dependency->continuations[slot] = job;
+  job->nBlockers.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::Run(Job* job) {
+  if (job->nBlockers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    Push(job);
+}
+
+void JobSystem::Wait(const Job* job) {
+  int worker = CurrentWorker();
+  while (!IsFinished(job)) {
+    if (Job* next = Take(worker))
+      Execute(next);
+    else
+      std::this_thread::yield();
+  }
+}
+
+JobSystem::Job* JobSystem::Allocate() {
+  Worker& worker = m_pWorkers[CurrentWorker()];
+  Job* job = &worker.jobs[worker.nNextJob++ & (MAX_JOBS - 1)];
+  assert(IsFinished(job) && "more than MAX_JOBS jobs in flight on one thread");
+  return job;
+}
+
+int JobSystem::CurrentWorker() const { return t_pPool == this ? t_nWorker : 0; }
+
+void JobSystem::Push(Job* job) {
+  // A full deque runs the job here instead.
+  if (!m_pWorkers[CurrentWorker()].deque.Push(job)) {
+    Execute(job);
+    return;
+  }
+  // Counting the job before checking for sleepers, while a worker registers as sleeping
+  // before checking the count, means at least one side sees the other. The lock then
+  // orders this notify after the worker has started waiting.
+  m_nQueued.fetch_add(1);
+  if (m_nSleeping.load() > 0) {
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_cvWork.notify_one();
+  }
+}
+
+JobSystem::Job* JobSystem::Take(int worker) {
+  Job* job = m_pWorkers[worker].deque.Pop();
+  // Steal round-robin from the next thread on, oldest work first.
+  for (int i = 1; !job && i < m_nThreads; ++i)
+    job = m_pWorkers[(worker + i) % m_nThreads].deque.Steal();
+  if (job)
+    m_nQueued.fetch_sub(1, std::memory_order_relaxed);
+  return job;
+}
+
+void JobSystem::Execute(Job* job) {
+  job->function(*job);
+  Finish(job);
+}
+
+void JobSystem::Finish(Job* job) {
+  // Read before the job can be seen as finished, after which its slot may be reused.
+  Job* parent = job->parent;
+  int nContinuations = job->nContinuations.load(std::memory_order_relaxed);
+  Job* continuations[MAX_CONTINUATIONS];
+  for (int i = 0; i < nContinuations; ++i)
+    continuations[i] = job->continuations[i];
+
+  if (job->nUnfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    return;
+  for (int i = 0; i < nContinuations; ++i)
+    Run(continuations[i]);
+  if (parent)
+    Finish(parent);
+}
+
+void JobSystem::WorkerLoop(int worker) {
+  t_pPool = this;
+  t_nWorker = worker;
+  profiler::SetThreadName("Job worker");
+
+  while (true) {
+    if (Job* job = Take(worker)) {
+      Execute(job);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_nSleeping.fetch_add(1);
+    m_cvWork.wait(lock, [this] { return m_bStop.load() || m_nQueued.load() > 0; });
+    m_nSleeping.fetch_sub(1);
+    if (m_bStop.load())
+      return;
+  }
+}
+
+bool JobSystem::Deque::Push(Job* job) {
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+  if (b - t >= (int64_t)MAX_JOBS)
+    return false;
+  items[b & (MAX_JOBS - 1)].store(job, std::memory_order_relaxed);
+  bottom.store(b + 1, std::memory_order_release);
+  return true;
+}
+
+JobSystem::Job* JobSystem::Deque::Pop() {
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+  if (t > b) {
+    // Empty
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  Job* job = items[b & (MAX_JOBS - 1)].load(std::memory_order_relaxed);
+  if (t == b) {
+    // Last item: race any thief for it.
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      job = nullptr;
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+JobSystem::Job* JobSystem::Deque::Steal() {
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b)
+    return nullptr;
+  Job* job = items[t & (MAX_JOBS - 1)].load(std::memory_order_relaxed);
+  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                   std::memory_order_relaxed))
+    return nullptr;
+  return job;
+}
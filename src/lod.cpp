@@ -0,0 +1,41 @@
+#include "lod.h"
+
+#include "meshopt.h"
+
+#include <algorithm>
+#include <cmath>
+
+LodChain LodChain::Build(const Mesh& mesh, const std::vector<float>& vRatios) {
+  LodChain chain;
+  chain.levels.push_back({mesh, 0.0f});
+  const size_t nFull = mesh.TriangleCount();
+  for (float fRatio : vRatios) {
+    const LodLevel& previous = chain.levels.back();
+    LodLevel level;
+    float fError = meshopt::Simplify(mesh, (size_t)(fRatio * (float)nFull), level.mesh);
+    if (level.mesh.TriangleCount() == 0 ||
+        level.mesh.TriangleCount() * 10 > previous.mesh.TriangleCount() * 9)
+      break;
+    level.fError = std::max(fError, previous.fError);
+    chain.levels.push_back(std::move(level));
+  }
+  return chain;
+}
+
+size_t LodChain::Select(size_t current, float fPixelsPerUnit, float fMaxPixelError) const {
+  if (levels.empty())
+    return 0;
+  size_t level = std::min(current, levels.size() - 1);
+  auto pixels = [&](size_t i) { return levels[i].fError * fPixelsPerUnit; };
+  while (level > 0 && pixels(level) > fMaxPixelError * (1.0f + HYSTERESIS))
+    --level;
+  while (level + 1 < levels.size() && pixels(level + 1) <= fMaxPixelError * (1.0f - HYSTERESIS))
+    ++level;
+  return level;
+}
+
+float LodChain::PixelsPerUnit(float fDistance, float fFovDegrees, int nScreenHeight) {
+  // MakeProjection maps y to y / (z tan(fov / 2)) in [-1, 1] over the screen height.
+  float fTanHalfFov = std::tan(fFovDegrees * (3.14159265f / 180.0f) * 0.5f);
+  return 0.5f * (float)nScreenHeight / (fTanHalfFov * std::max(fDistance, 1e-6f));
+}
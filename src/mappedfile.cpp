@@ -0,0 +1,74 @@
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+#include <cstdio>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::Open(const std::string& sFilename) {
+  Close();
+
+#if defined(_WIN32)
+  FILE* file = std::fopen(sFilename.c_str(), "rb");
+  if (!file)
+    return false;
+  std::fseek(file, 0, SEEK_END);
+  long size = std::ftell(file);
+  std::fseek(file, 0, SEEK_SET);
+  m_vFallback.resize(size > 0 ? (size_t)size : 0);
+  size_t nRead = m_vFallback.empty() ? 0 : std::fread(m_vFallback.data(), 1, size, file);
+  std::fclose(file);
+  if (nRead != m_vFallback.size())
+    return false;
+  m_pData = m_vFallback.data();
+  m_nSize = m_vFallback.size();
+  m_bOpenEmpty = m_nSize == 0;
+  return true;
+#else
+  int fd = open(sFilename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  if (st.st_size == 0) {
+    close(fd);
+    m_bOpenEmpty = true;
+    return true;
+  }
+
+  void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+  m_pData = static_cast<const char*>(data);
+  m_nSize = (size_t)st.st_size;
+  m_bMapped = true;
+  return true;
+#endif
+}
+
+void MappedFile::Close() {
+#if !defined(_WIN32)
+  if (m_bMapped)
+    munmap(const_cast<char*>(m_pData), m_nSize);
+#endif
+  m_pData = nullptr;
+  m_nSize = 0;
+  m_bMapped = false;
+  m_bOpenEmpty = false;
+  m_vFallback.clear();
+}
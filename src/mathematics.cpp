@@ -2,6 +2,7 @@
 
 #include "matrix.h"
 #include "mesh.h"
+#include "simd.h"
 
 #include <cassert>
 #include <cmath>
@@ -27,6 +28,29 @@ namespace mathematics {
         matrix.Get(3, 3);
   }
 
+  void MultiplyMatrixVector(const VecThree& inVec, VecThree& outVec, float& w,
+                            const Mat4& matrix) {
+#if defined(ENGINE_SIMD_SSE)
+    // Row vector times matrix: a weighted sum of the matrix rows.
+    __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(inVec.x), _mm_load_ps(matrix.m[0])),
+                          _mm_mul_ps(_mm_set1_ps(inVec.y), _mm_load_ps(matrix.m[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(inVec.z), _mm_load_ps(matrix.m[2])));
+    r = _mm_add_ps(r, _mm_load_ps(matrix.m[3]));
+    alignas(16) float out[4];
+    _mm_store_ps(out, r);
+    outVec.x = out[0];
+    outVec.y = out[1];
+    outVec.z = out[2];
+    w = out[3];
+#else
+    const float(*m)[4] = matrix.m;
+    outVec.x = inVec.x * m[0][0] + inVec.y * m[1][0] + inVec.z * m[2][0] + m[3][0];
+    outVec.y = inVec.x * m[0][1] + inVec.y * m[1][1] + inVec.z * m[2][1] + m[3][1];
+    outVec.z = inVec.x * m[0][2] + inVec.y * m[1][2] + inVec.z * m[2][2] + m[3][2];
+    w = inVec.x * m[0][3] + inVec.y * m[1][3] + inVec.z * m[2][3] + m[3][3];
+#endif
+  }
+
   void PerspectiveDivide(VecThree& vec, float w) {
     if (w != 0.0f) {
       vec.x /= w;
@@ -46,10 +70,209 @@ namespace mathematics {
     PerspectiveDivide(outVec, w);
   }
 
+  void ProjectToScreen(const VecThree& inVec, VecThree& outVec, const Mat4& matrix) {
+    float w = 1.0f;
+    MultiplyMatrixVector(inVec, outVec, w, matrix);
+    PerspectiveDivide(outVec, w);
+  }
+
   void ProjectToScreen(const VecThree& inVec, VecThree& outVec, const Matrix& matrix, int width,
                        int height) {
     ProjectToScreen(inVec, outVec, matrix);
     NDCToScreen(outVec, width, height);
   }
 
+  void ProjectToScreen(const VecThree& inVec, VecThree& outVec, const Mat4& matrix, int width,
+                       int height) {
+    ProjectToScreen(inVec, outVec, matrix);
+    NDCToScreen(outVec, width, height);
+  }
+
+  void TransformPoints(VecThree* points, size_t count, const Mat4& matrix) {
+#if defined(ENGINE_SIMD_SSE)
+    __m128 r0 = _mm_load_ps(matrix.m[0]);
+    __m128 r1 = _mm_load_ps(matrix.m[1]);
+    __m128 r2 = _mm_load_ps(matrix.m[2]);
+    __m128 r3 = _mm_load_ps(matrix.m[3]);
+    for (size_t i = 0; i < count; ++i) {
+      VecThree& p = points[i];
+      __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), r0), _mm_mul_ps(_mm_set1_ps(p.y), r1));
+      r = _mm_add_ps(r, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), r2), r3));
+      _mm_storel_pi(reinterpret_cast<__m64*>(&p.x), r);
+      _mm_store_ss(&p.z, _mm_movehl_ps(r, r));
+    }
+#else
+    for (size_t i = 0; i < count; ++i) {
+      float w = 1.0f;
+      VecThree in = points[i];
+      MultiplyMatrixVector(in, points[i], w, matrix);
+    }
+#endif
+  }
+
+  namespace {
+    // Shared body of the TransformBatch overloads; bWriteW selects the clip-space variant.
+    template <bool bWriteW>
+    void TransformBatchImpl(const float* inX, const float* inY, const float* inZ, float* outX,
+                            float* outY, float* outZ, float* outW, size_t count,
+                            const Mat4& matrix) {
+      const float(*m)[4] = matrix.m;
+      size_t i = 0;
+#if defined(ENGINE_SIMD_AVX)
+      __m256 c[4][4];
+      for (int row = 0; row < 4; ++row)
+        for (int col = 0; col < 4; ++col)
+          c[row][col] = _mm256_set1_ps(m[row][col]);
+      for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(inX + i);
+        __m256 y = _mm256_loadu_ps(inY + i);
+        __m256 z = _mm256_loadu_ps(inZ + i);
+        __m256 o[4];
+        for (int col = 0; col < (bWriteW ? 4 : 3); ++col) {
+          o[col] =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, c[0][col]), _mm256_mul_ps(y, c[1][col])),
+                          _mm256_add_ps(_mm256_mul_ps(z, c[2][col]), c[3][col]));
+        }
+        _mm256_storeu_ps(outX + i, o[0]);
+        _mm256_storeu_ps(outY + i, o[1]);
+        _mm256_storeu_ps(outZ + i, o[2]);
+        if (bWriteW)
+          _mm256_storeu_ps(outW + i, o[3]);
+      }
+#elif defined(ENGINE_SIMD_SSE)
+      __m128 c[4][4];
+      for (int row = 0; row < 4; ++row)
+        for (int col = 0; col < 4; ++col)
+          c[row][col] = _mm_set1_ps(m[row][col]);
+      for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(inX + i);
+        __m128 y = _mm_loadu_ps(inY + i);
+        __m128 z = _mm_loadu_ps(inZ + i);
+        __m128 o[4];
+        for (int col = 0; col < (bWriteW ? 4 : 3); ++col) {
+          o[col] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, c[0][col]), _mm_mul_ps(y, c[1][col])),
+                              _mm_add_ps(_mm_mul_ps(z, c[2][col]), c[3][col]));
+        }
+        _mm_storeu_ps(outX + i, o[0]);
+        _mm_storeu_ps(outY + i, o[1]);
+        _mm_storeu_ps(outZ + i, o[2]);
+        if (bWriteW)
+          _mm_storeu_ps(outW + i, o[3]);
+      }
+#endif
+      for (; i < count; ++i) {
+        float x = inX[i], y = inY[i], z = inZ[i];
+        outX[i] = x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0];
+        outY[i] = x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1];
+        outZ[i] = x * m[0][2] + y * m[1][2] + z * m[2][2] + m[3][2];
+        if (bWriteW)
+          outW[i] = x * m[0][3] + y * m[1][3] + z * m[2][3] + m[3][3];
+      }
+    }
+  } // namespace
+
+  void TransformBatch(const float* inX, const float* inY, const float* inZ, float* outX,
+                      float* outY, float* outZ, size_t count, const Mat4& matrix) {
+    TransformBatchImpl<false>(inX, inY, inZ, outX, outY, outZ, nullptr, count, matrix);
+  }
+
+  void TransformBatch(const float* inX, const float* inY, const float* inZ, float* outX,
+                      float* outY, float* outZ, float* outW, size_t count, const Mat4& matrix) {
+    TransformBatchImpl<true>(inX, inY, inZ, outX, outY, outZ, outW, count, matrix);
+  }
+
+  void ProjectToScreenBatch(const float* inX, const float* inY, const float* inZ, float* outX,
+                            float* outY, float* outZ, size_t count, const Mat4& matrix, int width,
+                            int height) {
+    const float(*m)[4] = matrix.m;
+    const float fHalfWidth = 0.5f * (float)width;
+    const float fHalfHeight = 0.5f * (float)height;
+    size_t i = 0;
+#if defined(ENGINE_SIMD_AVX)
+    const __m256 m00 = _mm256_set1_ps(m[0][0]), m01 = _mm256_set1_ps(m[0][1]),
+                 m02 = _mm256_set1_ps(m[0][2]), m03 = _mm256_set1_ps(m[0][3]);
+    const __m256 m10 = _mm256_set1_ps(m[1][0]), m11 = _mm256_set1_ps(m[1][1]),
+                 m12 = _mm256_set1_ps(m[1][2]), m13 = _mm256_set1_ps(m[1][3]);
+    const __m256 m20 = _mm256_set1_ps(m[2][0]), m21 = _mm256_set1_ps(m[2][1]),
+                 m22 = _mm256_set1_ps(m[2][2]), m23 = _mm256_set1_ps(m[2][3]);
+    const __m256 m30 = _mm256_set1_ps(m[3][0]), m31 = _mm256_set1_ps(m[3][1]),
+                 m32 = _mm256_set1_ps(m[3][2]), m33 = _mm256_set1_ps(m[3][3]);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    const __m256 halfW = _mm256_set1_ps(fHalfWidth), halfH = _mm256_set1_ps(fHalfHeight);
+    for (; i + 8 <= count; i += 8) {
+      __m256 x = _mm256_loadu_ps(inX + i);
+      __m256 y = _mm256_loadu_ps(inY + i);
+      __m256 z = _mm256_loadu_ps(inZ + i);
+      __m256 ox = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m00), _mm256_mul_ps(y, m10)),
+                                _mm256_add_ps(_mm256_mul_ps(z, m20), m30));
+      __m256 oy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m01), _mm256_mul_ps(y, m11)),
+                                _mm256_add_ps(_mm256_mul_ps(z, m21), m31));
+      __m256 oz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m02), _mm256_mul_ps(y, m12)),
+                                _mm256_add_ps(_mm256_mul_ps(z, m22), m32));
+      __m256 ow = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m03), _mm256_mul_ps(y, m13)),
+                                _mm256_add_ps(_mm256_mul_ps(z, m23), m33));
+      // Same rule as PerspectiveDivide: lanes with w == 0 are left undivided.
+      ow = _mm256_blendv_ps(ow, one, _mm256_cmp_ps(ow, zero, _CMP_EQ_OQ));
+      ox = _mm256_div_ps(ox, ow);
+      oy = _mm256_div_ps(oy, ow);
+      oz = _mm256_div_ps(oz, ow);
+      _mm256_storeu_ps(outX + i, _mm256_mul_ps(_mm256_add_ps(ox, one), halfW));
+      _mm256_storeu_ps(outY + i, _mm256_mul_ps(_mm256_add_ps(oy, one), halfH));
+      _mm256_storeu_ps(outZ + i, oz);
+    }
+#elif defined(ENGINE_SIMD_SSE)
+    const __m128 m00 = _mm_set1_ps(m[0][0]), m01 = _mm_set1_ps(m[0][1]),
+                 m02 = _mm_set1_ps(m[0][2]), m03 = _mm_set1_ps(m[0][3]);
+    const __m128 m10 = _mm_set1_ps(m[1][0]), m11 = _mm_set1_ps(m[1][1]),
+                 m12 = _mm_set1_ps(m[1][2]), m13 = _mm_set1_ps(m[1][3]);
+    const __m128 m20 = _mm_set1_ps(m[2][0]), m21 = _mm_set1_ps(m[2][1]),
+                 m22 = _mm_set1_ps(m[2][2]), m23 = _mm_set1_ps(m[2][3]);
+    const __m128 m30 = _mm_set1_ps(m[3][0]), m31 = _mm_set1_ps(m[3][1]),
+                 m32 = _mm_set1_ps(m[3][2]), m33 = _mm_set1_ps(m[3][3]);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const __m128 halfW = _mm_set1_ps(fHalfWidth), halfH = _mm_set1_ps(fHalfHeight);
+    for (; i + 4 <= count; i += 4) {
+      __m128 x = _mm_loadu_ps(inX + i);
+      __m128 y = _mm_loadu_ps(inY + i);
+      __m128 z = _mm_loadu_ps(inZ + i);
+      __m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)),
+                             _mm_add_ps(_mm_mul_ps(z, m20), m30));
+      __m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)),
+                             _mm_add_ps(_mm_mul_ps(z, m21), m31));
+      __m128 oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)),
+                             _mm_add_ps(_mm_mul_ps(z, m22), m32));
+      __m128 ow = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m03), _mm_mul_ps(y, m13)),
+                             _mm_add_ps(_mm_mul_ps(z, m23), m33));
+      // Same rule as PerspectiveDivide: lanes with w == 0 are left undivided.
+      __m128 wZero = _mm_cmpeq_ps(ow, zero);
+      ow = _mm_or_ps(_mm_andnot_ps(wZero, ow), _mm_and_ps(wZero, one));
+      ox = _mm_div_ps(ox, ow);
+      oy = _mm_div_ps(oy, ow);
+      oz = _mm_div_ps(oz, ow);
+      _mm_storeu_ps(outX + i, _mm_mul_ps(_mm_add_ps(ox, one), halfW));
+      _mm_storeu_ps(outY + i, _mm_mul_ps(_mm_add_ps(oy, one), halfH));
+      _mm_storeu_ps(outZ + i, oz);
+    }
+#endif
+    for (; i < count; ++i) {
+      float x = inX[i], y = inY[i], z = inZ[i];
+      float ox = x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0];
+      float oy = x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1];
+      float oz = x * m[0][2] + y * m[1][2] + z * m[2][2] + m[3][2];
+      float ow = x * m[0][3] + y * m[1][3] + z * m[2][3] + m[3][3];
+      if (ow == 0.0f)
+        ow = 1.0f;
+      outX[i] = (ox / ow + 1.0f) * fHalfWidth;
+      outY[i] = (oy / ow + 1.0f) * fHalfHeight;
+      outZ[i] = oz / ow;
+    }
+  }
+
+  void ProjectToScreenBatch(const VertexBuffer& in, VertexBuffer& out, const Mat4& matrix,
+                            int width, int height) {
+    out.Resize(in.Size());
+    ProjectToScreenBatch(in.x.data(), in.y.data(), in.z.data(), out.x.data(), out.y.data(),
+                         out.z.data(), in.Size(), matrix, width, height);
+  }
+
 } // namespace mathematics
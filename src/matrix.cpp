@@ -1,12 +1,161 @@
 #include "matrix.h"
 
+#include "simd.h"
+
+#include <cassert>
 #include <cmath>
 #include <cstring>
 
+Mat4 Mat4::MakeRotationX(float fAngleRad) {
+  float c = cosf(fAngleRad);
+  float s = sinf(fAngleRad);
+  return Mat4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Mat4 Mat4::MakeRotationY(float fAngleRad) {
+  float c = cosf(fAngleRad);
+  float s = sinf(fAngleRad);
+  return Mat4(c, 0.0f, s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Mat4 Mat4::MakeRotationZ(float fAngleRad) {
+  float c = cosf(fAngleRad);
+  float s = sinf(fAngleRad);
+  return Mat4(c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Mat4 Mat4::MakeProjection(float fFovDegrees, float fAspectRatio, float fNear, float fFar) {
+  Mat4 matrix;
+  float fFovRad = fFovDegrees * (3.14159265f / 180.0f);
+  float fFovTanInv = 1.0f / tanf(fFovRad / 2.0f);
+
+  matrix.m[0][0] = fAspectRatio * fFovTanInv;
+  matrix.m[1][1] = fFovTanInv;
+  matrix.m[2][2] = fFar / (fFar - fNear);
+  matrix.m[3][2] = (-fFar * fNear) / (fFar - fNear);
+  matrix.m[2][3] = 1.0f;
+  matrix.m[3][3] = 0.0f;
+  return matrix;
+}
+
+Mat4 Mat4::Multiply(const Mat4& matOne, const Mat4& matTwo) {
+  Mat4 matrix;
+#if defined(ENGINE_SIMD_AVX)
+  // Two output rows per iteration: each 128-bit lane holds one row of matOne.
+  __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matTwo.m[0]));
+  __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matTwo.m[1]));
+  __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matTwo.m[2]));
+  __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matTwo.m[3]));
+  for (int row = 0; row < 4; row += 2) {
+    __m256 a = _mm256_loadu_ps(matOne.m[row]);
+    __m256 r = _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x00), b0);
+    r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x55), b1));
+    r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xAA), b2));
+    r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xFF), b3));
+    _mm256_storeu_ps(matrix.m[row], r);
+  }
+#elif defined(ENGINE_SIMD_SSE)
+  __m128 b0 = _mm_load_ps(matTwo.m[0]);
+  __m128 b1 = _mm_load_ps(matTwo.m[1]);
+  __m128 b2 = _mm_load_ps(matTwo.m[2]);
+  __m128 b3 = _mm_load_ps(matTwo.m[3]);
+  for (int row = 0; row < 4; ++row) {
+    __m128 r = _mm_mul_ps(_mm_set1_ps(matOne.m[row][0]), b0);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(matOne.m[row][1]), b1));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(matOne.m[row][2]), b2));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(matOne.m[row][3]), b3));
+    _mm_store_ps(matrix.m[row], r);
+  }
+#else
+  for (int row = 0; row < 4; ++row) {
+    for (int col = 0; col < 4; ++col) {
+      matrix.m[row][col] = matOne.m[row][0] * matTwo.m[0][col] +
+                           matOne.m[row][1] * matTwo.m[1][col] +
+                           matOne.m[row][2] * matTwo.m[2][col] +
+                           matOne.m[row][3] * matTwo.m[3][col];
+    }
+  }
+#endif
+  return matrix;
+}
+
+Mat4 Mat4::Transpose(const Mat4& mat) {
+  Mat4 matrix;
+#if defined(ENGINE_SIMD_SSE)
+  __m128 r0 = _mm_load_ps(mat.m[0]);
+  __m128 r1 = _mm_load_ps(mat.m[1]);
+  __m128 r2 = _mm_load_ps(mat.m[2]);
+  __m128 r3 = _mm_load_ps(mat.m[3]);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_store_ps(matrix.m[0], r0);
+  _mm_store_ps(matrix.m[1], r1);
+  _mm_store_ps(matrix.m[2], r2);
+  _mm_store_ps(matrix.m[3], r3);
+#else
+  for (int row = 0; row < 4; ++row)
+    for (int col = 0; col < 4; ++col)
+      matrix.m[row][col] = mat.m[col][row];
+#endif
+  return matrix;
+}
+
+bool Mat4::Inverse(const Mat4& mat, Mat4& outMat) {
+  // Laplace expansion over the 2x2 sub-determinants of the top and bottom row pairs.
+  // Straight-line code with no branches, which the compiler vectorizes well.
+  const float(*a)[4] = mat.m;
+  float s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+  float s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+  float s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+  float s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+  float s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+  float s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+  float c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+  float c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+  float c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+  float c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+  float c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+  float c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+  float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  if (det == 0.0f)
+    return false;
+  float inv = 1.0f / det;
+
+  Mat4 r;
+  r.m[0][0] = (a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3) * inv;
+  r.m[0][1] = (-a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3) * inv;
+  r.m[0][2] = (a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3) * inv;
+  r.m[0][3] = (-a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3) * inv;
+
+  r.m[1][0] = (-a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1) * inv;
+  r.m[1][1] = (a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1) * inv;
+  r.m[1][2] = (-a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1) * inv;
+  r.m[1][3] = (a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1) * inv;
+
+  r.m[2][0] = (a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0) * inv;
+  r.m[2][1] = (-a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0) * inv;
+  r.m[2][2] = (a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0) * inv;
+  r.m[2][3] = (-a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0) * inv;
+
+  r.m[3][0] = (-a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0) * inv;
+  r.m[3][1] = (a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0) * inv;
+  r.m[3][2] = (-a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0) * inv;
+  r.m[3][3] = (a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0) * inv;
+
+  outMat = r;
+  return true;
+}
+
 Matrix::Matrix(int rows, int cols) : m_iRows(rows), m_iCols(cols) {
   m_data = new float[rows * cols]{};
 }
 
+Matrix::Matrix(const Mat4& mat) : m_iRows(4), m_iCols(4) {
+  m_data = new float[16];
+  std::memcpy(m_data, mat.m, 16 * sizeof(float));
+}
+
 Matrix::~Matrix() { delete[] m_data; }
 
 Matrix::Matrix(const Matrix& other) : m_iRows(other.m_iRows), m_iCols(other.m_iCols) {
@@ -54,6 +203,13 @@ int Matrix::GetRows() const { return m_iRows; }
 
 int Matrix::GetCols() const { return m_iCols; }
 
+Mat4 Matrix::ToMat4() const {
+  assert(m_iRows == 4 && m_iCols == 4);
+  Mat4 mat;
+  std::memcpy(mat.m, m_data, 16 * sizeof(float));
+  return mat;
+}
+
 Matrix Matrix::MakeIdentity() {
   Matrix matrix(4, 4);
   matrix.Set(0, 0, 1.0f);
@@ -130,3 +286,7 @@ Matrix Matrix::Multiply(const Matrix& matOne, const Matrix& matTwo) {
   }
   return matrix;
 }
+
+Mat4 Matrix::Multiply(const Mat4& matOne, const Mat4& matTwo) {
+  return Mat4::Multiply(matOne, matTwo);
+}
@@ -1,40 +1,162 @@
 #include "mesh.h"
 
 #include "mathematics.h"
+#include "objloader.h"
 
 #include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+  // Position quantized for welding. Exact welding uses the float bit patterns.
+  struct WeldKey {
+    int64_t k[3];
+    bool operator==(const WeldKey& o) const {
+      return k[0] == o.k[0] && k[1] == o.k[1] && k[2] == o.k[2];
+    }
+  };
+
+  struct WeldKeyHash {
+    size_t operator()(const WeldKey& key) const {
+      uint64_t h = (uint64_t)key.k[0] * 0x9E3779B97F4A7C15ull;
+      h = (h ^ (h >> 29) ^ (uint64_t)key.k[1]) * 0xBF58476D1CE4E5B9ull;
+      h = (h ^ (h >> 32) ^ (uint64_t)key.k[2]) * 0x94D049BB133111EBull;
+      return (size_t)(h ^ (h >> 31));
+    }
+  };
+
+  WeldKey MakeWeldKey(const VecThree& v, float fEpsilon) {
+    const float c[3] = {v.x, v.y, v.z};
+    WeldKey key;
+    for (int i = 0; i < 3; ++i) {
+      if (fEpsilon > 0.0f) {
+        key.k[i] = (int64_t)std::floor(c[i] / fEpsilon);
+      } else {
+        // Adding zero folds -0 into +0.
+        float f = c[i] + 0.0f;
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        key.k[i] = bits;
+      }
+    }
+    return key;
+  }
+} // namespace
+
+uint32_t Mesh::AddVertex(const VecThree& v) {
+  uint32_t index = (uint32_t)vertices.Size();
+  vertices.x.push_back(v.x);
+  vertices.y.push_back(v.y);
+  vertices.z.push_back(v.z);
+  return index;
+}
+
+void Mesh::AddTriangle(uint32_t a, uint32_t b, uint32_t c) {
+  indices.push_back(a);
+  indices.push_back(b);
+  indices.push_back(c);
+}
+
+void Mesh::AddTriangle(const Triangle& tri) {
+  uint32_t a = AddVertex(tri.points[0]);
+  uint32_t b = AddVertex(tri.points[1]);
+  uint32_t c = AddVertex(tri.points[2]);
+  AddTriangle(a, b, c);
+}
+
+Triangle Mesh::GetTriangle(size_t t) const {
+  Triangle tri;
+  for (int i = 0; i < 3; ++i)
+    tri.points[i] = vertices.Get(indices[t * 3 + i]);
+  return tri;
+}
+
+void Mesh::Clear() {
+  vertices.Resize(0);
+  indices.clear();
+}
+
+size_t Mesh::Weld(float fEpsilon) {
+  const size_t nVertices = vertices.Size();
+  const uint32_t UNUSED = 0xFFFFFFFFu;
+
+  // Only referenced vertices take part, so unused ones disappear along the way.
+  std::vector<uint32_t> remap(nVertices, UNUSED);
+  for (uint32_t index : indices)
+    remap[index] = 0;
+
+  std::unordered_map<WeldKey, uint32_t, WeldKeyHash> unique;
+  unique.reserve(nVertices);
+  VertexBuffer welded;
+  for (size_t i = 0; i < nVertices; ++i) {
+    if (remap[i] == UNUSED)
+      continue;
+    VecThree v = vertices.Get(i);
+    auto result = unique.emplace(MakeWeldKey(v, fEpsilon), (uint32_t)welded.Size());
+    if (result.second) {
+      welded.x.push_back(v.x);
+      welded.y.push_back(v.y);
+      welded.z.push_back(v.z);
+    }
+    remap[i] = result.first->second;
+  }
+
+  size_t nOut = 0;
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    uint32_t a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+    if (a == b || b == c || a == c)
+      continue;
+    indices[nOut++] = a;
+    indices[nOut++] = b;
+    indices[nOut++] = c;
+  }
+  indices.resize(nOut);
+
+  size_t nRemoved = nVertices - welded.Size();
+  vertices = std::move(welded);
+  return nRemoved;
+}
 
 bool Mesh::LoadFromObjectFile(std::string sFilename) {
-  // Placeholder for future OBJ loading
-  return false;
+  objloader::ObjData data;
+  if (!objloader::LoadFile(sFilename, data))
+    return false;
+
+  // Texture coordinates and normals are not kept, so corners reduce to position indices.
+  Clear();
+  vertices.Resize(data.positions.size());
+  for (size_t i = 0; i < data.positions.size(); ++i)
+    vertices.Set(i, data.positions[i]);
+  indices.resize(data.corners.size());
+  for (size_t i = 0; i < data.corners.size(); ++i)
+    indices[i] = data.corners[i].v;
+  Weld();
+  return true;
 }
 
 void Mesh::RotateX(float fAngle) {
-  Matrix mat = Matrix::MakeRotationX(mathematics::DegToRad(fAngle));
+  Mat4 mat = Mat4::MakeRotationX(mathematics::DegToRad(fAngle));
   ApplyMatrix(mat);
 }
 
 void Mesh::RotateY(float fAngle) {
-  Matrix mat = Matrix::MakeRotationY(mathematics::DegToRad(fAngle));
+  Mat4 mat = Mat4::MakeRotationY(mathematics::DegToRad(fAngle));
   ApplyMatrix(mat);
 }
 
 void Mesh::RotateZ(float fAngle) {
-  Matrix mat = Matrix::MakeRotationZ(mathematics::DegToRad(fAngle));
+  Mat4 mat = Mat4::MakeRotationZ(mathematics::DegToRad(fAngle));
   ApplyMatrix(mat);
 }
 
 void Mesh::Translate(float x, float y, float z) {
-  Matrix mat = Matrix::MakeTranslation(x, y, z);
+  Mat4 mat = Mat4::MakeTranslation(x, y, z);
   ApplyMatrix(mat);
 }
 
-void Mesh::ApplyMatrix(Matrix& mat) {
-  for (auto& tri : tris) {
-    for (int i = 0; i < 3; i++) {
-      float w = 1.0f;
-      VecThree in = tri.points[i];
-      mathematics::MultiplyMatrixVector(in, tri.points[i], w, mat);
-    }
-  }
+void Mesh::ApplyMatrix(const Mat4& mat) {
+  float* x = vertices.x.data();
+  float* y = vertices.y.data();
+  float* z = vertices.z.data();
+  mathematics::TransformBatch(x, y, z, x, y, z, vertices.Size(), mat);
 }
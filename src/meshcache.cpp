@@ -0,0 +1,223 @@
+#include "meshcache.h"
+
+#include "meshopt.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <type_traits>
+
+namespace meshcache {
+  namespace {
+    const char MAGIC[8] = {'G', 'E', 'M', 'E', 'S', 'H', '\0', '\0'};
+    const uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+    static_assert(std::is_trivially_copyable<Header>::value, "Header is written as bytes");
+    static_assert(sizeof(Header) % 8 == 0, "Header must keep the streams 8-byte aligned");
+
+    size_t AlignUp(size_t offset) { return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+    uint64_t Rotl(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+    const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+    const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+
+    uint64_t Mix(uint64_t hash) {
+      hash ^= hash >> 33;
+      hash *= PRIME2;
+      hash ^= hash >> 29;
+      return hash;
+    }
+
+    // The streams in file order, with their sizes in bytes.
+    struct Streams {
+      const void* data[4];
+      size_t bytes[4];
+    };
+
+    Streams StreamsOf(const MeshView& view) {
+      size_t positionBytes = view.nVertices * sizeof(float);
+      return {{view.x, view.y, view.z, view.indices},
+              {positionBytes, positionBytes, positionBytes,
+               view.nTriangles * 3 * sizeof(uint32_t)}};
+    }
+
+    uint64_t HashStreams(const Streams& streams) {
+      uint64_t hash = 0;
+      for (int i = 0; i < 4; ++i)
+        hash = Hash(streams.data[i], streams.bytes[i], hash);
+      return hash;
+    }
+  } // namespace
+
+  uint64_t Hash(const void* data, size_t size, uint64_t seed) {
+    // Four independent lanes over 32-byte blocks keep the multiplies pipelined.
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t lanes[4] = {seed + PRIME1, seed ^ PRIME2, seed - PRIME1, Rotl(seed, 17)};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+      for (int lane = 0; lane < 4; ++lane) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i + lane * 8, 8);
+        lanes[lane] = Rotl(lanes[lane] + word * PRIME2, 31) * PRIME1;
+      }
+    }
+    uint64_t hash = Rotl(lanes[0], 1) + Rotl(lanes[1], 7) + Rotl(lanes[2], 12) +
+                    Rotl(lanes[3], 18) + (uint64_t)size;
+    for (; i < size; ++i)
+      hash = Rotl(hash ^ (bytes[i] * PRIME1), 11) * PRIME2;
+    return Mix(hash);
+  }
+
+  bool GetSourceStamp(const std::string& sFilename, SourceStamp& out) {
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(sFilename, error);
+    if (error)
+      return false;
+    auto time = std::filesystem::last_write_time(sFilename, error);
+    if (error)
+      return false;
+    out.size = (uint64_t)size;
+    out.time = (int64_t)time.time_since_epoch().count();
+    return true;
+  }
+
+  bool Write(const std::string& sFilename, const Mesh& mesh, const SourceStamp& source) {
+    MeshView view = mesh.View();
+    Streams streams = StreamsOf(view);
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.vertexCount = view.nVertices;
+    header.triangleCount = view.nTriangles;
+    size_t offset = sizeof(Header);
+    for (int i = 0; i < 4; ++i) {
+      offset = AlignUp(offset);
+      header.offsets[i] = offset;
+      offset += streams.bytes[i];
+    }
+    header.fileSize = offset;
+    Aabb bounds = Aabb::FromMesh(mesh);
+    if (bounds.IsEmpty())
+      bounds.min = bounds.max = VecThree();
+    header.boundsMin[0] = bounds.min.x;
+    header.boundsMin[1] = bounds.min.y;
+    header.boundsMin[2] = bounds.min.z;
+    header.boundsMax[0] = bounds.max.x;
+    header.boundsMax[1] = bounds.max.y;
+    header.boundsMax[2] = bounds.max.z;
+    header.contentHash = HashStreams(streams);
+    header.source = source;
+
+    std::string sTemporary = sFilename + ".tmp";
+    FILE* file = std::fopen(sTemporary.c_str(), "wb");
+    if (!file)
+      return false;
+    static const char padding[ALIGNMENT] = {};
+    bool bOk = std::fwrite(&header, sizeof(Header), 1, file) == 1;
+    size_t written = sizeof(Header);
+    for (int i = 0; i < 4 && bOk; ++i) {
+      size_t pad = header.offsets[i] - written;
+      bOk = std::fwrite(padding, 1, pad, file) == pad &&
+            std::fwrite(streams.data[i], 1, streams.bytes[i], file) == streams.bytes[i];
+      written = header.offsets[i] + streams.bytes[i];
+    }
+    bOk = std::fclose(file) == 0 && bOk;
+
+    std::error_code error;
+    if (bOk)
+      std::filesystem::rename(sTemporary, sFilename, error);
+    if (!bOk || error) {
+      std::filesystem::remove(sTemporary, error);
+      return false;
+    }
+    return true;
+  }
+
+  bool MappedMesh::Open(const std::string& sFilename, bool bVerify) {
+    Close();
+    auto fail = [this] {
+      Close();
+      return false;
+    };
+    if (!m_file.Open(sFilename) || m_file.Size() < sizeof(Header))
+      return fail();
+
+    std::memcpy(&m_header, m_file.Data(), sizeof(Header));
+    const Header& h = m_header;
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION ||
+        h.byteOrder != BYTE_ORDER_MARK || h.fileSize != m_file.Size())
+      return fail();
+
+    // Counts are bounded first so that the stream sizes below cannot overflow.
+    if (h.vertexCount > h.fileSize || h.triangleCount > h.fileSize)
+      return fail();
+    uint64_t bytes[4] = {h.vertexCount * sizeof(float), h.vertexCount * sizeof(float),
+                         h.vertexCount * sizeof(float), h.triangleCount * 3 * sizeof(uint32_t)};
+    for (int i = 0; i < 4; ++i) {
+      if (h.offsets[i] % ALIGNMENT != 0 || h.offsets[i] < sizeof(Header) ||
+          h.offsets[i] > h.fileSize || bytes[i] > h.fileSize - h.offsets[i])
+        return fail();
+    }
+
+    const char* base = m_file.Data();
+    m_view.x = reinterpret_cast<const float*>(base + h.offsets[0]);
+    m_view.y = reinterpret_cast<const float*>(base + h.offsets[1]);
+    m_view.z = reinterpret_cast<const float*>(base + h.offsets[2]);
+    m_view.indices = reinterpret_cast<const uint32_t*>(base + h.offsets[3]);
+    m_view.nVertices = (size_t)h.vertexCount;
+    m_view.nTriangles = (size_t)h.triangleCount;
+
+    if (bVerify) {
+      const uint32_t* end = m_view.indices + m_view.nTriangles * 3;
+      bool bIndicesOk = std::all_of(m_view.indices, end, [&](uint32_t index) {
+        return index < m_view.nVertices;
+      });
+      if (!bIndicesOk || HashStreams(StreamsOf(m_view)) != h.contentHash)
+        return fail();
+    }
+    return true;
+  }
+
+  void MappedMesh::Close() {
+    m_file.Close();
+    m_header = {};
+    m_view = MeshView();
+  }
+
+  Aabb MappedMesh::GetBounds() const {
+    Aabb bounds;
+    if (m_view.nVertices == 0)
+      return bounds;
+    bounds.min = {m_header.boundsMin[0], m_header.boundsMin[1], m_header.boundsMin[2]};
+    bounds.max = {m_header.boundsMax[0], m_header.boundsMax[1], m_header.boundsMax[2]};
+    return bounds;
+  }
+
+  void MappedMesh::CopyTo(Mesh& mesh) const {
+    mesh.Clear();
+    mesh.vertices.x.assign(m_view.x, m_view.x + m_view.nVertices);
+    mesh.vertices.y.assign(m_view.y, m_view.y + m_view.nVertices);
+    mesh.vertices.z.assign(m_view.z, m_view.z + m_view.nVertices);
+    mesh.indices.assign(m_view.indices, m_view.indices + m_view.nTriangles * 3);
+  }
+
+  bool LoadObj(const std::string& sObjFile, MappedMesh& out, const std::string& sCacheFile) {
+    std::string sCache = sCacheFile.empty() ? sObjFile + ".mesh" : sCacheFile;
+    SourceStamp stamp;
+    if (!GetSourceStamp(sObjFile, stamp))
+      return false;
+    if (out.Open(sCache) && out.GetHeader().source == stamp)
+      return true;
+
+    Mesh mesh;
+    if (!mesh.LoadFromObjectFile(sObjFile))
+      return false;
+    meshopt::Optimize(mesh);
+    return Write(sCache, mesh, stamp) && out.Open(sCache);
+  }
+} // namespace meshcache
@@ -0,0 +1,185 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+  const uint32_t NONE = UINT32_MAX;
+
+  VecThree Sub(const VecThree& a, const VecThree& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+  float Dot(const VecThree& a, const VecThree& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+  VecThree Cross(const VecThree& a, const VecThree& b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+  }
+
+  // Sphere and normal cone of the meshlet whose vertices and triangles are already in out.
+  void ComputeBounds(const MeshletMesh& out, Meshlet& meshlet) {
+    const VertexBuffer& v = out.vertices;
+    Aabb box;
+    for (uint32_t i = 0; i < meshlet.nVertices; ++i)
+      box.Expand(v.Get(meshlet.vertexOffset + i));
+    meshlet.bounds.center = box.Center();
+    float radiusSq = 0.0f;
+    for (uint32_t i = 0; i < meshlet.nVertices; ++i) {
+      VecThree d = Sub(v.Get(meshlet.vertexOffset + i), meshlet.bounds.center);
+      radiusSq = std::max(radiusSq, Dot(d, d));
+    }
+    meshlet.bounds.radius = std::sqrt(radiusSq);
+
+    // The axis is the mean normal and the cutoff the sine of the widest angle from it.
+    // A degenerate triangle has no normal to bound, so it disables the cone.
+    std::vector<VecThree> normals(meshlet.nTriangles);
+    VecThree sum;
+    bool bDegenerate = false;
+    for (uint32_t t = 0; t < meshlet.nTriangles; ++t) {
+      const uint8_t* tri = &out.triangles[meshlet.triangleOffset + t * 3];
+      VecThree a = v.Get(meshlet.vertexOffset + tri[0]);
+      VecThree n = Cross(Sub(v.Get(meshlet.vertexOffset + tri[1]), a),
+                         Sub(v.Get(meshlet.vertexOffset + tri[2]), a));
+      float length = std::sqrt(Dot(n, n));
+      if (length == 0.0f) {
+        bDegenerate = true;
+        break;
+      }
+      normals[t] = {n.x / length, n.y / length, n.z / length};
+      sum = {sum.x + normals[t].x, sum.y + normals[t].y, sum.z + normals[t].z};
+    }
+    meshlet.coneAxis = VecThree();
+    meshlet.coneCutoff = 1.0f;
+    float length = std::sqrt(Dot(sum, sum));
+    if (bDegenerate || length == 0.0f)
+      return;
+    VecThree axis = {sum.x / length, sum.y / length, sum.z / length};
+    float minDot = 1.0f;
+    for (const VecThree& n : normals)
+      minDot = std::min(minDot, Dot(n, axis));
+    if (minDot <= 0.0f)
+      return;
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(std::max(0.0f, 1.0f - minDot * minDot));
+  }
+} // namespace
+
+MeshletMesh MeshletMesh::Build(const MeshView& mesh, size_t nMaxVertices, size_t nMaxTriangles) {
+  assert(nMaxVertices >= 3 && nMaxVertices <= 256 && nMaxTriangles >= 1);
+  MeshletMesh out;
+  const size_t nTriangles = mesh.nTriangles;
+  const uint32_t* indices = mesh.indices;
+  auto position = [&](uint32_t v) { return VecThree{mesh.x[v], mesh.y[v], mesh.z[v]}; };
+
+  // Triangles of each vertex, and each triangle's unit normal (zero when degenerate)
+  std::vector<uint32_t> offsets(mesh.nVertices + 1, 0);
+  for (size_t i = 0; i < nTriangles * 3; ++i)
+    ++offsets[indices[i] + 1];
+  for (size_t v = 0; v < mesh.nVertices; ++v)
+    offsets[v + 1] += offsets[v];
+  std::vector<uint32_t> adjacency(nTriangles * 3);
+  {
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < nTriangles * 3; ++i)
+      adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+  }
+  std::vector<VecThree> normals(nTriangles);
+  for (size_t t = 0; t < nTriangles; ++t) {
+    VecThree a = position(indices[t * 3]);
+    VecThree n =
+      Cross(Sub(position(indices[t * 3 + 1]), a), Sub(position(indices[t * 3 + 2]), a));
+    float length = std::sqrt(Dot(n, n));
+    if (length > 0.0f)
+      normals[t] = {n.x / length, n.y / length, n.z / length};
+  }
+
+  std::vector<bool> emitted(nTriangles, false);
+  std::vector<uint32_t> localOf(mesh.nVertices, NONE);
+  std::vector<uint32_t> used; // mesh vertices of the open meshlet, by local index
+  used.reserve(nMaxVertices);
+  Meshlet meshlet = {};
+  VecThree normalSum;
+  size_t nextSeed = 0;
+
+  auto newVertices = [&](size_t t) {
+    const uint32_t* tri = indices + t * 3;
+    int nNew = 0;
+    for (int k = 0; k < 3; ++k) {
+      bool bRepeat = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+      if (localOf[tri[k]] == NONE && !bRepeat)
+        ++nNew;
+    }
+    return nNew;
+  };
+
+  auto add = [&](size_t t) {
+    for (int k = 0; k < 3; ++k) {
+      uint32_t& local = localOf[indices[t * 3 + k]];
+      if (local == NONE) {
+        local = (uint32_t)used.size();
+        used.push_back(indices[t * 3 + k]);
+      }
+      out.triangles.push_back((uint8_t)local);
+    }
+    emitted[t] = true;
+    ++meshlet.nTriangles;
+    normalSum = {normalSum.x + normals[t].x, normalSum.y + normals[t].y,
+                 normalSum.z + normals[t].z};
+  };
+
+  auto close = [&] {
+    meshlet.nVertices = (uint32_t)used.size();
+    size_t base = out.vertices.Size();
+    out.vertices.Resize(base + used.size());
+    for (size_t i = 0; i < used.size(); ++i) {
+      out.vertices.Set(base + i, position(used[i]));
+      localOf[used[i]] = NONE;
+    }
+    ComputeBounds(out, meshlet);
+    out.meshlets.push_back(meshlet);
+
+    used.clear();
+    meshlet = {};
+    meshlet.vertexOffset = (uint32_t)out.vertices.Size();
+    meshlet.triangleOffset = (uint32_t)out.triangles.size();
+    normalSum = VecThree();
+  };
+
+  // Each meshlet starts from the first triangle left in input order and grows through
+  // shared vertices, taking the neighbour that adds the fewest new vertices and, among
+  // those, the one whose normal best matches the meshlet's so far: compact clusters with
+  // narrow normal cones.
+  for (size_t nEmitted = 0; nEmitted < nTriangles; ++nEmitted) {
+    uint32_t next = NONE;
+    if (meshlet.nTriangles > 0 && meshlet.nTriangles < nMaxTriangles) {
+      float length = std::sqrt(Dot(normalSum, normalSum));
+      VecThree axis = length > 0.0f ? VecThree{normalSum.x / length, normalSum.y / length,
+                                               normalSum.z / length}
+                                    : VecThree();
+      float bestScore = 1e30f;
+      for (uint32_t v : used) {
+        for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+          uint32_t t = adjacency[i];
+          if (emitted[t])
+            continue;
+          int nNew = newVertices(t);
+          if (used.size() + nNew > nMaxVertices)
+            continue;
+          float score = (float)nNew + 0.5f * (1.0f - Dot(normals[t], axis));
+          if (score < bestScore) {
+            bestScore = score;
+            next = t;
+          }
+        }
+      }
+    }
+    if (next == NONE) {
+      if (meshlet.nTriangles > 0)
+        close();
+      while (emitted[nextSeed])
+        ++nextSeed;
+      next = (uint32_t)nextSeed;
+    }
+    add(next);
+  }
+  if (meshlet.nTriangles > 0)
+    close();
+  return out;
+}
@@ -0,0 +1,419 @@
+#include "meshopt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace meshopt {
+  namespace {
+    // Forsyth's scoring constants: the three most recent vertices score a flat
+    // LAST_TRIANGLE_SCORE (so the next triangle does not simply reuse the last edge), older
+    // entries decay with CACHE_DECAY, and vertices with few triangles left get a valence
+    // boost so that they are finished off rather than stranded.
+    const float CACHE_DECAY = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_SCALE = 2.0f;
+    const float VALENCE_POWER = 0.5f;
+    const uint32_t VALENCE_TABLE = 32;
+    const uint32_t NONE = UINT32_MAX;
+
+    struct ScoreTables {
+      float cache[CACHE_SIZE];
+      float valence[VALENCE_TABLE];
+
+      ScoreTables() {
+        for (size_t i = 0; i < CACHE_SIZE; ++i) {
+          cache[i] = i < 3 ? LAST_TRIANGLE_SCORE
+                           : std::pow(1.0f - (float)(i - 3) / (float)(CACHE_SIZE - 3), CACHE_DECAY);
+        }
+        valence[0] = 0.0f;
+        for (uint32_t i = 1; i < VALENCE_TABLE; ++i)
+          valence[i] = VALENCE_SCALE * std::pow((float)i, -VALENCE_POWER);
+      }
+    };
+
+    // Score of a vertex at cachePosition (NONE when not cached) with nRemaining unemitted
+    // triangles.
+    float VertexScore(const ScoreTables& tables, uint32_t cachePosition, uint32_t nRemaining) {
+      if (nRemaining == 0)
+        return -1.0f;
+      float score = cachePosition < CACHE_SIZE ? tables.cache[cachePosition] : 0.0f;
+      score += nRemaining < VALENCE_TABLE
+                 ? tables.valence[nRemaining]
+                 : VALENCE_SCALE * std::pow((float)nRemaining, -VALENCE_POWER);
+      return score;
+    }
+
+    // Weight of the planes that hold open borders in place, relative to a face plane.
+    const double BORDER_WEIGHT = 10.0;
+
+    // Weighted squared distances to a set of planes, as the symmetric 4x4 matrix of
+    // Garland and Heckbert, [p 1] Q [p 1]^T, with the total weight. Error() is the mean
+    // rather than the sum, so it stays a squared distance however many planes a vertex
+    // has gathered through collapses.
+    struct Quadric {
+      double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+      double weight = 0;
+
+      // The plane a*x + b*y + c*z + d = 0, unit normal, scaled by weight.
+      static Quadric FromPlane(double a, double b, double c, double d, double weight) {
+        Quadric q;
+        q.a2 = weight * a * a, q.ab = weight * a * b, q.ac = weight * a * c;
+        q.ad = weight * a * d, q.b2 = weight * b * b, q.bc = weight * b * c;
+        q.bd = weight * b * d, q.c2 = weight * c * c, q.cd = weight * c * d;
+        q.d2 = weight * d * d;
+        q.weight = weight;
+        return q;
+      }
+
+      void Add(const Quadric& o) {
+        a2 += o.a2, ab += o.ab, ac += o.ac, ad += o.ad, b2 += o.b2;
+        bc += o.bc, bd += o.bd, c2 += o.c2, cd += o.cd, d2 += o.d2;
+        weight += o.weight;
+      }
+
+      double Error(const VecThree& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+                   2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+        return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+      }
+    };
+
+    VecThree Sub(const VecThree& a, const VecThree& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+    double Dot(const VecThree& a, const VecThree& b) {
+      return (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+    }
+    VecThree Cross(const VecThree& a, const VecThree& b) {
+      return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    // Moving vertex from onto vertex to; cost is the combined quadric error at to.
+    struct Collapse {
+      double cost;
+      uint32_t from, to;
+      uint32_t fromVersion, toVersion;
+
+      bool operator>(const Collapse& o) const { return cost > o.cost; }
+    };
+  } // namespace
+
+  void OptimizeVertexCache(uint32_t* indices, size_t nIndices, size_t nVertices) {
+    static const ScoreTables tables;
+    const size_t nTriangles = nIndices / 3;
+    if (nTriangles == 0)
+      return;
+
+    // Triangles of each vertex as one array indexed through offsets. The unemitted ones
+    // are kept at the front of each vertex's run, nRemaining long.
+    std::vector<uint32_t> offsets(nVertices + 1, 0);
+    for (size_t i = 0; i < nTriangles * 3; ++i)
+      ++offsets[indices[i] + 1];
+    for (size_t v = 0; v < nVertices; ++v)
+      offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> nRemaining(nVertices, 0);
+    std::vector<uint32_t> adjacency(nTriangles * 3);
+    for (size_t t = 0; t < nTriangles; ++t) {
+      for (int k = 0; k < 3; ++k) {
+        uint32_t v = indices[t * 3 + k];
+        adjacency[offsets[v] + nRemaining[v]++] = (uint32_t)t;
+      }
+    }
+
+    std::vector<float> vertexScore(nVertices);
+    for (size_t v = 0; v < nVertices; ++v)
+      vertexScore[v] = VertexScore(tables, NONE, nRemaining[v]);
+    std::vector<float> triangleScore(nTriangles);
+    std::vector<bool> emitted(nTriangles, false);
+    for (size_t t = 0; t < nTriangles; ++t) {
+      const uint32_t* tri = indices + t * 3;
+      triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+    }
+
+    std::vector<uint32_t> output(nTriangles * 3);
+    uint32_t cache[CACHE_SIZE + 3];
+    uint32_t newCache[CACHE_SIZE + 3];
+    size_t nCache = 0;
+    size_t nextInput = 0; // where to look for a fresh start when the cache runs dry
+
+    uint32_t best = 0;
+    for (size_t t = 1; t < nTriangles; ++t) {
+      if (triangleScore[t] > triangleScore[best])
+        best = (uint32_t)t;
+    }
+
+    for (size_t out = 0; out < nTriangles; ++out) {
+      if (best == NONE) {
+        while (emitted[nextInput])
+          ++nextInput;
+        best = (uint32_t)nextInput;
+      }
+      const uint32_t tri[3] = {indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2]};
+      std::copy(tri, tri + 3, output.begin() + out * 3);
+      emitted[best] = true;
+
+      for (uint32_t v : tri) {
+        uint32_t* run = adjacency.data() + offsets[v];
+        uint32_t* last = run + nRemaining[v] - 1;
+        *std::find(run, last, best) = *last;
+        *last = best;
+        --nRemaining[v];
+      }
+
+      // The triangle's vertices move to the front; the rest keep their order behind them.
+      size_t nNewCache = 0;
+      for (uint32_t v : tri)
+        newCache[nNewCache++] = v;
+      for (size_t i = 0; i < nCache; ++i) {
+        uint32_t v = cache[i];
+        if (v != tri[0] && v != tri[1] && v != tri[2])
+          newCache[nNewCache++] = v;
+      }
+
+      // Rescore the cached vertices (and the ones just pushed out) and the triangles
+      // around them, picking the best of those triangles to emit next.
+      best = NONE;
+      float bestScore = -1.0f;
+      for (size_t i = 0; i < nNewCache; ++i) {
+        uint32_t v = newCache[i];
+        uint32_t position = i < CACHE_SIZE ? (uint32_t)i : NONE;
+        float score = VertexScore(tables, position, nRemaining[v]);
+        float delta = score - vertexScore[v];
+        vertexScore[v] = score;
+        const uint32_t* run = adjacency.data() + offsets[v];
+        for (uint32_t j = 0; j < nRemaining[v]; ++j) {
+          uint32_t t = run[j];
+          triangleScore[t] += delta;
+          if (triangleScore[t] > bestScore) {
+            bestScore = triangleScore[t];
+            best = t;
+          }
+        }
+      }
+      nCache = std::min(nNewCache, CACHE_SIZE);
+      std::copy(newCache, newCache + nCache, cache);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+  }
+
+  size_t OptimizeVertexFetch(Mesh& mesh) {
+    const size_t nVertices = mesh.VertexCount();
+    std::vector<uint32_t> remap(nVertices, NONE);
+    uint32_t nNext = 0;
+    for (uint32_t& index : mesh.indices) {
+      if (remap[index] == NONE)
+        remap[index] = nNext++;
+      index = remap[index];
+    }
+
+    VertexBuffer reordered;
+    reordered.Resize(nNext);
+    for (size_t v = 0; v < nVertices; ++v) {
+      if (remap[v] != NONE)
+        reordered.Set(remap[v], mesh.vertices.Get(v));
+    }
+    mesh.vertices = std::move(reordered);
+    return nVertices - nNext;
+  }
+
+  void Optimize(Mesh& mesh) {
+    OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.VertexCount());
+    OptimizeVertexFetch(mesh);
+  }
+
+  float AverageCacheMissRatio(const uint32_t* indices, size_t nIndices, size_t nVertices,
+                              size_t cacheSize) {
+    const size_t nTriangles = nIndices / 3;
+    if (nTriangles == 0)
+      return 0.0f;
+    // A vertex is cached while fewer than cacheSize misses have happened since its own.
+    std::vector<size_t> missedAt(nVertices, 0);
+    size_t nMisses = 0;
+    for (size_t i = 0; i < nTriangles * 3; ++i) {
+      size_t& at = missedAt[indices[i]];
+      if (at == 0 || nMisses + 1 - at > cacheSize)
+        at = ++nMisses;
+    }
+    return (float)nMisses / (float)nTriangles;
+  }
+
+  float Simplify(const Mesh& mesh, size_t nTargetTriangles, Mesh& out, float fMaxError) {
+    const size_t nVertices = mesh.VertexCount();
+    const size_t nTriangles = mesh.TriangleCount();
+    std::vector<uint32_t> tris(mesh.indices.begin(), mesh.indices.begin() + nTriangles * 3);
+    std::vector<VecThree> positions(nVertices);
+    for (size_t v = 0; v < nVertices; ++v)
+      positions[v] = mesh.vertices.Get(v);
+
+    std::vector<bool> triangleAlive(nTriangles, true);
+    std::vector<std::vector<uint32_t>> trianglesOf(nVertices);
+    std::vector<Quadric> quadrics(nVertices);
+    std::unordered_map<uint64_t, uint32_t> edgeCount; // undirected, to find open borders
+    size_t nAlive = 0;
+    auto edgeKey = [](uint32_t a, uint32_t b) {
+      return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+    };
+    auto normalOf = [&](const uint32_t* tri) {
+      return Cross(Sub(positions[tri[1]], positions[tri[0]]),
+                   Sub(positions[tri[2]], positions[tri[0]]));
+    };
+
+    for (uint32_t t = 0; t < (uint32_t)nTriangles; ++t) {
+      const uint32_t* tri = &tris[t * 3];
+      if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+        triangleAlive[t] = false;
+        continue;
+      }
+      ++nAlive;
+      for (int k = 0; k < 3; ++k) {
+        trianglesOf[tri[k]].push_back(t);
+        ++edgeCount[edgeKey(tri[k], tri[(k + 1) % 3])];
+      }
+      VecThree n = normalOf(tri);
+      double length = std::sqrt(Dot(n, n));
+      if (length == 0.0)
+        continue;
+      double a = n.x / length, b = n.y / length, c = n.z / length;
+      double d = -(a * positions[tri[0]].x + b * positions[tri[0]].y + c * positions[tri[0]].z);
+      Quadric plane = Quadric::FromPlane(a, b, c, d, 1.0);
+      for (int k = 0; k < 3; ++k)
+        quadrics[tri[k]].Add(plane);
+    }
+
+    // A border edge gets the plane through it perpendicular to its triangle.
+    for (uint32_t t = 0; t < (uint32_t)nTriangles; ++t) {
+      if (!triangleAlive[t])
+        continue;
+      const uint32_t* tri = &tris[t * 3];
+      VecThree n = normalOf(tri);
+      for (int k = 0; k < 3; ++k) {
+        uint32_t v0 = tri[k], v1 = tri[(k + 1) % 3];
+        if (edgeCount[edgeKey(v0, v1)] != 1)
+          continue;
+        VecThree m = Cross(Sub(positions[v1], positions[v0]), n);
+        double length = std::sqrt(Dot(m, m));
+        if (length == 0.0)
+          continue;
+        double a = m.x / length, b = m.y / length, c = m.z / length;
+        double d = -(a * positions[v0].x + b * positions[v0].y + c * positions[v0].z);
+        Quadric plane = Quadric::FromPlane(a, b, c, d, BORDER_WEIGHT);
+        quadrics[v0].Add(plane);
+        quadrics[v1].Add(plane);
+      }
+    }
+
+    // Candidate collapses in a heap, invalidated lazily through per-vertex versions: a
+    // collapse changes the quadric of the vertex it lands on and so the cost of every
+    // edge there.
+    std::vector<bool> vertexAlive(nVertices, true);
+    std::vector<uint32_t> versions(nVertices, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+    auto pushEdge = [&](uint32_t a, uint32_t b) {
+      Quadric q = quadrics[a];
+      q.Add(quadrics[b]);
+      double toB = q.Error(positions[b]), toA = q.Error(positions[a]);
+      if (toB <= toA)
+        heap.push({toB, a, b, versions[a], versions[b]});
+      else
+        heap.push({toA, b, a, versions[b], versions[a]});
+    };
+    for (uint32_t t = 0; t < (uint32_t)nTriangles; ++t) {
+      if (!triangleAlive[t])
+        continue;
+      for (int k = 0; k < 3; ++k) {
+        uint32_t a = tris[t * 3 + k], b = tris[t * 3 + (k + 1) % 3];
+        if (a < b || edgeCount[edgeKey(a, b)] == 1)
+          pushEdge(a, b);
+      }
+    }
+
+    // Moving from to to must not turn any remaining triangle of from over (or flat).
+    auto keepsOrientation = [&](uint32_t from, uint32_t to) {
+      for (uint32_t t : trianglesOf[from]) {
+        const uint32_t* tri = &tris[t * 3];
+        if (!triangleAlive[t] || tri[0] == to || tri[1] == to || tri[2] == to)
+          continue;
+        uint32_t moved[3] = {tri[0], tri[1], tri[2]};
+        for (uint32_t& v : moved)
+          v = v == from ? to : v;
+        VecThree before = normalOf(tri), after = normalOf(moved);
+        if (Dot(before, after) <= 0.1 * std::sqrt(Dot(before, before) * Dot(after, after)))
+          return false;
+      }
+      return true;
+    };
+
+    const double maxCost = (double)fMaxError * fMaxError;
+    double worstCost = 0.0;
+    while (nAlive > nTargetTriangles && !heap.empty()) {
+      Collapse c = heap.top();
+      heap.pop();
+      if (!vertexAlive[c.from] || !vertexAlive[c.to])
+        continue;
+      if (c.fromVersion != versions[c.from] || c.toVersion != versions[c.to]) {
+        // Stale; requeue at the current cost if the vertices are still joined by an edge.
+        for (uint32_t t : trianglesOf[c.from]) {
+          const uint32_t* tri = &tris[t * 3];
+          if (triangleAlive[t] && (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)) {
+            pushEdge(c.from, c.to);
+            break;
+          }
+        }
+        continue;
+      }
+      if (c.cost > maxCost)
+        break;
+      if (!keepsOrientation(c.from, c.to))
+        continue;
+
+      for (uint32_t t : trianglesOf[c.from]) {
+        if (!triangleAlive[t])
+          continue;
+        uint32_t* tri = &tris[t * 3];
+        if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+          triangleAlive[t] = false;
+          --nAlive;
+          continue;
+        }
+        for (int k = 0; k < 3; ++k)
+          tri[k] = tri[k] == c.from ? c.to : tri[k];
+        trianglesOf[c.to].push_back(t);
+      }
+      trianglesOf[c.from].clear();
+      vertexAlive[c.from] = false;
+      quadrics[c.to].Add(quadrics[c.from]);
+      ++versions[c.to];
+      worstCost = std::max(worstCost, c.cost);
+
+      for (uint32_t t : trianglesOf[c.to]) {
+        if (!triangleAlive[t])
+          continue;
+        for (int k = 0; k < 3; ++k) {
+          uint32_t v = tris[t * 3 + k];
+          if (v != c.to)
+            pushEdge(c.to, v);
+        }
+      }
+    }
+
+    out.Clear();
+    std::vector<uint32_t> remap(nVertices, NONE);
+    for (uint32_t t = 0; t < (uint32_t)nTriangles; ++t) {
+      if (!triangleAlive[t])
+        continue;
+      uint32_t tri[3];
+      for (int k = 0; k < 3; ++k) {
+        uint32_t& index = remap[tris[t * 3 + k]];
+        if (index == NONE)
+          index = out.AddVertex(positions[tris[t * 3 + k]]);
+        tri[k] = index;
+      }
+      out.AddTriangle(tri[0], tri[1], tri[2]);
+    }
+    Optimize(out);
+    return (float)std::sqrt(worstCost);
+  }
+} // namespace meshopt
@@ -0,0 +1,283 @@
+#include "objloader.h"
+
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <functional>
+#include <thread>
+
+namespace objloader {
+  namespace {
+    // Inputs below this size per thread are not worth splitting.
+    const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    // Marks an absent vt/vn while chunk-local indices may still be negative.
+    const int32_t MISSING = INT32_MIN;
+
+    // Corner as parsed inside one chunk. Relative (negative) references are resolved
+    // against the chunk's own element counts and listed in ChunkResult::fixups, because
+    // the number of elements defined by earlier chunks is only known after all of them
+    // have been parsed.
+    struct RawCorner {
+      int32_t ref[3]; // v, vt, vn
+    };
+
+    struct ChunkResult {
+      std::vector<VecThree> positions;
+      std::vector<TexCoord> texcoords;
+      std::vector<VecThree> normals;
+      std::vector<RawCorner> corners;
+      std::vector<uint32_t> fixups; // corner * 3 + component
+      bool bOk = true;
+    };
+
+    inline bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    inline void SkipBlanks(const char*& p, const char* end) {
+      while (p < end && IsBlank(*p))
+        ++p;
+    }
+
+    inline void SkipLine(const char*& p, const char* end) {
+      while (p < end && *p != '\n')
+        ++p;
+    }
+
+    bool ParseFloat(const char*& p, const char* end, float& value) {
+      SkipBlanks(p, end);
+      if (p < end && *p == '+')
+        ++p;
+      auto result = std::from_chars(p, end, value);
+      if (result.ec != std::errc())
+        return false;
+      p = result.ptr;
+      return true;
+    }
+
+    bool ParseInt(const char*& p, const char* end, int32_t& value) {
+      bool bNegative = false;
+      if (p < end && (*p == '-' || *p == '+'))
+        bNegative = *p++ == '-';
+      if (p >= end || *p < '0' || *p > '9')
+        return false;
+      int64_t v = 0;
+      while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p++ - '0');
+        if (v > INT32_MAX)
+          return false;
+      }
+      value = (int32_t)(bNegative ? -v : v);
+      return true;
+    }
+
+    // Parses the remaining optional floats of a vt record (u [v [w]]).
+    bool ParseTexCoord(const char*& p, const char* end, TexCoord& tc) {
+      if (!ParseFloat(p, end, tc.u))
+        return false;
+      float* rest[2] = {&tc.v, &tc.w};
+      for (float* value : rest) {
+        SkipBlanks(p, end);
+        if (p >= end || *p == '\n')
+          break;
+        if (!ParseFloat(p, end, *value))
+          return false;
+      }
+      return true;
+    }
+
+    bool ParseFace(const char*& p, const char* end, ChunkResult& chunk) {
+      const int32_t counts[3] = {(int32_t)chunk.positions.size(), (int32_t)chunk.texcoords.size(),
+                                 (int32_t)chunk.normals.size()};
+
+      // Corner plus a bit per component that holds a chunk-relative reference.
+      struct FaceCorner {
+        RawCorner corner;
+        uint8_t relative;
+      };
+      auto emit = [&chunk](const FaceCorner& fc) {
+        uint32_t index = (uint32_t)chunk.corners.size();
+        chunk.corners.push_back(fc.corner);
+        for (int k = 0; k < 3; ++k) {
+          if (fc.relative & (1 << k))
+            chunk.fixups.push_back(index * 3 + k);
+        }
+      };
+
+      FaceCorner first{};
+      FaceCorner prev{};
+      int nCorners = 0;
+      while (true) {
+        SkipBlanks(p, end);
+        if (p >= end || *p == '\n' || *p == '#')
+          break;
+
+        FaceCorner fc = {{{MISSING, MISSING, MISSING}}, 0};
+        for (int k = 0; k < 3; ++k) {
+          if (k > 0) {
+            if (p >= end || *p != '/')
+              break;
+            ++p;
+            // "v//vn" leaves vt empty
+            if (k == 1 && p < end && *p == '/')
+              continue;
+          }
+          int32_t index;
+          if (!ParseInt(p, end, index) || index == 0)
+            return false;
+          if (index > 0) {
+            fc.corner.ref[k] = index - 1;
+          } else {
+            fc.corner.ref[k] = counts[k] + index;
+            fc.relative |= 1 << k;
+          }
+        }
+
+        // Fan triangulation: (first, prev, current) for every corner after the second.
+        if (nCorners == 0) {
+          first = fc;
+        } else if (nCorners >= 2) {
+          emit(first);
+          emit(prev);
+          emit(fc);
+        }
+        prev = fc;
+        ++nCorners;
+      }
+      return nCorners >= 3;
+    }
+
+    void ParseChunk(const char* p, const char* end, ChunkResult& chunk) {
+      while (p < end) {
+        SkipBlanks(p, end);
+        if (p >= end)
+          break;
+
+        bool bOk = true;
+        if (p[0] == 'v' && p + 1 < end) {
+          if (IsBlank(p[1])) {
+            VecThree v;
+            p += 1;
+            bOk = ParseFloat(p, end, v.x) && ParseFloat(p, end, v.y) && ParseFloat(p, end, v.z);
+            chunk.positions.push_back(v);
+          } else if (p[1] == 't' && p + 2 < end && IsBlank(p[2])) {
+            TexCoord tc;
+            p += 2;
+            bOk = ParseTexCoord(p, end, tc);
+            chunk.texcoords.push_back(tc);
+          } else if (p[1] == 'n' && p + 2 < end && IsBlank(p[2])) {
+            VecThree n;
+            p += 2;
+            bOk = ParseFloat(p, end, n.x) && ParseFloat(p, end, n.y) && ParseFloat(p, end, n.z);
+            chunk.normals.push_back(n);
+          }
+        } else if (p[0] == 'f' && p + 1 < end && IsBlank(p[1])) {
+          p += 1;
+          bOk = ParseFace(p, end, chunk);
+        }
+
+        if (!bOk) {
+          chunk.bOk = false;
+          return;
+        }
+        SkipLine(p, end);
+        if (p < end)
+          ++p;
+      }
+    }
+  } // namespace
+
+  bool Parse(const char* data, size_t size, ObjData& out, int nThreads) {
+    out = ObjData();
+
+    if (nThreads <= 0)
+      nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    size_t nChunks = std::max<size_t>(1, std::min<size_t>(nThreads, size / MIN_CHUNK_SIZE));
+
+    // Split at line boundaries.
+    std::vector<const char*> bounds(nChunks + 1);
+    bounds[0] = data;
+    bounds[nChunks] = data + size;
+    for (size_t i = 1; i < nChunks; ++i) {
+      const char* p = std::max(bounds[i - 1], data + size * i / nChunks);
+      const char* end = data + size;
+      while (p < end && *p != '\n')
+        ++p;
+      bounds[i] = p < end ? p + 1 : end;
+    }
+
+    std::vector<ChunkResult> chunks(nChunks);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nChunks; ++i)
+      threads.emplace_back(ParseChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+    ParseChunk(bounds[0], bounds[1], chunks[0]);
+    for (auto& thread : threads)
+      thread.join();
+
+    // Stitch the chunks together, rebasing relative references.
+    size_t nPositions = 0, nTexcoords = 0, nNormals = 0, nCorners = 0;
+    for (const ChunkResult& chunk : chunks) {
+      if (!chunk.bOk)
+        return false;
+      nPositions += chunk.positions.size();
+      nTexcoords += chunk.texcoords.size();
+      nNormals += chunk.normals.size();
+      nCorners += chunk.corners.size();
+    }
+    if (nPositions > INT32_MAX || nTexcoords > INT32_MAX || nNormals > INT32_MAX)
+      return false;
+
+    out.corners.reserve(nCorners);
+
+    const int64_t limits[3] = {(int64_t)nPositions, (int64_t)nTexcoords, (int64_t)nNormals};
+    for (ChunkResult& chunk : chunks) {
+      const int64_t bases[3] = {(int64_t)out.positions.size(), (int64_t)out.texcoords.size(),
+                                (int64_t)out.normals.size()};
+      for (uint32_t fixup : chunk.fixups) {
+        int32_t& ref = chunk.corners[fixup / 3].ref[fixup % 3];
+        ref = (int32_t)(ref + bases[fixup % 3]);
+      }
+
+      for (const RawCorner& raw : chunk.corners) {
+        Corner corner;
+        uint32_t* refs[3] = {&corner.v, &corner.vt, &corner.vn};
+        for (int k = 0; k < 3; ++k) {
+          if (raw.ref[k] == MISSING) {
+            if (k == 0)
+              return false;
+            *refs[k] = NO_INDEX;
+          } else if (raw.ref[k] < 0 || raw.ref[k] >= limits[k]) {
+            return false;
+          } else {
+            *refs[k] = (uint32_t)raw.ref[k];
+          }
+        }
+        out.corners.push_back(corner);
+      }
+
+      if (&chunk == &chunks[0]) {
+        // The first chunk needs no rebasing; adopt its storage instead of copying it.
+        out.positions = std::move(chunk.positions);
+        out.texcoords = std::move(chunk.texcoords);
+        out.normals = std::move(chunk.normals);
+        out.positions.reserve(nPositions);
+        out.texcoords.reserve(nTexcoords);
+        out.normals.reserve(nNormals);
+      } else {
+        out.positions.insert(out.positions.end(), chunk.positions.begin(), chunk.positions.end());
+        out.texcoords.insert(out.texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+        out.normals.insert(out.normals.end(), chunk.normals.begin(), chunk.normals.end());
+      }
+      chunk = ChunkResult();
+    }
+    return true;
+  }
+
+  bool LoadFile(const std::string& sFilename, ObjData& out, int nThreads) {
+    MappedFile file;
+    if (!file.Open(sFilename))
+      return false;
+    return Parse(file.Data(), file.Size(), out, nThreads);
+  }
+} // namespace objloader
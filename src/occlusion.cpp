@@ -0,0 +1,218 @@
+#include "occlusion.h"
+
+#include "jobs.h"
+#include "mathematics.h"
+#include "profiler.h"
+#include "rasterizer.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  // Rows per Rasterize() job: enough for each band to amortize its pass over the triangles.
+  const int BAND_ROWS = 16;
+} // namespace
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) { Resize(width, height); }
+
+void OcclusionBuffer::Resize(int width, int height) {
+  m_nWidth = width;
+  m_nHeight = height;
+  m_vDepth.assign((size_t)width * height, Rasterizer::DEPTH_FAR);
+  m_clipper.SetViewport(width, height);
+}
+
+void OcclusionBuffer::Begin(const Mat4& viewProjection) {
+  m_viewProjection = viewProjection;
+  std::fill(m_vDepth.begin(), m_vDepth.end(), Rasterizer::DEPTH_FAR);
+  m_vTriangles.clear();
+}
+
+void OcclusionBuffer::AddOccluder(const MeshView& mesh, const Mat4& world) {
+  const Mat4 transform = Mat4::Multiply(world, m_viewProjection);
+  m_vClip.Resize(mesh.nVertices);
+  mathematics::TransformBatch(mesh.x, mesh.y, mesh.z, m_vClip.x.data(), m_vClip.y.data(),
+                              m_vClip.z.data(), m_vClip.w.data(), mesh.nVertices, transform);
+  m_clipper.Process(m_vClip, mesh.indices, mesh.nTriangles, m_vProjected);
+
+  const float* x = m_vProjected.x.data();
+  const float* y = m_vProjected.y.data();
+  const float* z = m_vProjected.z.data();
+  for (size_t i = 0; i + 2 < m_vProjected.Size(); i += 3)
+    Setup(x[i], y[i], z[i], x[i + 1], y[i + 1], z[i + 1], x[i + 2], y[i + 2], z[i + 2]);
+  ++m_stats.occluders;
+}
+
+void OcclusionBuffer::Setup(float x0, float y0, float z0, float x1, float y1, float z1, float x2,
+                            float y2, float z2) {
+  float area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+  if (area == 0.0f || !std::isfinite(area))
+    return;
+
+  // Pixels whose centers the triangle covers
+  SetupTriangle tri;
+  tri.minX = std::max(0, (int)std::ceil(std::min({x0, x1, x2}) - 0.5f));
+  tri.minY = std::max(0, (int)std::ceil(std::min({y0, y1, y2}) - 0.5f));
+  tri.maxX = std::min(m_nWidth - 1, (int)std::floor(std::max({x0, x1, x2}) - 0.5f));
+  tri.maxY = std::min(m_nHeight - 1, (int)std::floor(std::max({y0, y1, y2}) - 0.5f));
+  if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+    return;
+
+  // Edge i runs from vertex i to the next; the sign flip makes the inside non-negative for
+  // either winding.
+  const float vx[3] = {x0, x1, x2}, vy[3] = {y0, y1, y2};
+  const float sign = area > 0.0f ? 1.0f : -1.0f;
+  for (int i = 0; i < 3; ++i) {
+    int j = (i + 1) % 3;
+    tri.a[i] = sign * (vy[i] - vy[j]);
+    tri.b[i] = sign * (vx[j] - vx[i]);
+    tri.c[i] = -(tri.a[i] * vx[i] + tri.b[i] * vy[i]);
+  }
+
+  // The plane's largest value over a pixel lies half a pixel from its center along each
+  // axis, uphill.
+  tri.dzdx = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) / area;
+  tri.dzdy = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) / area;
+  tri.z0 = z0 - tri.dzdx * x0 - tri.dzdy * y0 + 0.5f * (std::abs(tri.dzdx) + std::abs(tri.dzdy));
+  m_vTriangles.push_back(tri);
+  ++m_stats.occluderTriangles;
+}
+
+void OcclusionBuffer::Rasterize() {
+  if (m_vTriangles.empty())
+    return;
+  ENGINE_PROFILE_ZONE("OcclusionRaster");
+  // Bands own disjoint rows, so they write without locks.
+  if (m_pJobs)
+    m_pJobs->ParallelFor(
+      0, m_nHeight, [this](size_t first, size_t end) { RasterizeRows((int)first, (int)end); },
+      BAND_ROWS);
+  else
+    RasterizeRows(0, m_nHeight);
+}
+
+void OcclusionBuffer::RasterizeRows(int y0, int y1) {
+  for (const SetupTriangle& tri : m_vTriangles) {
+    const int rowBegin = std::max(y0, tri.minY);
+    const int rowEnd = std::min(y1, tri.maxY + 1);
+    for (int y = rowBegin; y < rowEnd; ++y) {
+      // Values at the center of pixel (minX, y)
+      const float cx = (float)tri.minX + 0.5f, cy = (float)y + 0.5f;
+      float e0 = tri.a[0] * cx + tri.b[0] * cy + tri.c[0];
+      float e1 = tri.a[1] * cx + tri.b[1] * cy + tri.c[1];
+      float e2 = tri.a[2] * cx + tri.b[2] * cy + tri.c[2];
+      float z = tri.z0 + tri.dzdx * cx + tri.dzdy * cy;
+      float* row = &m_vDepth[(size_t)y * m_nWidth];
+      int x = tri.minX;
+
+#if defined(ENGINE_SIMD_SSE)
+      // Four pixels per step. Pixels past maxX fail an edge test, so a group may run over
+      // it as long as it stays within the row.
+      const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+      const __m128 zero = _mm_setzero_ps();
+      __m128 ve0 = _mm_add_ps(_mm_set1_ps(e0), _mm_mul_ps(_mm_set1_ps(tri.a[0]), lane));
+      __m128 ve1 = _mm_add_ps(_mm_set1_ps(e1), _mm_mul_ps(_mm_set1_ps(tri.a[1]), lane));
+      __m128 ve2 = _mm_add_ps(_mm_set1_ps(e2), _mm_mul_ps(_mm_set1_ps(tri.a[2]), lane));
+      __m128 vz = _mm_add_ps(_mm_set1_ps(z), _mm_mul_ps(_mm_set1_ps(tri.dzdx), lane));
+      const __m128 step0 = _mm_set1_ps(4.0f * tri.a[0]);
+      const __m128 step1 = _mm_set1_ps(4.0f * tri.a[1]);
+      const __m128 step2 = _mm_set1_ps(4.0f * tri.a[2]);
+      const __m128 stepZ = _mm_set1_ps(4.0f * tri.dzdx);
+      for (; x <= tri.maxX && x + 4 <= m_nWidth; x += 4) {
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(ve0, zero), _mm_cmpge_ps(ve1, zero)),
+                                   _mm_cmpge_ps(ve2, zero));
+        if (_mm_movemask_ps(inside)) {
+          __m128 depth = _mm_loadu_ps(row + x);
+          __m128 nearer = _mm_min_ps(depth, vz);
+          // depth where outside, the nearer one where inside
+          _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer),
+                                           _mm_andnot_ps(inside, depth)));
+        }
+        ve0 = _mm_add_ps(ve0, step0);
+        ve1 = _mm_add_ps(ve1, step1);
+        ve2 = _mm_add_ps(ve2, step2);
+        vz = _mm_add_ps(vz, stepZ);
+      }
+      const float dx = (float)(x - tri.minX);
+      e0 += tri.a[0] * dx;
+      e1 += tri.a[1] * dx;
+      e2 += tri.a[2] * dx;
+      z += tri.dzdx * dx;
+#endif
+
+      for (; x <= tri.maxX; ++x) {
+        if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+          row[x] = std::min(row[x], z);
+        e0 += tri.a[0];
+        e1 += tri.a[1];
+        e2 += tri.a[2];
+        z += tri.dzdx;
+      }
+    }
+  }
+}
+
+bool OcclusionBuffer::IsOccluded(const Aabb& worldBox) {
+  ++m_stats.occludeesTested;
+  auto reportVisible = [this] {
+    ++m_stats.occludeesVisible;
+    return false;
+  };
+
+  // Screen rectangle and nearest depth of the corners. A projection keeps the box convex,
+  // so its extremes, and those of the depth, lie at corners.
+  const Mat4& m = m_viewProjection;
+  const float fHalfWidth = 0.5f * (float)m_nWidth;
+  const float fHalfHeight = 0.5f * (float)m_nHeight;
+  float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1e30f;
+  for (int corner = 0; corner < 8; ++corner) {
+    float x = (corner & 1) ? worldBox.max.x : worldBox.min.x;
+    float y = (corner & 2) ? worldBox.max.y : worldBox.min.y;
+    float z = (corner & 4) ? worldBox.max.z : worldBox.min.z;
+    float cx = x * m.m[0][0] + y * m.m[1][0] + z * m.m[2][0] + m.m[3][0];
+    float cy = x * m.m[0][1] + y * m.m[1][1] + z * m.m[2][1] + m.m[3][1];
+    float cz = x * m.m[0][2] + y * m.m[1][2] + z * m.m[2][2] + m.m[3][2];
+    float cw = x * m.m[0][3] + y * m.m[1][3] + z * m.m[2][3] + m.m[3][3];
+    if (cz < 0.0f || cw <= 0.0f)
+      return reportVisible();
+    float invW = 1.0f / cw;
+    float sx = (cx * invW + 1.0f) * fHalfWidth;
+    float sy = (cy * invW + 1.0f) * fHalfHeight;
+    minX = std::min(minX, sx);
+    maxX = std::max(maxX, sx);
+    minY = std::min(minY, sy);
+    maxY = std::max(maxY, sy);
+    minZ = std::min(minZ, cz * invW);
+  }
+
+  // Pixels the rectangle touches, plus a ring of one so that partially covered pixels at
+  // occluder edges always sit next to an uncovered one. Corners close to the eye can
+  // project arbitrarily far, so the rectangle is clamped before the conversion.
+  auto clampX = [this](float v) { return std::min(std::max(v, -2.0f), (float)m_nWidth + 2.0f); };
+  auto clampY = [this](float v) { return std::min(std::max(v, -2.0f), (float)m_nHeight + 2.0f); };
+  const int x0 = std::max(0, (int)std::floor(clampX(minX)) - 1);
+  const int y0 = std::max(0, (int)std::floor(clampY(minY)) - 1);
+  const int x1 = std::min(m_nWidth - 1, (int)std::floor(clampX(maxX)) + 1);
+  const int y1 = std::min(m_nHeight - 1, (int)std::floor(clampY(maxY)) + 1);
+  if (x0 > x1 || y0 > y1)
+    return reportVisible();
+
+  for (int y = y0; y <= y1; ++y) {
+    const float* row = &m_vDepth[(size_t)y * m_nWidth];
+    int x = x0;
+#if defined(ENGINE_SIMD_SSE)
+    const __m128 vMinZ = _mm_set1_ps(minZ);
+    for (; x + 4 <= x1 + 1; x += 4) {
+      if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), vMinZ)))
+        return reportVisible();
+    }
+#endif
+    for (; x <= x1; ++x) {
+      if (row[x] >= minZ)
+        return reportVisible();
+    }
+  }
+  ++m_stats.occludeesOccluded;
+  return true;
+}
@@ -0,0 +1,342 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace profiler {
+  namespace {
+    struct Event {
+      const char* sName;
+      int64_t startTicks;
+      int64_t endTicks;
+    };
+
+    // Single-producer/single-consumer ring: the owning thread pushes, EndFrame() pops.
+    struct ThreadBuffer {
+      static const size_t CAPACITY = 1 << 14;
+
+      Event events[CAPACITY];
+      std::atomic<uint64_t> head{0}; // next slot to write, owned by the producer
+      std::atomic<uint64_t> tail{0}; // next slot to read, owned by the consumer
+      std::atomic<uint64_t> dropped{0};
+      int tid = 0;
+      std::string sName;
+    };
+
+    struct CaptureEvent {
+      const char* sName;
+      double startNs;
+      double endNs;
+      int tid;
+    };
+
+    struct ZoneRecord {
+      const char* sName; // the first address seen; names outlive the profiler
+      double history[HISTORY_FRAMES] = {};
+      int nHistory = 0;
+      int nNext = 0;
+      int64_t lastSeenFrame = -1;
+      double frameNs = 0.0;
+      uint32_t nFrameCalls = 0;
+      double lastMs = 0.0;
+      uint32_t nLastCalls = 0;
+    };
+
+    // Zone name address and its record in g_zones
+    struct ZonePointer {
+      const char* sName = nullptr;
+      size_t nZone = 0;
+    };
+
+    // Buffers live until exit, so a thread that has finished can still be drained.
+    std::mutex g_buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+    std::vector<std::unique_ptr<ThreadBuffer>> g_spareBuffers; // made ahead by Reserve()
+
+    // Consumer-side state, touched only by EndFrame() and the accessors.
+    std::mutex g_statsMutex;
+    std::vector<ZoneRecord> g_zones;
+    // Open-addressed by name address, a power of two in size and at most half full, so
+    // events are matched without hashing the text and new names need no node allocations.
+    std::vector<ZonePointer> g_zoneByPointer;
+    size_t g_nZonePointers = 0;
+    std::vector<ThreadBuffer*> g_drainList; // reused by EndFrame() so it does not allocate
+    int64_t g_nFrame = 0;
+    bool g_bCapturing = false;
+    std::vector<CaptureEvent> g_capture;
+    uint64_t g_nCaptureDropped = 0;
+
+    thread_local ThreadBuffer* t_pBuffer = nullptr;
+
+    // Maps ticks to nanoseconds since the profiler's epoch. The rate starts from a short
+    // measurement and is refined from the whole elapsed span on every EndFrame().
+    struct Calibration {
+      using Clock = std::chrono::steady_clock;
+
+      int64_t ticks0;
+      Clock::time_point time0;
+      double nsPerTick = 1.0;
+
+      Calibration() : ticks0(Ticks()), time0(Clock::now()) {
+#if defined(ENGINE_PROFILE_TSC)
+        while (Clock::now() - time0 < std::chrono::microseconds(200)) {
+        }
+        Refine();
+#endif
+      }
+
+      void Refine() {
+#if defined(ENGINE_PROFILE_TSC)
+        int64_t ticks = Ticks() - ticks0;
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - time0).count();
+        if (ticks > 0)
+          nsPerTick = ns / (double)ticks;
+#endif
+      }
+
+      double ToNs(int64_t ticks) const { return (double)(ticks - ticks0) * nsPerTick; }
+    };
+
+    Calibration& GetCalibration() {
+      static Calibration calibration;
+      return calibration;
+    }
+
+    ThreadBuffer& GetThreadBuffer() {
+      if (!t_pBuffer) {
+        // Establish the time base before this thread's first event.
+        GetCalibration();
+        std::lock_guard<std::mutex> lock(g_buffersMutex);
+        if (g_spareBuffers.empty()) {
+          g_buffers.emplace_back(new ThreadBuffer());
+        } else {
+          g_buffers.push_back(std::move(g_spareBuffers.back()));
+          g_spareBuffers.pop_back();
+        }
+        t_pBuffer = g_buffers.back().get();
+        t_pBuffer->tid = (int)g_buffers.size();
+      }
+      return *t_pBuffer;
+    }
+
+    size_t PointerSlot(const char* sName, size_t nMask) {
+      return (size_t)((uint64_t)reinterpret_cast<uintptr_t>(sName) * 0x9E3779B97F4A7C15ull >> 32) &
+             nMask;
+    }
+
+    // Sizes the pointer table for nZones names, keeping its entries.
+    void ReservePointers(size_t nZones) {
+      size_t nSize = 16;
+      while (nSize < 2 * nZones)
+        nSize *= 2;
+      if (nSize <= g_zoneByPointer.size())
+        return;
+      std::vector<ZonePointer> old(nSize);
+      old.swap(g_zoneByPointer);
+      for (const ZonePointer& entry : old) {
+        if (!entry.sName)
+          continue;
+        size_t slot = PointerSlot(entry.sName, nSize - 1);
+        while (g_zoneByPointer[slot].sName)
+          slot = (slot + 1) & (nSize - 1);
+        g_zoneByPointer[slot] = entry;
+      }
+    }
+
+    // Record of the zone named sName, created on first sight. The same name may live at
+    // several addresses, one per translation unit; each maps to one record.
+    ZoneRecord& FindZone(const char* sName) {
+      if (g_zoneByPointer.empty())
+        ReservePointers(1);
+      size_t nMask = g_zoneByPointer.size() - 1;
+      size_t slot = PointerSlot(sName, nMask);
+      for (; g_zoneByPointer[slot].sName; slot = (slot + 1) & nMask) {
+        if (g_zoneByPointer[slot].sName == sName)
+          return g_zones[g_zoneByPointer[slot].nZone];
+      }
+
+      size_t nZone = 0;
+      while (nZone < g_zones.size() && std::strcmp(g_zones[nZone].sName, sName) != 0)
+        ++nZone;
+      if (nZone == g_zones.size()) {
+        g_zones.emplace_back();
+        g_zones.back().sName = sName;
+      }
+      if (2 * (g_nZonePointers + 1) > g_zoneByPointer.size()) {
+        ReservePointers(g_nZonePointers + 1);
+        nMask = g_zoneByPointer.size() - 1;
+        slot = PointerSlot(sName, nMask);
+        while (g_zoneByPointer[slot].sName)
+          slot = (slot + 1) & nMask;
+      }
+      g_zoneByPointer[slot] = {sName, nZone};
+      ++g_nZonePointers;
+      return g_zones[nZone];
+    }
+  } // namespace
+
+  void Record(const char* sName, int64_t startTicks, int64_t endTicks) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= ThreadBuffer::CAPACITY) {
+      buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    buffer.events[head & (ThreadBuffer::CAPACITY - 1)] = {sName, startTicks, endTicks};
+    buffer.head.store(head + 1, std::memory_order_release);
+  }
+
+  void SetThreadName(const char* sName) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(g_buffersMutex);
+    buffer.sName = sName;
+  }
+
+  void Reserve(int nThreads, size_t nZones) {
+    GetCalibration();
+    {
+      std::lock_guard<std::mutex> lock(g_buffersMutex);
+      while (g_buffers.size() + g_spareBuffers.size() < (size_t)nThreads)
+        g_spareBuffers.emplace_back(new ThreadBuffer());
+      g_buffers.reserve((size_t)nThreads);
+    }
+    std::lock_guard<std::mutex> lock(g_statsMutex);
+    g_zones.reserve(nZones);
+    g_drainList.reserve((size_t)nThreads);
+    ReservePointers(nZones);
+  }
+
+  void EndFrame() {
+    std::lock_guard<std::mutex> statsLock(g_statsMutex);
+    Calibration& calibration = GetCalibration();
+    calibration.Refine();
+
+    std::vector<ThreadBuffer*>& buffers = g_drainList;
+    {
+      std::lock_guard<std::mutex> lock(g_buffersMutex);
+      buffers.clear();
+      for (auto& buffer : g_buffers)
+        buffers.push_back(buffer.get());
+    }
+
+    for (ThreadBuffer* buffer : buffers) {
+      uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+      uint64_t head = buffer->head.load(std::memory_order_acquire);
+      for (; tail != head; ++tail) {
+        const Event& e = buffer->events[tail & (ThreadBuffer::CAPACITY - 1)];
+        ZoneRecord& zone = FindZone(e.sName);
+        if (zone.lastSeenFrame != g_nFrame) {
+          zone.lastSeenFrame = g_nFrame;
+          zone.frameNs = 0.0;
+          zone.nFrameCalls = 0;
+        }
+        zone.frameNs += (double)(e.endTicks - e.startTicks) * calibration.nsPerTick;
+        ++zone.nFrameCalls;
+
+        if (g_bCapturing) {
+          if (g_capture.size() < MAX_CAPTURE_EVENTS)
+            g_capture.push_back({e.sName, calibration.ToNs(e.startTicks),
+                                 calibration.ToNs(e.endTicks), buffer->tid});
+          else
+            ++g_nCaptureDropped;
+        }
+      }
+      buffer->tail.store(head, std::memory_order_release);
+    }
+
+    for (ZoneRecord& zone : g_zones) {
+      if (zone.lastSeenFrame != g_nFrame)
+        continue;
+      zone.lastMs = zone.frameNs * 1e-6;
+      zone.nLastCalls = zone.nFrameCalls;
+      zone.history[zone.nNext] = zone.lastMs;
+      zone.nNext = (zone.nNext + 1) % HISTORY_FRAMES;
+      zone.nHistory = std::min(zone.nHistory + 1, HISTORY_FRAMES);
+    }
+    ++g_nFrame;
+  }
+
+  std::vector<ZoneStats> GetZoneStats() {
+    std::lock_guard<std::mutex> lock(g_statsMutex);
+    std::vector<ZoneStats> stats;
+    for (const ZoneRecord& zone : g_zones) {
+      if (zone.nHistory == 0 || g_nFrame - zone.lastSeenFrame > HISTORY_FRAMES)
+        continue;
+      ZoneStats s;
+      s.sName = zone.sName;
+      s.lastMs = zone.lastMs;
+      s.nCalls = zone.nLastCalls;
+      double sorted[HISTORY_FRAMES];
+      std::copy(zone.history, zone.history + zone.nHistory, sorted);
+      std::sort(sorted, sorted + zone.nHistory);
+      for (int i = 0; i < zone.nHistory; ++i)
+        s.avgMs += sorted[i];
+      s.avgMs /= zone.nHistory;
+      s.p99Ms = sorted[std::min(zone.nHistory - 1, (int)(0.99 * zone.nHistory))];
+      stats.push_back(s);
+    }
+    return stats;
+  }
+
+  void StartCapture() {
+    std::lock_guard<std::mutex> lock(g_statsMutex);
+    g_capture.clear();
+    g_nCaptureDropped = 0;
+    g_bCapturing = true;
+  }
+
+  void StopCapture() {
+    std::lock_guard<std::mutex> lock(g_statsMutex);
+    g_bCapturing = false;
+  }
+
+  bool WriteChromeTrace(const std::string& sFilename) {
+    FILE* file = std::fopen(sFilename.c_str(), "w");
+    if (!file)
+      return false;
+
+    std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    const char* sSeparator = "\n";
+    {
+      std::lock_guard<std::mutex> lock(g_buffersMutex);
+      for (const auto& buffer : g_buffers) {
+        std::string sName = buffer->sName.empty() ? "Thread " + std::to_string(buffer->tid)
+                                                  : buffer->sName;
+        std::fprintf(file,
+                     "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                     "\"args\": {\"name\": \"%s\"}}",
+                     sSeparator, buffer->tid, sName.c_str());
+        sSeparator = ",\n";
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(g_statsMutex);
+    for (const CaptureEvent& e : g_capture) {
+      // Complete ("X") events with microsecond timestamps.
+      std::fprintf(file,
+                   "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                   "\"ts\": %.3f, \"dur\": %.3f}",
+                   sSeparator, e.sName, e.tid, e.startNs * 1e-3,
+                   (e.endNs - e.startNs) * 1e-3);
+      sSeparator = ",\n";
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+  }
+
+  uint64_t GetDroppedEvents() {
+    uint64_t dropped = 0;
+    {
+      std::lock_guard<std::mutex> lock(g_buffersMutex);
+      for (const auto& buffer : g_buffers)
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(g_statsMutex);
+    return dropped + g_nCaptureDropped;
+  }
+} // namespace profiler
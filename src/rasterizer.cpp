@@ -0,0 +1,432 @@
+#include "rasterizer.h"
+
+#include "jobs.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+Rasterizer::Rasterizer() {}
+
+Rasterizer::~Rasterizer() {}
+
+void Rasterizer::Resize(int width, int height) {
+  m_nWidth = width;
+  m_nHeight = height;
+  m_nTilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+  m_nTilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+  m_nBlocksX = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  m_nBlocksY = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  m_vTriangles.clear();
+  m_vBins.assign(m_nTilesX * m_nTilesY, {});
+  m_vBlockMinZ.assign(m_nBlocksX * m_nBlocksY, DEPTH_FAR);
+  m_vBlockMaxZ.assign(m_nBlocksX * m_nBlocksY, DEPTH_FAR);
+  m_vTileMaxZ.assign(m_nTilesX * m_nTilesY, DEPTH_FAR);
+  m_vTileMaxDirty.assign(m_nTilesX * m_nTilesY, 0);
+}
+
+void Rasterizer::ClearDepth(float depth) {
+  std::fill(m_vBlockMinZ.begin(), m_vBlockMinZ.end(), depth);
+  std::fill(m_vBlockMaxZ.begin(), m_vBlockMaxZ.end(), depth);
+  std::fill(m_vTileMaxZ.begin(), m_vTileMaxZ.end(), depth);
+  std::fill(m_vTileMaxDirty.begin(), m_vTileMaxDirty.end(), 0);
+}
+
+void Rasterizer::Submit(float x0, float y0, float z0, float x1, float y1, float z1, float x2,
+                        float y2, float z2, Color color) {
+  ++m_stats.trianglesSubmitted;
+
+  // Written so that NaN coordinates fail the test as well.
+  const float fGuard = (float)GUARD_BAND;
+  const float coords[6] = {x0, y0, x1, y1, x2, y2};
+  for (float c : coords) {
+    if (!(c > -fGuard && c < fGuard)) {
+      ++m_stats.trianglesDropped;
+      return;
+    }
+  }
+  float Z[3] = {z0, z1, z2};
+
+  // Snap to the fixed-point sub-pixel grid.
+  int32_t X[3] = {(int32_t)lrintf(x0 * SUBPIXEL_SCALE), (int32_t)lrintf(x1 * SUBPIXEL_SCALE),
+                  (int32_t)lrintf(x2 * SUBPIXEL_SCALE)};
+  int32_t Y[3] = {(int32_t)lrintf(y0 * SUBPIXEL_SCALE), (int32_t)lrintf(y1 * SUBPIXEL_SCALE),
+                  (int32_t)lrintf(y2 * SUBPIXEL_SCALE)};
+
+  int64_t area = (int64_t)(X[1] - X[0]) * (Y[2] - Y[0]) - (int64_t)(Y[1] - Y[0]) * (X[2] - X[0]);
+  if (area == 0) {
+    ++m_stats.trianglesDropped;
+    return;
+  }
+  // Normalize the winding so the interior is always on the positive side of every edge.
+  if (area < 0) {
+    std::swap(X[1], X[2]);
+    std::swap(Y[1], Y[2]);
+    std::swap(Z[1], Z[2]);
+    area = -area;
+  }
+
+  // Pixel bounds: pixel p is sampled at its center, p * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2.
+  const int half = SUBPIXEL_SCALE / 2;
+  SetupTriangle tri;
+  tri.minX = std::max(0, (std::min({X[0], X[1], X[2]}) + half - 1) >> SUBPIXEL_BITS);
+  tri.minY = std::max(0, (std::min({Y[0], Y[1], Y[2]}) + half - 1) >> SUBPIXEL_BITS);
+  tri.maxX = std::min(m_nWidth - 1, (std::max({X[0], X[1], X[2]}) - half) >> SUBPIXEL_BITS);
+  tri.maxY = std::min(m_nHeight - 1, (std::max({Y[0], Y[1], Y[2]}) - half) >> SUBPIXEL_BITS);
+  if (tri.minX > tri.maxX || tri.minY > tri.maxY) {
+    ++m_stats.trianglesDropped;
+    return;
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    int a = i;
+    int b = (i + 1) % 3;
+    Edge& e = tri.edges[i];
+    e.A = Y[a] - Y[b];
+    e.B = X[b] - X[a];
+    e.C = -((int64_t)e.A * X[a] + (int64_t)e.B * Y[a]);
+    // Top-left rule: samples exactly on an edge belong to the triangle only if the edge is
+    // a left edge (inward normal points +x) or a horizontal top edge (inward normal +y).
+    // Shared edges have opposite normals, so exactly one neighbour claims such samples.
+    bool bTopLeft = e.A > 0 || (e.A == 0 && e.B > 0);
+    if (!bTopLeft)
+      e.C -= 1;
+  }
+
+  // Depth plane through the snapped vertices, rebased so it evaluates directly at integer
+  // pixel coordinates (whose samples sit at the pixel centers).
+  const float fInvScale = 1.0f / SUBPIXEL_SCALE;
+  float fx1 = (X[1] - X[0]) * fInvScale, fy1 = (Y[1] - Y[0]) * fInvScale;
+  float fx2 = (X[2] - X[0]) * fInvScale, fy2 = (Y[2] - Y[0]) * fInvScale;
+  float fInvArea = 1.0f / ((float)area * fInvScale * fInvScale);
+  tri.dzdx = ((Z[1] - Z[0]) * fy2 - (Z[2] - Z[0]) * fy1) * fInvArea;
+  tri.dzdy = ((Z[2] - Z[0]) * fx1 - (Z[1] - Z[0]) * fx2) * fInvArea;
+  tri.z0 = Z[0] - tri.dzdx * (X[0] * fInvScale - 0.5f) - tri.dzdy * (Y[0] * fInvScale - 0.5f);
+  tri.minZ = std::min({Z[0], Z[1], Z[2]});
+  tri.maxZ = std::max({Z[0], Z[1], Z[2]});
+  tri.source = blend::MakeSource(color, m_state.blend, m_state.colorMask);
+  tri.kernel = (uint8_t)((int)m_state.blend * 8 + (m_state.bDepthTest ? 4 : 0) +
+                         (m_state.bDepthWrite ? 2 : 0) + (m_state.colorMask != MaskAll ? 1 : 0));
+  tri.bDepthTest = m_state.bDepthTest;
+
+  uint32_t index = (uint32_t)m_vTriangles.size();
+  m_vTriangles.push_back(tri);
+  ++m_stats.trianglesBinned;
+
+  for (int ty = tri.minY / TILE_SIZE; ty <= tri.maxY / TILE_SIZE; ++ty) {
+    for (int tx = tri.minX / TILE_SIZE; tx <= tri.maxX / TILE_SIZE; ++tx) {
+      m_vBins[ty * m_nTilesX + tx].push_back(index);
+      ++m_stats.binEntries;
+    }
+  }
+}
+
+void Rasterizer::Flush(Color* framebuffer, float* depthBuffer) {
+  if (m_vTriangles.empty())
+    return;
+
+  m_pTarget = framebuffer;
+  m_pDepth = depthBuffer;
+
+  // One tile per chunk: tile costs vary too much for larger chunks to balance.
+  const int nTiles = m_nTilesX * m_nTilesY;
+  if (m_pJobs)
+    m_pJobs->ParallelFor(
+      0, nTiles, [this](size_t first, size_t end) { ProcessTiles((int)first, (int)end); }, 1);
+  else
+    ProcessTiles(0, nTiles);
+
+  m_stats.hiZTrianglesRejected += m_nHiZTrianglesRejected.exchange(0);
+  m_stats.hiZBlocksRejected += m_nHiZBlocksRejected.exchange(0);
+  m_stats.hiZFragmentsRejected += m_nHiZFragmentsRejected.exchange(0);
+  m_stats.fragmentsTested += m_nFragmentsTested.exchange(0);
+  m_stats.fragmentsWritten += m_nFragmentsWritten.exchange(0);
+
+  Discard();
+}
+
+void Rasterizer::Discard() {
+  m_vTriangles.clear();
+  for (auto& bin : m_vBins)
+    bin.clear();
+}
+
+void Rasterizer::ProcessTiles(int firstTile, int endTile) {
+  ENGINE_PROFILE_ZONE("RasterTiles");
+  for (int tile = firstTile; tile < endTile; ++tile)
+    RasterizeTile(tile);
+}
+
+float Rasterizer::TileMaxDepth(int tile) {
+  if (m_vTileMaxDirty[tile]) {
+    int bx0 = (tile % m_nTilesX) * (TILE_SIZE / BLOCK_SIZE);
+    int by0 = (tile / m_nTilesX) * (TILE_SIZE / BLOCK_SIZE);
+    int bx1 = std::min(bx0 + TILE_SIZE / BLOCK_SIZE, m_nBlocksX);
+    int by1 = std::min(by0 + TILE_SIZE / BLOCK_SIZE, m_nBlocksY);
+    float maxZ = m_vBlockMaxZ[by0 * m_nBlocksX + bx0];
+    for (int by = by0; by < by1; ++by)
+      for (int bx = bx0; bx < bx1; ++bx)
+        maxZ = std::max(maxZ, m_vBlockMaxZ[by * m_nBlocksX + bx]);
+    m_vTileMaxZ[tile] = maxZ;
+    m_vTileMaxDirty[tile] = 0;
+  }
+  return m_vTileMaxZ[tile];
+}
+
+void Rasterizer::RasterizeTile(int tile) {
+  const std::vector<uint32_t>& bin = m_vBins[tile];
+  if (bin.empty())
+    return;
+
+  int tx0 = (tile % m_nTilesX) * TILE_SIZE;
+  int ty0 = (tile / m_nTilesX) * TILE_SIZE;
+  int tx1 = std::min(tx0 + TILE_SIZE, m_nWidth) - 1;
+  int ty1 = std::min(ty0 + TILE_SIZE, m_nHeight) - 1;
+
+  TileCounters counters;
+  for (uint32_t index : bin) {
+    const SetupTriangle& tri = m_vTriangles[index];
+    int x0 = std::max(tx0, tri.minX), y0 = std::max(ty0, tri.minY);
+    int x1 = std::min(tx1, tri.maxX), y1 = std::min(ty1, tri.maxY);
+
+    // Whole triangle behind everything already drawn in this tile.
+    if (tri.bDepthTest && tri.minZ > TileMaxDepth(tile)) {
+      ++counters.hiZTrianglesRejected;
+      counters.hiZFragmentsRejected += (uint64_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+      continue;
+    }
+    (this->*TRIANGLE_KERNELS[tri.kernel])(tri, tile, x0, y0, x1, y1, counters);
+  }
+
+  m_nHiZTrianglesRejected.fetch_add(counters.hiZTrianglesRejected, std::memory_order_relaxed);
+  m_nHiZBlocksRejected.fetch_add(counters.hiZBlocksRejected, std::memory_order_relaxed);
+  m_nHiZFragmentsRejected.fetch_add(counters.hiZFragmentsRejected, std::memory_order_relaxed);
+  m_nFragmentsTested.fetch_add(counters.fragmentsTested, std::memory_order_relaxed);
+  m_nFragmentsWritten.fetch_add(counters.fragmentsWritten, std::memory_order_relaxed);
+}
+
+namespace {
+  // Set bits of each 4-bit movemask
+  const uint8_t BIT_COUNT[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+} // namespace
+
+template <BlendMode MODE, bool DEPTH_TEST, bool DEPTH_WRITE, bool MASKED>
+void Rasterizer::RasterizeTriangle(const SetupTriangle& tri, int tile, int x0, int y0, int x1,
+                                   int y1, TileCounters& counters) {
+  const int64_t half = SUBPIXEL_SCALE / 2;
+  const blend::Source& src = tri.source;
+  // Locals, as the pixel stores could otherwise alias the members
+  const int width = m_nWidth;
+  uint32_t* const target = reinterpret_cast<uint32_t*>(m_pTarget);
+  float* const depthBuffer = m_pDepth;
+#if defined(ENGINE_SIMD_SSE)
+  const blend::Source4 src4(src);
+  const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+  const __m128 dzdx = _mm_set1_ps(tri.dzdx);
+#endif
+
+  // Walk the clipped bounds in BLOCK_SIZE^2 blocks. Each block is first classified against
+  // the three edges using its corner samples: blocks outside any edge are skipped, and
+  // edges a block lies wholly inside are dropped from its per-pixel tests. With depth
+  // testing, the block's depth range is then checked against the hierarchical-Z bounds
+  // before touching the depth buffer.
+  for (int by = y0 & ~(BLOCK_SIZE - 1); by <= y1; by += BLOCK_SIZE) {
+    int cy0 = std::max(by, y0);
+    int cy1 = std::min(by + BLOCK_SIZE - 1, y1);
+
+    for (int bx = x0 & ~(BLOCK_SIZE - 1); bx <= x1; bx += BLOCK_SIZE) {
+      int cx0 = std::max(bx, x0);
+      int cx1 = std::min(bx + BLOCK_SIZE - 1, x1);
+
+      int64_t sx = (int64_t)cx0 * SUBPIXEL_SCALE + half;
+      int64_t sy = (int64_t)cy0 * SUBPIXEL_SCALE + half;
+
+      bool bOutside = false;
+      bool bInside = true;
+      int64_t eOrigin[3];
+      int64_t eMin[3];
+      for (int i = 0; i < 3; ++i) {
+        const Edge& e = tri.edges[i];
+        int64_t ex = (int64_t)e.A * SUBPIXEL_SCALE * (cx1 - cx0);
+        int64_t ey = (int64_t)e.B * SUBPIXEL_SCALE * (cy1 - cy0);
+        eOrigin[i] = e.A * sx + e.B * sy + e.C;
+        int64_t eMax = eOrigin[i] + std::max<int64_t>(0, ex) + std::max<int64_t>(0, ey);
+        eMin[i] = eOrigin[i] + std::min<int64_t>(0, ex) + std::min<int64_t>(0, ey);
+        if (eMax < 0)
+          bOutside = true;
+        if (eMin[i] < 0)
+          bInside = false;
+      }
+      if (bOutside)
+        continue;
+
+      // Depth range of the plane over this block, tightened by the triangle's own range.
+      float zOrigin = tri.z0 + tri.dzdx * cx0 + tri.dzdy * cy0;
+      float zx = tri.dzdx * (cx1 - cx0);
+      float zy = tri.dzdy * (cy1 - cy0);
+      float zMin = std::max(tri.minZ, zOrigin + std::min(0.0f, zx) + std::min(0.0f, zy));
+      float zMax = std::min(tri.maxZ, zOrigin + std::max(0.0f, zx) + std::max(0.0f, zy));
+
+      int block = (by / BLOCK_SIZE) * m_nBlocksX + bx / BLOCK_SIZE;
+      float& blockMinZ = m_vBlockMinZ[block];
+      float& blockMaxZ = m_vBlockMaxZ[block];
+      // Every sample is in front of everything stored in the block: skip the depth reads.
+      bool bAllPass = true;
+      if constexpr (DEPTH_TEST) {
+        if (zMin > blockMaxZ) {
+          ++counters.hiZBlocksRejected;
+          counters.hiZFragmentsRejected += (uint64_t)(cx1 - cx0 + 1) * (cy1 - cy0 + 1);
+          continue;
+        }
+        bAllPass = zMax <= blockMinZ;
+      }
+      if constexpr (DEPTH_WRITE) {
+        blockMinZ = std::min(blockMinZ, zMin);
+        // Untested writes may store depths behind the block's bound.
+        if (!DEPTH_TEST && zMax > blockMaxZ) {
+          blockMaxZ = zMax;
+          m_vTileMaxDirty[tile] = 1;
+        }
+      }
+
+      // Per-pixel edge steps, from the block's first column so that SIMD groups stay
+      // aligned to it. Within a block the values of an edge that crosses it are bounded by
+      // the block extent, so 32 bits suffice; edges that fully contain the block are pinned
+      // to 0 and never fail the test.
+      int32_t row0[3], dx[3], dy[3];
+      for (int i = 0; i < 3; ++i) {
+        const Edge& e = tri.edges[i];
+        if (eMin[i] >= 0) {
+          row0[i] = 0;
+          dx[i] = 0;
+          dy[i] = 0;
+        } else {
+          dx[i] = e.A * SUBPIXEL_SCALE;
+          dy[i] = e.B * SUBPIXEL_SCALE;
+          row0[i] = (int32_t)eOrigin[i] - dx[i] * (cx0 - bx);
+        }
+      }
+#if defined(ENGINE_SIMD_SSE)
+      const __m128i vCx0 = _mm_set1_epi32(cx0), vCx1 = _mm_set1_epi32(cx1);
+      const __m128i laneDx0 = _mm_setr_epi32(0, dx[0], 2 * dx[0], 3 * dx[0]);
+      const __m128i laneDx1 = _mm_setr_epi32(0, dx[1], 2 * dx[1], 3 * dx[1]);
+      const __m128i laneDx2 = _mm_setr_epi32(0, dx[2], 2 * dx[2], 3 * dx[2]);
+      const __m128i stepDx0 = _mm_set1_epi32(4 * dx[0]);
+      const __m128i stepDx1 = _mm_set1_epi32(4 * dx[1]);
+      const __m128i stepDx2 = _mm_set1_epi32(4 * dx[2]);
+      const __m128 allPass = _mm_castsi128_ps(_mm_set1_epi32(bAllPass ? -1 : 0));
+      // Groups of four run while they start within [bx, cx1] and end within the row.
+      const int simdEnd = std::min(cx1 + 1, width - 3);
+#endif
+      int nTested = 0, nWritten = 0;
+
+      for (int y = cy0; y <= cy1; ++y) {
+        uint32_t* row = target + (size_t)y * width;
+        float* depthRow = depthBuffer + (size_t)y * width;
+        float zRow = zOrigin + tri.dzdy * (y - cy0) - tri.dzdx * (cx0 - bx);
+        int32_t w0 = row0[0], w1 = row0[1], w2 = row0[2];
+        int x = bx;
+
+#if defined(ENGINE_SIMD_SSE)
+        // Four pixels per step, masked to [cx0, cx1]. Every column of the block lies in
+        // this tile, so rewriting the masked-out pixels unchanged is safe.
+        __m128i vw0 = _mm_add_epi32(_mm_set1_epi32(w0), laneDx0);
+        __m128i vw1 = _mm_add_epi32(_mm_set1_epi32(w1), laneDx1);
+        __m128i vw2 = _mm_add_epi32(_mm_set1_epi32(w2), laneDx2);
+        for (; x < simdEnd; x += 4) {
+          __m128i columns = _mm_add_epi32(_mm_set1_epi32(x), lane);
+          __m128i outOfRange =
+            _mm_or_si128(_mm_cmplt_epi32(columns, vCx0), _mm_cmpgt_epi32(columns, vCx1));
+          __m128i edges = _mm_or_si128(_mm_or_si128(vw0, vw1), vw2);
+          __m128i covered = _mm_andnot_si128(_mm_or_si128(_mm_srai_epi32(edges, 31), outOfRange),
+                                             _mm_set1_epi32(-1));
+          vw0 = _mm_add_epi32(vw0, stepDx0);
+          vw1 = _mm_add_epi32(vw1, stepDx1);
+          vw2 = _mm_add_epi32(vw2, stepDx2);
+          int coverBits = _mm_movemask_ps(_mm_castsi128_ps(covered));
+          if (!coverBits)
+            continue;
+
+          // The same rounding as the scalar loop below
+          __m128 offsets = _mm_cvtepi32_ps(_mm_sub_epi32(columns, _mm_set1_epi32(bx)));
+          __m128 z = _mm_add_ps(_mm_set1_ps(zRow), _mm_mul_ps(dzdx, offsets));
+          __m128i pass = covered;
+          __m128 depth;
+          if constexpr (DEPTH_TEST || DEPTH_WRITE)
+            depth = _mm_loadu_ps(depthRow + x);
+          if constexpr (DEPTH_TEST) {
+            __m128 nearer = _mm_or_ps(allPass, _mm_cmple_ps(z, depth));
+            pass = _mm_and_si128(pass, _mm_castps_si128(nearer));
+          }
+          nTested += BIT_COUNT[coverBits];
+          nWritten += BIT_COUNT[_mm_movemask_ps(_mm_castsi128_ps(pass))];
+
+          __m128i* pixels = reinterpret_cast<__m128i*>(row + x);
+          __m128i dst = _mm_loadu_si128(pixels);
+          __m128i out = blend::Apply<MODE, MASKED>(dst, src4);
+          _mm_storeu_si128(pixels, _mm_or_si128(_mm_and_si128(pass, out),
+                                                _mm_andnot_si128(pass, dst)));
+          if constexpr (DEPTH_WRITE) {
+            __m128 passZ = _mm_castsi128_ps(pass);
+            _mm_storeu_ps(depthRow + x,
+                          _mm_or_ps(_mm_and_ps(passZ, z), _mm_andnot_ps(passZ, depth)));
+          }
+        }
+        const int32_t skipped = x - bx;
+        w0 += dx[0] * skipped;
+        w1 += dx[1] * skipped;
+        w2 += dx[2] * skipped;
+#endif
+
+        for (; x <= cx1; ++x, w0 += dx[0], w1 += dx[1], w2 += dx[2]) {
+          if (x < cx0 || (w0 | w1 | w2) < 0)
+            continue;
+          ++nTested;
+          float z = zRow + tri.dzdx * (float)(x - bx);
+          if constexpr (DEPTH_TEST) {
+            if (!bAllPass && z > depthRow[x])
+              continue;
+          }
+          row[x] = blend::Apply<MODE, MASKED>(row[x], src);
+          if constexpr (DEPTH_WRITE)
+            depthRow[x] = z;
+          ++nWritten;
+        }
+        row0[0] += dy[0];
+        row0[1] += dy[1];
+        row0[2] += dy[2];
+      }
+      counters.fragmentsTested += nTested;
+      counters.fragmentsWritten += nWritten;
+
+      // Covering the entire block bounds every stored depth by zMax.
+      if constexpr (DEPTH_WRITE) {
+        bool bWholeBlock = bInside && cx0 == bx && cy0 == by &&
+                           cx1 == std::min(bx + BLOCK_SIZE, width) - 1 &&
+                           cy1 == std::min(by + BLOCK_SIZE, m_nHeight) - 1;
+        float bound = DEPTH_TEST ? std::min(blockMaxZ, zMax) : zMax;
+        if (bWholeBlock && bound != blockMaxZ) {
+          blockMaxZ = bound;
+          m_vTileMaxDirty[tile] = 1;
+        }
+      }
+    }
+  }
+}
+
+// Indexed as documented in the header: 8 states per blend mode.
+#define RASTERIZER_KERNELS(MODE)                                                               \
+  &Rasterizer::RasterizeTriangle<MODE, false, false, false>,                                   \
+    &Rasterizer::RasterizeTriangle<MODE, false, false, true>,                                  \
+    &Rasterizer::RasterizeTriangle<MODE, false, true, false>,                                  \
+    &Rasterizer::RasterizeTriangle<MODE, false, true, true>,                                   \
+    &Rasterizer::RasterizeTriangle<MODE, true, false, false>,                                  \
+    &Rasterizer::RasterizeTriangle<MODE, true, false, true>,                                   \
+    &Rasterizer::RasterizeTriangle<MODE, true, true, false>,                                   \
+    &Rasterizer::RasterizeTriangle<MODE, true, true, true>
+
+const Rasterizer::TriangleKernel Rasterizer::TRIANGLE_KERNELS[24] = {
+  RASTERIZER_KERNELS(BlendMode::Opaque), RASTERIZER_KERNELS(BlendMode::Alpha),
+  RASTERIZER_KERNELS(BlendMode::Additive)};
+
+#undef RASTERIZER_KERNELS
@@ -0,0 +1,173 @@
+#include "scene.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+ObjectId Scene::Add(Mesh* mesh, TransformId transform) {
+  ObjectId id;
+  if (!m_vFreeObjects.empty()) {
+    id = m_vFreeObjects.back();
+    m_vFreeObjects.pop_back();
+  } else {
+    id = (ObjectId)m_vObjects.size();
+    m_vObjects.emplace_back();
+    m_vWorldBounds.emplace_back();
+    m_vNextSameTransform.push_back(INVALID_OBJECT);
+  }
+  m_vObjects[id].meshAsset = mesh;
+  m_vObjects[id].transform = transform;
+  m_vObjects[id].lods = nullptr;
+  m_vObjects[id].lod = 0;
+  m_vObjects[id].occluder = nullptr;
+
+  if (transform >= m_vFirstByTransform.size())
+    m_vFirstByTransform.resize(transform + 1, INVALID_OBJECT);
+  m_vNextSameTransform[id] = m_vFirstByTransform[transform];
+  m_vFirstByTransform[transform] = id;
+
+  BoundsOf(mesh);
+  m_bRebuild = true;
+  return id;
+}
+
+void Scene::Remove(ObjectId id) {
+  ObjectId* link = &m_vFirstByTransform[m_vObjects[id].transform];
+  while (*link != id)
+    link = &m_vNextSameTransform[*link];
+  *link = m_vNextSameTransform[id];
+
+  m_vObjects[id] = Object();
+  m_vWorldBounds[id] = Aabb();
+  m_vFreeObjects.push_back(id);
+  m_bRebuild = true;
+}
+
+const Aabb& Scene::GetMeshBounds(const Mesh* mesh) { return BoundsOf(mesh).box; }
+
+const BoundingSphere& Scene::GetMeshSphere(const Mesh* mesh) { return BoundsOf(mesh).sphere; }
+
+void Scene::RefreshMeshBounds(const Mesh* mesh) {
+  m_meshBounds.erase(mesh);
+  BoundsOf(mesh);
+  m_bRebuild = true;
+}
+
+template <typename F>
+void Scene::ForEachObject(const TransformHierarchy::Range& range, F&& f) const {
+  for (uint32_t index = range.begin; index < range.end; ++index) {
+    TransformId transform = transforms.GetIdAt(index);
+    if (transform >= m_vFirstByTransform.size())
+      continue;
+    for (ObjectId id = m_vFirstByTransform[transform]; id != INVALID_OBJECT;
+         id = m_vNextSameTransform[id])
+      f(id);
+  }
+}
+
+void Scene::Update(JobSystem* jobs) {
+  ENGINE_PROFILE_ZONE("Scene");
+  const bool bRebuild = m_bRebuild;
+  size_t nRanges = transforms.BeginUpdate();
+  const std::vector<TransformHierarchy::Range>& ranges = transforms.GetUpdatedRanges();
+  // Each range is a separate subtree, so its matrices and the bounds of the objects it
+  // places can be rebuilt independently of the others.
+  auto updateRanges = [&](size_t first, size_t end) {
+    for (size_t i = first; i < end; ++i) {
+      transforms.UpdateRange(i);
+      if (!bRebuild)
+        ForEachObject(ranges[i], [&](ObjectId id) { UpdateWorldBounds(id); });
+    }
+  };
+  if (jobs)
+    jobs->ParallelFor(0, nRanges, updateRanges);
+  else
+    updateRanges(0, nRanges);
+
+  if (bRebuild) {
+    for (ObjectId id = 0; id < (ObjectId)m_vObjects.size(); ++id)
+      UpdateWorldBounds(id);
+    m_bvh.Build(m_vWorldBounds.data(), m_vWorldBounds.size());
+    m_bRebuild = false;
+    return;
+  }
+
+  for (const TransformHierarchy::Range& range : ranges)
+    ForEachObject(range, [&](ObjectId id) { m_bvh.Refit(id, m_vWorldBounds[id]); });
+  if (m_bvh.GetDegradation() > REBUILD_DEGRADATION)
+    m_bvh.Build(m_vWorldBounds.data(), m_vWorldBounds.size());
+}
+
+void Scene::Cull(const Frustum& frustum, std::vector<ObjectId>& visible) const {
+  ENGINE_PROFILE_ZONE("Cull");
+  m_bvh.Query(frustum, visible);
+}
+
+void Scene::CullOccluded(OcclusionBuffer& buffer, const Mat4& viewProjection,
+                         std::vector<ObjectId>& visible) const {
+  ENGINE_PROFILE_ZONE("CullOccluded");
+  buffer.Begin(viewProjection);
+  for (ObjectId id : visible) {
+    const Object& object = m_vObjects[id];
+    if (object.occluder)
+      buffer.AddOccluder(object.occluder->View(), transforms.GetWorldMatrix(object.transform));
+  }
+  buffer.Rasterize();
+
+  // An occluder's own depth lies inside its bounds, so it never hides itself.
+  size_t nKept = 0;
+  for (ObjectId id : visible) {
+    if (!buffer.IsOccluded(m_vWorldBounds[id]))
+      visible[nKept++] = id;
+  }
+  visible.resize(nKept);
+}
+
+void Scene::SetLods(ObjectId id, const LodChain* lods) {
+  m_vObjects[id].lods = lods;
+  m_vObjects[id].lod = 0;
+}
+
+void Scene::SelectLods(const std::vector<ObjectId>& ids, const VecThree& eye, float fFovDegrees,
+                       int nScreenHeight, float fMaxPixelError) {
+  ENGINE_PROFILE_ZONE("SelectLods");
+  for (ObjectId id : ids) {
+    Object& object = m_vObjects[id];
+    if (!object.lods)
+      continue;
+    // Mesh units become world units through the largest axis scale of the world matrix.
+    const Mat4& world = transforms.GetWorldMatrix(object.transform);
+    float fScaleSq = 0.0f;
+    for (int row = 0; row < 3; ++row) {
+      const float* r = world.m[row];
+      fScaleSq = std::max(fScaleSq, r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+    }
+    float fDistance = m_vWorldBounds[id].Distance(eye);
+
+    float fPixelsPerUnit = fDistance > 0.0f
+                             ? LodChain::PixelsPerUnit(fDistance, fFovDegrees, nScreenHeight) *
+                                 std::sqrt(fScaleSq)
+                             : 1e30f;
+    object.lod = (uint32_t)object.lods->Select(object.lod, fPixelsPerUnit, fMaxPixelError);
+  }
+}
+
+const Scene::MeshBounds& Scene::BoundsOf(const Mesh* mesh) {
+  auto found = m_meshBounds.find(mesh);
+  if (found == m_meshBounds.end())
+    found = m_meshBounds.emplace(mesh, MeshBounds{Aabb::FromMesh(*mesh),
+                                                  BoundingSphere::FromMesh(*mesh)})
+              .first;
+  return found->second;
+}
+
+void Scene::UpdateWorldBounds(ObjectId id) {
+  const Object& object = m_vObjects[id];
+  if (!object.meshAsset) {
+    m_vWorldBounds[id] = Aabb();
+    return;
+  }
+  m_vWorldBounds[id] =
+    BoundsOf(object.meshAsset).box.Transformed(transforms.GetWorldMatrix(object.transform));
+}
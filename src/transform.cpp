@@ -0,0 +1,191 @@
+#include "transform.h"
+
+#include "mathematics.h"
+
+#include <algorithm>
+#include <cmath>
+
+TransformId TransformHierarchy::Create(TransformId parent) {
+  TransformId id;
+  if (!m_vFreeIds.empty()) {
+    id = m_vFreeIds.back();
+    m_vFreeIds.pop_back();
+  } else {
+    id = (TransformId)m_vIndexOf.size();
+    m_vIndexOf.push_back(NO_NODE);
+  }
+
+  Node node;
+  node.id = id;
+  uint32_t pos = (uint32_t)m_vNodes.size();
+  if (parent != INVALID_TRANSFORM) {
+    node.parent = m_vIndexOf[parent];
+    pos = node.parent + m_vNodes[node.parent].subtreeSize;
+    AdjustSubtreeSizes(node.parent, 1);
+  }
+  Mat4 world = Mat4::MakeIdentity();
+  Insert(pos, &node, &world, 1);
+  m_vDirty.push_back(id);
+  return id;
+}
+
+void TransformHierarchy::Destroy(TransformId id) {
+  uint32_t index = m_vIndexOf[id];
+  uint32_t count = m_vNodes[index].subtreeSize;
+  if (m_vNodes[index].parent != NO_NODE)
+    AdjustSubtreeSizes(m_vNodes[index].parent, -(int64_t)count);
+  for (uint32_t i = index; i < index + count; ++i) {
+    m_vIndexOf[m_vNodes[i].id] = NO_NODE;
+    m_vFreeIds.push_back(m_vNodes[i].id);
+  }
+  Erase(index, count);
+}
+
+bool TransformHierarchy::SetParent(TransformId id, TransformId parent) {
+  uint32_t index = m_vIndexOf[id];
+  uint32_t count = m_vNodes[index].subtreeSize;
+  if (parent != INVALID_TRANSFORM) {
+    uint32_t parentIndex = m_vIndexOf[parent];
+    if (parentIndex >= index && parentIndex < index + count)
+      return false;
+  }
+
+  // Lift the subtree out, with parent links relative to its root.
+  std::vector<Node> nodes(m_vNodes.begin() + index, m_vNodes.begin() + index + count);
+  std::vector<Mat4> worlds(m_vWorld.begin() + index, m_vWorld.begin() + index + count);
+  for (uint32_t i = 1; i < count; ++i)
+    nodes[i].parent -= index;
+  if (m_vNodes[index].parent != NO_NODE)
+    AdjustSubtreeSizes(m_vNodes[index].parent, -(int64_t)count);
+  Erase(index, count);
+
+  uint32_t pos = (uint32_t)m_vNodes.size();
+  nodes[0].parent = NO_NODE;
+  if (parent != INVALID_TRANSFORM) {
+    nodes[0].parent = m_vIndexOf[parent];
+    pos = nodes[0].parent + m_vNodes[nodes[0].parent].subtreeSize;
+    AdjustSubtreeSizes(nodes[0].parent, count);
+  }
+  for (uint32_t i = 1; i < count; ++i)
+    nodes[i].parent += pos;
+  Insert(pos, nodes.data(), worlds.data(), count);
+
+  // The local matrix still holds; only the world matrices below need rebuilding.
+  m_vDirty.push_back(id);
+  return true;
+}
+
+TransformId TransformHierarchy::GetParent(TransformId id) const {
+  uint32_t parent = NodeOf(id).parent;
+  return parent == NO_NODE ? INVALID_TRANSFORM : m_vNodes[parent].id;
+}
+
+void TransformHierarchy::SetPosition(TransformId id, const VecThree& position) {
+  Node& node = NodeOf(id);
+  node.position = position;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::SetRotation(TransformId id, const VecThree& rotation) {
+  Node& node = NodeOf(id);
+  node.rotation = rotation;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::SetScale(TransformId id, float scale) {
+  Node& node = NodeOf(id);
+  node.scale = scale;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::Update() {
+  size_t nRanges = BeginUpdate();
+  for (size_t i = 0; i < nRanges; ++i)
+    UpdateRange(i);
+}
+
+size_t TransformHierarchy::BeginUpdate() {
+  m_vRanges.clear();
+  m_vDirtyIndices.clear();
+  for (TransformId id : m_vDirty) {
+    // Destroyed since it was marked
+    if (m_vIndexOf[id] != NO_NODE)
+      m_vDirtyIndices.push_back(m_vIndexOf[id]);
+  }
+  m_vDirty.clear();
+
+  // Nested and repeated entries fall inside the subtree range of the first one seen.
+  std::sort(m_vDirtyIndices.begin(), m_vDirtyIndices.end());
+  uint32_t end = 0;
+  for (uint32_t index : m_vDirtyIndices) {
+    if (index < end)
+      continue;
+    end = index + m_vNodes[index].subtreeSize;
+    m_vRanges.push_back({index, end});
+  }
+  return m_vRanges.size();
+}
+
+void TransformHierarchy::UpdateRange(size_t nRange) {
+  // Parents precede children, and the parent of the range root lies outside every range,
+  // so each parent world matrix read here is already final.
+  const Range& range = m_vRanges[nRange];
+  for (uint32_t i = range.begin; i < range.end; ++i) {
+    Node& node = m_vNodes[i];
+    if (node.bDirty) {
+      node.local = ComposeLocal(node.position, node.rotation, node.scale);
+      node.bDirty = false;
+    }
+    m_vWorld[i] =
+      node.parent == NO_NODE ? node.local : Mat4::Multiply(node.local, m_vWorld[node.parent]);
+  }
+}
+
+Mat4 TransformHierarchy::ComposeLocal(const VecThree& position, const VecThree& rotation,
+                                      float scale) {
+  // Rows of scale * Rx * Ry * Rz, expanded, followed by the translation row.
+  float rx = mathematics::DegToRad(rotation.x);
+  float ry = mathematics::DegToRad(rotation.y);
+  float rz = mathematics::DegToRad(rotation.z);
+  float cx = cosf(rx), sx = sinf(rx);
+  float cy = cosf(ry), sy = sinf(ry);
+  float cz = cosf(rz), sz = sinf(rz);
+  return Mat4(scale * cy * cz, scale * cy * sz, scale * sy, 0.0f,
+              scale * (-sx * sy * cz - cx * sz), scale * (cx * cz - sx * sy * sz), scale * sx * cy,
+              0.0f, scale * (sx * sz - cx * sy * cz), scale * (-cx * sy * sz - sx * cz),
+              scale * cx * cy, 0.0f, position.x, position.y, position.z, 1.0f);
+}
+
+void TransformHierarchy::MarkDirty(Node& node) {
+  if (!node.bDirty) {
+    node.bDirty = true;
+    m_vDirty.push_back(node.id);
+  }
+}
+
+void TransformHierarchy::AdjustSubtreeSizes(uint32_t index, int64_t delta) {
+  for (; index != NO_NODE; index = m_vNodes[index].parent)
+    m_vNodes[index].subtreeSize = (uint32_t)((int64_t)m_vNodes[index].subtreeSize + delta);
+}
+
+void TransformHierarchy::Insert(uint32_t pos, const Node* nodes, const Mat4* worlds,
+                                uint32_t count) {
+  m_vNodes.insert(m_vNodes.begin() + pos, nodes, nodes + count);
+  m_vWorld.insert(m_vWorld.begin() + pos, worlds, worlds + count);
+  for (uint32_t i = pos + count; i < (uint32_t)m_vNodes.size(); ++i) {
+    if (m_vNodes[i].parent != NO_NODE && m_vNodes[i].parent >= pos)
+      m_vNodes[i].parent += count;
+  }
+  for (uint32_t i = pos; i < (uint32_t)m_vNodes.size(); ++i)
+    m_vIndexOf[m_vNodes[i].id] = i;
+}
+
+void TransformHierarchy::Erase(uint32_t pos, uint32_t count) {
+  m_vNodes.erase(m_vNodes.begin() + pos, m_vNodes.begin() + pos + count);
+  m_vWorld.erase(m_vWorld.begin() + pos, m_vWorld.begin() + pos + count);
+  for (uint32_t i = pos; i < (uint32_t)m_vNodes.size(); ++i) {
+    if (m_vNodes[i].parent != NO_NODE && m_vNodes[i].parent >= pos)
+      m_vNodes[i].parent -= count;
+    m_vIndexOf[m_vNodes[i].id] = i;
+  }
+}
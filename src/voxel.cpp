@@ -0,0 +1,281 @@
+#include "voxel.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+  const int N = VoxelChunk::SIZE;
+
+  int CountTrailingZeros(uint32_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctz(bits);
+#endif
+  }
+
+  // Floor division and the matching remainder, for negative voxel coordinates.
+  int ChunkOf(int v) { return v >= 0 ? v / N : -((-v + N - 1) / N); }
+  int LocalOf(int v) { return v - ChunkOf(v) * N; }
+
+  // Bits [from, to) of a row.
+  uint32_t RowMask(int from, int to) {
+    uint32_t upTo = to >= N ? ~0u : (1u << to) - 1u;
+    return upTo & ~((1u << from) - 1u);
+  }
+
+  // Consumes the set bits of a 32x32 mask (rows of column bits) as maximal rectangles,
+  // growing each run along its row first and then down the following rows.
+  template <typename Emit>
+  void GreedyRects(uint32_t mask[N], Emit emit) {
+    for (int row = 0; row < N; ++row) {
+      while (mask[row]) {
+        int col = CountTrailingZeros(mask[row]);
+        uint32_t shifted = ~(mask[row] >> col);
+        int width = shifted ? std::min(CountTrailingZeros(shifted), N - col) : N - col;
+        uint32_t run = RowMask(col, col + width);
+        int height = 1;
+        while (row + height < N && (mask[row + height] & run) == run) {
+          mask[row + height] &= ~run;
+          ++height;
+        }
+        mask[row] &= ~run;
+        emit(row, col, height, width);
+      }
+    }
+  }
+} // namespace
+
+bool VoxelChunk::IsEmpty() const {
+  for (int y = 0; y < N; ++y) {
+    for (int z = 0; z < N; ++z) {
+      if (m_rows[y][z])
+        return false;
+    }
+  }
+  return true;
+}
+
+void VoxelChunk::AppendMesh(Mesh& mesh, const VoxelChunk* const neighbours[6],
+                            const VecThree& origin, float fVoxelSize) const {
+  // Emits the quad on the face plane of axis at voxel coordinate plane, covering rows
+  // [row, row + height) and columns [col, col + width) of that face's mask layout.
+  auto emitQuad = [&](int axis, int dir, int plane, int row, int col, int height, int width) {
+    // Mask layout per axis: x faces are (row y, column z), y faces (row z, column x) and
+    // z faces (row y, column x).
+    const int rowAxis[3] = {1, 2, 1};
+    const int colAxis[3] = {2, 0, 0};
+    float corner[4][3];
+    const int rows[4] = {row, row, row + height, row + height};
+    const int cols[4] = {col, col + width, col + width, col};
+    for (int i = 0; i < 4; ++i) {
+      corner[i][axis] = (float)plane;
+      corner[i][rowAxis[axis]] = (float)rows[i];
+      corner[i][colAxis[axis]] = (float)cols[i];
+    }
+    uint32_t base = (uint32_t)mesh.VertexCount();
+    for (int i = 0; i < 4; ++i) {
+      mesh.AddVertex({origin.x + corner[i][0] * fVoxelSize, origin.y + corner[i][1] * fVoxelSize,
+                      origin.z + corner[i][2] * fVoxelSize});
+    }
+    // Outward faces have (v1 - v0) x (v2 - v0) along the normal. Corners 0, 1, 2 step
+    // along the column axis and then the row axis, whose cross product has the sign of
+    // +axis exactly when (column, row, axis) is a cyclic order.
+    bool bCyclic = (colAxis[axis] + 1) % 3 == rowAxis[axis];
+    if (bCyclic == (dir > 0)) {
+      mesh.AddTriangle(base, base + 1, base + 2);
+      mesh.AddTriangle(base, base + 2, base + 3);
+    } else {
+      mesh.AddTriangle(base, base + 2, base + 1);
+      mesh.AddTriangle(base, base + 3, base + 2);
+    }
+  };
+
+  uint32_t mask[N];
+
+  // x faces: exposure is a shift within each row, then scattered into per-slice masks.
+  for (int dir = -1; dir <= 1; dir += 2) {
+    const VoxelChunk* next = neighbours[dir < 0 ? 0 : 1];
+    uint32_t slices[N][N] = {};
+    for (int y = 0; y < N; ++y) {
+      for (int z = 0; z < N; ++z) {
+        uint32_t r = m_rows[y][z];
+        if (!r)
+          continue;
+        uint32_t covered;
+        if (dir > 0)
+          covered = (r >> 1) | (next ? (next->m_rows[y][z] & 1u) << (N - 1) : 0u);
+        else
+          covered = (r << 1) | (next ? next->m_rows[y][z] >> (N - 1) : 0u);
+        for (uint32_t exposed = r & ~covered; exposed; exposed &= exposed - 1)
+          slices[CountTrailingZeros(exposed)][y] |= 1u << z;
+      }
+    }
+    for (int x = 0; x < N; ++x) {
+      GreedyRects(slices[x], [&](int row, int col, int height, int width) {
+        emitQuad(0, dir, dir > 0 ? x + 1 : x, row, col, height, width);
+      });
+    }
+  }
+
+  // y faces: a row is covered by the row at the same z in the next layer.
+  for (int dir = -1; dir <= 1; dir += 2) {
+    const VoxelChunk* next = neighbours[dir < 0 ? 2 : 3];
+    for (int y = 0; y < N; ++y) {
+      int ny = y + dir;
+      for (int z = 0; z < N; ++z) {
+        uint32_t covered = ny >= 0 && ny < N ? m_rows[ny][z]
+                                             : (next ? next->m_rows[dir > 0 ? 0 : N - 1][z] : 0u);
+        mask[z] = m_rows[y][z] & ~covered;
+      }
+      GreedyRects(mask, [&](int row, int col, int height, int width) {
+        emitQuad(1, dir, dir > 0 ? y + 1 : y, row, col, height, width);
+      });
+    }
+  }
+
+  // z faces: a row is covered by the neighbouring row in z.
+  for (int dir = -1; dir <= 1; dir += 2) {
+    const VoxelChunk* next = neighbours[dir < 0 ? 4 : 5];
+    for (int z = 0; z < N; ++z) {
+      int nz = z + dir;
+      for (int y = 0; y < N; ++y) {
+        uint32_t covered = nz >= 0 && nz < N ? m_rows[y][nz]
+                                             : (next ? next->m_rows[y][dir > 0 ? 0 : N - 1] : 0u);
+        mask[y] = m_rows[y][z] & ~covered;
+      }
+      GreedyRects(mask, [&](int row, int col, int height, int width) {
+        emitQuad(2, dir, dir > 0 ? z + 1 : z, row, col, height, width);
+      });
+    }
+  }
+}
+
+VoxelWorld::VoxelWorld(float fVoxelSize, const VecThree& origin)
+  : m_fVoxelSize(fVoxelSize), m_origin(origin) {}
+
+bool VoxelWorld::Get(int x, int y, int z) const {
+  const Chunk* chunk = FindChunk(ChunkOf(x), ChunkOf(y), ChunkOf(z));
+  return chunk && chunk->voxels.Get(LocalOf(x), LocalOf(y), LocalOf(z));
+}
+
+void VoxelWorld::Set(int x, int y, int z, bool bSolid) {
+  FillBox(x, y, z, x + 1, y + 1, z + 1, bSolid);
+}
+
+void VoxelWorld::FillBox(int x0, int y0, int z0, int x1, int y1, int z1, bool bSolid) {
+  if (x1 <= x0 || y1 <= y0 || z1 <= z0)
+    return;
+  for (int cy = ChunkOf(y0); cy <= ChunkOf(y1 - 1); ++cy) {
+    for (int cz = ChunkOf(z0); cz <= ChunkOf(z1 - 1); ++cz) {
+      for (int cx = ChunkOf(x0); cx <= ChunkOf(x1 - 1); ++cx) {
+        if (!bSolid && !FindChunk(cx, cy, cz))
+          continue;
+        VoxelChunk& voxels = GetOrCreateChunk(cx, cy, cz).voxels;
+        // The box clipped to this chunk, in chunk-local coordinates
+        int lx0 = std::max(x0 - cx * N, 0), lx1 = std::min(x1 - cx * N, N);
+        int ly0 = std::max(y0 - cy * N, 0), ly1 = std::min(y1 - cy * N, N);
+        int lz0 = std::max(z0 - cz * N, 0), lz1 = std::min(z1 - cz * N, N);
+        uint32_t bits = RowMask(lx0, lx1);
+        for (int y = ly0; y < ly1; ++y) {
+          for (int z = lz0; z < lz1; ++z) {
+            uint32_t row = voxels.Row(y, z);
+            voxels.SetRow(y, z, bSolid ? row | bits : row & ~bits);
+          }
+        }
+      }
+    }
+  }
+
+  // The chunks holding the box, and those across each of its faces whose exposed faces
+  // may have changed. Growing one axis at a time leaves out diagonal neighbours.
+  MarkDirty(x0 - 1, y0, z0, x1 + 1, y1, z1);
+  MarkDirty(x0, y0 - 1, z0, x1, y1 + 1, z1);
+  MarkDirty(x0, y0, z0 - 1, x1, y1, z1 + 1);
+}
+
+size_t VoxelWorld::Remesh() {
+  size_t nRemeshed = m_vDirty.size();
+  for (uint32_t index : m_vDirty) {
+    Chunk& chunk = m_vChunks[index];
+    const VoxelChunk* neighbours[6];
+    const int offsets[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+    for (int i = 0; i < 6; ++i) {
+      const Chunk* neighbour =
+        FindChunk(chunk.cx + offsets[i][0], chunk.cy + offsets[i][1], chunk.cz + offsets[i][2]);
+      neighbours[i] = neighbour ? &neighbour->voxels : nullptr;
+    }
+    VecThree origin = {m_origin.x + (float)(chunk.cx * N) * m_fVoxelSize,
+                       m_origin.y + (float)(chunk.cy * N) * m_fVoxelSize,
+                       m_origin.z + (float)(chunk.cz * N) * m_fVoxelSize};
+    chunk.mesh.Clear();
+    chunk.voxels.AppendMesh(chunk.mesh, neighbours, origin, m_fVoxelSize);
+    chunk.bDirty = false;
+  }
+  m_vDirty.clear();
+  return nRemeshed;
+}
+
+size_t VoxelWorld::TriangleCount() const {
+  size_t count = 0;
+  for (const Chunk& chunk : m_vChunks)
+    count += chunk.mesh.TriangleCount();
+  return count;
+}
+
+void VoxelWorld::AppendTo(Mesh& mesh) const {
+  for (const Chunk& chunk : m_vChunks) {
+    uint32_t base = (uint32_t)mesh.VertexCount();
+    for (size_t i = 0; i < chunk.mesh.VertexCount(); ++i)
+      mesh.AddVertex(chunk.mesh.vertices.Get(i));
+    for (size_t i = 0; i < chunk.mesh.indices.size(); i += 3) {
+      mesh.AddTriangle(base + chunk.mesh.indices[i], base + chunk.mesh.indices[i + 1],
+                       base + chunk.mesh.indices[i + 2]);
+    }
+  }
+}
+
+uint64_t VoxelWorld::Key(int cx, int cy, int cz) {
+  // 21 bits per coordinate, enough for two million chunks each way
+  const uint64_t MASK = (1u << 21) - 1;
+  return ((uint64_t)cx & MASK) | (((uint64_t)cy & MASK) << 21) | (((uint64_t)cz & MASK) << 42);
+}
+
+const VoxelWorld::Chunk* VoxelWorld::FindChunk(int cx, int cy, int cz) const {
+  auto found = m_chunkIndex.find(Key(cx, cy, cz));
+  return found == m_chunkIndex.end() ? nullptr : &m_vChunks[found->second];
+}
+
+VoxelWorld::Chunk& VoxelWorld::GetOrCreateChunk(int cx, int cy, int cz) {
+  auto inserted = m_chunkIndex.emplace(Key(cx, cy, cz), (uint32_t)m_vChunks.size());
+  if (inserted.second) {
+    m_vChunks.emplace_back();
+    Chunk& chunk = m_vChunks.back();
+    chunk.cx = cx;
+    chunk.cy = cy;
+    chunk.cz = cz;
+  }
+  return m_vChunks[inserted.first->second];
+}
+
+void VoxelWorld::MarkDirty(int x0, int y0, int z0, int x1, int y1, int z1) {
+  for (int cy = ChunkOf(y0); cy <= ChunkOf(y1 - 1); ++cy) {
+    for (int cz = ChunkOf(z0); cz <= ChunkOf(z1 - 1); ++cz) {
+      for (int cx = ChunkOf(x0); cx <= ChunkOf(x1 - 1); ++cx) {
+        auto found = m_chunkIndex.find(Key(cx, cy, cz));
+        if (found == m_chunkIndex.end())
+          continue;
+        Chunk& chunk = m_vChunks[found->second];
+        if (!chunk.bDirty) {
+          chunk.bDirty = true;
+          m_vDirty.push_back(found->second);
+        }
+      }
+    }
+  }
+}